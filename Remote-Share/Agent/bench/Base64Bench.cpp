@@ -0,0 +1,44 @@
+// Base64 throughput per kernel against the encoder it replaced, from a small
+// dirty rect to a full 4K JPEG.
+#include "Base64.hpp"
+#include "Bench.hpp"
+#include "ReferenceBase64.hpp"
+
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+int main() {
+    std::printf("default kernel: %s\n", Base64::KernelName());
+    std::printf("%10s %12s %12s %12s %12s\n", "bytes", "reference", "scalar", "ssse3", "avx2");
+    const size_t sizes[] = {1024, 16 * 1024, 400 * 1024, 4 * 1024 * 1024};
+    std::mt19937 rng(1);
+    for (size_t size : sizes) {
+        std::vector<uint8_t> input(size);
+        for (uint8_t& b : input) {
+            b = static_cast<uint8_t>(rng());
+        }
+        std::string out(Base64::EncodedSize(size), '\0');
+        int iterations = Bench::Iterations(static_cast<int>(std::max<size_t>(4, (64u << 20) / size)));
+
+        std::printf("%10zu", size);
+        double ns = Bench::BestNs(3, std::max(1, iterations / 8), [&]() {
+            Bench::KeepAlive(ReferenceBase64Encode(input));
+        });
+        std::printf(" %7.0f MB/s", size / ns * 1e3);
+        for (const char* kernel : {"scalar", "ssse3", "avx2"}) {
+            if (!Base64::EncodeWithKernel(kernel, input.data(), size, &out[0])) {
+                std::printf(" %12s", "-");
+                continue;
+            }
+            ns = Bench::BestNs(3, iterations, [&]() {
+                Base64::EncodeWithKernel(kernel, input.data(), size, &out[0]);
+                Bench::KeepAlive(out);
+            });
+            std::printf(" %7.0f MB/s", size / ns * 1e3);
+        }
+        std::printf("\n");
+    }
+    return 0;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+
+// Shared by the benchmarks in this directory: times a piece of code and
+// reports the fastest of several runs, which is the least disturbed by
+// whatever else the machine is doing.
+namespace Bench {
+
+// Keeps the compiler from dropping a computation whose result is unused.
+template <typename T>
+inline void KeepAlive(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "g"(&value) : "memory");
+#else
+    static volatile const T* sink;
+    sink = &value;
+#endif
+}
+
+// Nanoseconds per call of fn, best of `runs` runs of `iterations` calls each.
+template <typename Fn>
+double BestNs(int runs, int iterations, Fn&& fn) {
+    double best = 0.0;
+    for (int run = 0; run < runs; ++run) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            fn();
+        }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+                    iterations;
+        best = run == 0 ? ns : std::min(best, ns);
+    }
+    return best;
+}
+
+// Scale for quick runs: BENCH_SCALE=0.1 does a tenth of the iterations.
+inline int Iterations(int iterations) {
+    const char* scale = std::getenv("BENCH_SCALE");
+    double factor = scale ? std::atof(scale) : 1.0;
+    return std::max(1, static_cast<int>(iterations * (factor > 0.0 ? factor : 1.0)));
+}
+
+} // namespace Bench
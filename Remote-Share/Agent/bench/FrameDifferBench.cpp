@@ -0,0 +1,88 @@
+// FrameDiffer::Diff at 1080p and 4K: a static frame (the common case, and the
+// one that decides idle CPU), one changed tile, a changed frame, and a
+// checkerboard of dirty tiles that makes the most rectangles.
+#include "Bench.hpp"
+#include "FrameDiffer.hpp"
+
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+struct Size {
+    int width;
+    int height;
+};
+
+// Flips one byte in each tile whose (tx + ty) is even.
+void Checkerboard(std::vector<uint8_t>& pixels, int width, int height, int stride, int tileSize) {
+    for (int ty = 0; ty * tileSize < height; ++ty) {
+        for (int tx = (ty & 1); tx * tileSize < width; tx += 2) {
+            pixels[static_cast<size_t>(ty * tileSize) * stride + static_cast<size_t>(tx * tileSize) * 3] ^= 0xFF;
+        }
+    }
+}
+
+void Run(const Size& size) {
+    const int stride = ((size.width * 3 + 3) / 4) * 4;
+    std::vector<uint8_t> pixels(static_cast<size_t>(stride) * size.height);
+    for (size_t i = 0; i < pixels.size(); ++i) {
+        pixels[i] = static_cast<uint8_t>(i * 7);
+    }
+    FrameView view;
+    view.data = pixels.data();
+    view.width = size.width;
+    view.height = size.height;
+    view.stride = stride;
+    view.format = PixelFormat::BGR24;
+
+    FrameDiffer differ;
+    std::vector<FrameRect> rects;
+    differ.Diff(view, rects);  // reference
+    const double frameBytes = static_cast<double>(size.width) * size.height * 3;
+    const int iterations = Bench::Iterations(size.width > 2000 ? 50 : 200);
+
+    double staticNs = Bench::BestNs(5, iterations, [&]() {
+        Bench::KeepAlive(differ.Diff(view, rects));
+    });
+    // Both the frame and the reference are read once.
+    std::printf("%dx%d  static       %8.0f us  %5.1f GB/s read\n", size.width, size.height, staticNs / 1e3,
+                2 * frameBytes / staticNs);
+
+    size_t middle = static_cast<size_t>(size.height / 2) * stride + static_cast<size_t>(size.width / 2) * 3;
+    double tileNs = Bench::BestNs(5, iterations, [&]() {
+        pixels[middle] ^= 0xFF;
+        Bench::KeepAlive(differ.Diff(view, rects));
+    });
+    std::printf("%dx%d  one tile     %8.0f us\n", size.width, size.height, tileNs / 1e3);
+
+    double fullNs = Bench::BestNs(5, iterations / 4 + 1, [&]() {
+        for (int y = 0; y < size.height; y += 16) {
+            for (int x = 0; x < size.width; x += 16) {
+                pixels[static_cast<size_t>(y) * stride + static_cast<size_t>(x) * 3] ^= 0xFF;
+            }
+        }
+        Bench::KeepAlive(differ.Diff(view, rects));
+    });
+    std::printf("%dx%d  every tile   %8.0f us\n", size.width, size.height, fullNs / 1e3);
+
+    size_t checkerRects = 0;
+    double checkerNs = Bench::BestNs(5, iterations / 4 + 1, [&]() {
+        Checkerboard(pixels, size.width, size.height, stride, differ.TileSize());
+        differ.Diff(view, rects);
+        checkerRects = rects.size();
+    });
+    std::printf("%dx%d  checkerboard %8.0f us  %zu rects\n", size.width, size.height, checkerNs / 1e3,
+                checkerRects);
+}
+
+} // namespace
+
+int main() {
+    std::printf("kernel: %s\n", FrameDiffer::KernelName());
+    const Size sizes[] = {{1920, 1080}, {3840, 2160}};
+    for (const Size& size : sizes) {
+        Run(size);
+    }
+    return 0;
+}
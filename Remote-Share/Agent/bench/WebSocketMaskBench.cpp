@@ -0,0 +1,73 @@
+// Payload masking throughput in the vendored websocketpp: the byte loop the
+// send path used to take, the word loop the SIMD kernels replaced, each
+// kernel, and word_mask_exact as dispatched, over payload sizes from an
+// input record to a 4K keyframe and at aligned and odd offsets.
+#include "Bench.hpp"
+#include "CpuFeatures.hpp"
+#include "ReferenceMask.hpp"
+
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+namespace frame = websocketpp::frame;
+
+void Row(size_t size, size_t offset, frame::masking_key_type key) {
+    std::vector<uint8_t> input(size + 64, 0x5A);
+    std::vector<uint8_t> output(size + 64);
+    const uint8_t* in = input.data() + offset;
+    uint8_t* out = output.data() + offset;
+    int iterations = Bench::Iterations(static_cast<int>(std::max<size_t>(8, (256u << 20) / (size + 64))));
+    auto gbps = [&](double ns) { return size / ns; };
+
+    std::printf("%9zu %3zu", size, offset);
+    double ns = Bench::BestNs(3, std::max(1, iterations / 16), [&]() {
+        frame::byte_mask(input.begin() + offset, input.begin() + offset + size, output.begin() + offset, key);
+        Bench::KeepAlive(output);
+    });
+    std::printf(" %8.2f", gbps(ns));
+    ns = Bench::BestNs(3, iterations, [&]() {
+        ReferenceWordMask(in, out, size, key);
+        Bench::KeepAlive(output);
+    });
+    std::printf(" %8.2f", gbps(ns));
+#ifdef _WEBSOCKETPP_SIMD_MASK_
+    const frame::simd::mask_kernel kernels[] = {frame::simd::mask_sse2, frame::simd::mask_avx2};
+    const bool available[] = {GetCpuFeatures().sse2, GetCpuFeatures().avx2};
+    for (size_t k = 0; k < 2; ++k) {
+        if (!available[k]) {
+            std::printf(" %8s", "-");
+            continue;
+        }
+        // Kernel only: the bulk of the buffer, no tail.
+        ns = Bench::BestNs(3, iterations, [&]() {
+            Bench::KeepAlive(kernels[k](in, out, size, key.i));
+        });
+        std::printf(" %8.2f", gbps(ns));
+    }
+#else
+    std::printf(" %8s %8s", "-", "-");
+#endif
+    ns = Bench::BestNs(3, iterations, [&]() {
+        frame::word_mask_exact(in, out, size, key);
+        Bench::KeepAlive(output);
+    });
+    std::printf(" %8.2f\n", gbps(ns));
+}
+
+} // namespace
+
+int main() {
+    frame::masking_key_type key;
+    key.i = 0x9A3B5CD7;
+    std::printf("GB/s, copy and mask into a separate buffer\n");
+    std::printf("%9s %3s %8s %8s %8s %8s %8s\n", "bytes", "off", "byte", "word", "sse2", "avx2", "exact");
+    const size_t sizes[] = {56, 1024, 16 * 1024, 64 * 1024, 400 * 1024, 4 * 1024 * 1024};
+    for (size_t size : sizes) {
+        for (size_t offset : {0u, 1u, 3u}) {
+            Row(size, offset, key);
+        }
+    }
+    return 0;
+}
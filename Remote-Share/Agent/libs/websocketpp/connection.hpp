@@ -90,6 +90,15 @@ typedef lib::function<void(connection_hdl)> fail_handler;
  */
 typedef lib::function<void(connection_hdl)> interrupt_handler;
 
+/// The type and function signature of a drain handler
+/**
+ * The drain handler is called when a transport write completes and leaves no
+ * further messages queued for writing. Applications can use it to feed large
+ * payloads to the connection a piece at a time, so that messages sent in the
+ * meantime only wait for the piece being written.
+ */
+typedef lib::function<void(connection_hdl)> drain_handler;
+
 /// The type and function signature of a ping handler
 /**
  * The ping handler is called when the connection receives a WebSocket ping
@@ -433,6 +442,17 @@ public:
         m_interrupt_handler = h;
     }
 
+    /// Set drain handler
+    /**
+     * The drain handler is called whenever a write finishes with the outgoing
+     * message queue empty.
+     *
+     * @param h The new drain_handler
+     */
+    void set_drain_handler(drain_handler h) {
+        m_drain_handler = h;
+    }
+
     /// Set http handler
     /**
      * The http handler is called after an HTTP request other than a WebSocket
@@ -1507,6 +1527,7 @@ private:
     pong_handler            m_pong_handler;
     pong_timeout_handler    m_pong_timeout_handler;
     interrupt_handler       m_interrupt_handler;
+    drain_handler           m_drain_handler;
     http_handler            m_http_handler;
     validate_handler        m_validate_handler;
     message_handler         m_message_handler;
@@ -1924,6 +1924,8 @@ void connection<config>::handle_write_frame(lib::error_code const & ec)
             &type::write_frame,
             type::get_shared()
         ));
+    } else if (m_drain_handler) {
+        m_drain_handler(m_connection_hdl);
     }
 }
 
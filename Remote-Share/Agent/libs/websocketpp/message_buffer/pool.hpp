@@ -25,172 +25,298 @@
  *
  */
 
-#ifndef WEBSOCKETPP_MESSAGE_BUFFER_ALLOC_HPP
-#define WEBSOCKETPP_MESSAGE_BUFFER_ALLOC_HPP
+#ifndef WEBSOCKETPP_MESSAGE_BUFFER_POOL_HPP
+#define WEBSOCKETPP_MESSAGE_BUFFER_POOL_HPP
 
 #include <websocketpp/common/memory.hpp>
+#include <websocketpp/common/thread.hpp>
+#include <websocketpp/frame.hpp>
 
-#include <string>
+#include <cstddef>
+#include <new>
+#include <vector>
 
 namespace websocketpp {
 namespace message_buffer {
+namespace pool {
 
-/* # message:
- * object that stores a message while it is being sent or received. Contains
- * the message payload itself, the message header, the extension data, and the
- * opcode.
- *
- * # connection_message_manager:
- * An object that manages all of the message_buffers associated with a given
- * connection. Implements the get_message_buffer(size) method that returns
- * a message buffer at least size bytes long.
- *
- * Message buffers are reference counted with shared ownership semantics. Once
- * requested from the manager the requester and it's associated downstream code
- * may keep a pointer to the message indefinitely at a cost of extra resource
- * usage. Once the reference count drops to the point where the manager is the
- * only reference the messages is recycled using whatever method is implemented
- * in the manager.
- *
- * # endpoint_message_manager:
- * An object that manages connection_message_managers. Implements the
- * get_message_manager() method. This is used once by each connection to
- * request the message manager that they are supposed to use to manage message
- * buffers for their own use.
- *
- * TYPES OF CONNECTION_MESSAGE_MANAGERS
- * - allocate a message with the exact size every time one is requested
- * - maintain a pool of pre-allocated messages and return one when needed.
- *   Recycle previously used messages back into the pool
- *
- * TYPES OF ENDPOINT_MESSAGE_MANAGERS
- *  - allocate a new connection manager for each connection. Message pools
- *    become connection specific. This increases memory usage but improves
- *    concurrency.
- *  - allocate a single connection manager and share a pointer to it with all
- *    connections created by this endpoint. The message pool will be shared
- *    among all connections, improving memory usage and performance at the cost
- *    of reduced concurrency
- */
-
-/// Custom deleter for use in shared_ptrs to message.
+/// A thread safe free list of equally sized raw memory blocks
 /**
- * This is used to catch messages about to be deleted and offer the manager the
- * ability to recycle them instead. Message::recycle will return true if it was
- * successfully recycled and false otherwise. In the case of exceptions or error
- * this deleter frees the memory.
+ * Used to recycle the shared_ptr control blocks of pooled messages. The block
+ * size is fixed by the first block returned; blocks of any other size are
+ * passed straight to the global allocator.
  */
-template <typename T>
-void message_deleter(T* msg) {
-    try {
-        if (!msg->recycle()) {
-            delete msg;
+class block_cache {
+public:
+    static size_t const max_blocks = 64;
+
+    block_cache() : m_block_size(0) {
+        m_free.reserve(max_blocks);
+    }
+
+    ~block_cache() {
+        for (size_t i = 0; i < m_free.size(); ++i) {
+            ::operator delete(m_free[i]);
+        }
+    }
+
+    void * allocate(size_t size) {
+        {
+            lib::lock_guard<lib::mutex> lock(m_lock);
+            if (size == m_block_size && !m_free.empty()) {
+                void * block = m_free.back();
+                m_free.pop_back();
+                return block;
+            }
+        }
+        return ::operator new(size);
+    }
+
+    void deallocate(void * block, size_t size) {
+        {
+            lib::lock_guard<lib::mutex> lock(m_lock);
+            if (m_block_size == 0) {
+                m_block_size = size;
+            }
+            if (size == m_block_size && m_free.size() < max_blocks) {
+                m_free.push_back(block);
+                return;
+            }
         }
-    } catch (...) {
-        // TODO: is there a better way to ensure this function doesn't throw?
-        delete msg;
+        ::operator delete(block);
     }
-}
+private:
+    block_cache(block_cache const &);
+    block_cache & operator=(block_cache const &);
 
-/// Represents a buffer for a single WebSocket message.
+    lib::mutex              m_lock;
+    std::vector<void *>     m_free;
+    size_t                  m_block_size;
+};
+
+/// Allocator that draws from a shared block_cache
 /**
- *
- *
+ * Every copy shares ownership of the cache, so a control block can be
+ * returned to it even after the manager that created the cache is gone.
  */
-template <typename con_msg_manager>
-class message {
+template <typename T>
+class block_allocator {
 public:
-    typedef lib::shared_ptr<message> ptr;
+    typedef T value_type;
 
-    typedef typename con_msg_manager::weak_ptr con_msg_man_ptr;
+    explicit block_allocator(lib::shared_ptr<block_cache> const & cache)
+      : m_cache(cache) {}
 
-    message(con_msg_man_ptr manager, size_t size = 128)
-      : m_manager(manager)
-      , m_payload(size) {}
+    template <typename U>
+    block_allocator(block_allocator<U> const & other)
+      : m_cache(other.get_cache()) {}
 
-    frame::opcode::value get_opcode() const {
-        return m_opcode;
+    T * allocate(size_t n) {
+        return static_cast<T *>(m_cache->allocate(n * sizeof(T)));
     }
-    const std::string& get_header() const {
-        return m_header;
-    }
-    const std::string& get_extension_data() const {
-        return m_extension_data;
+
+    void deallocate(T * p, size_t n) {
+        m_cache->deallocate(p, n * sizeof(T));
     }
-    const std::string& get_payload() const {
-        return m_payload;
+
+    lib::shared_ptr<block_cache> const & get_cache() const {
+        return m_cache;
     }
 
-    /// Recycle the message
-    /**
-     * A request to recycle this message was received. Forward that request to
-     * the connection message manager for processing. Errors and exceptions
-     * from the manager's recycle member function should be passed back up the
-     * call chain. The caller to message::recycle will deal with them.
-     *
-     * Recycle must *only* be called by the message shared_ptr's destructor.
-     * Once recycled successfully, ownership of the memory has been passed to
-     * another system and must not be accessed again.
-     *
-     * @return true if the message was successfully recycled, false otherwise.
-     */
-    bool recycle() {
-        typename con_msg_manager::ptr shared = m_manager.lock();
+    template <typename U>
+    bool operator==(block_allocator<U> const & other) const {
+        return m_cache == other.get_cache();
+    }
 
-        if (shared) {
-            return shared->(recycle(this));
-        } else {
-            return false;
-        }
+    template <typename U>
+    bool operator!=(block_allocator<U> const & other) const {
+        return m_cache != other.get_cache();
     }
 private:
-    con_msg_man_ptr             m_manager;
-
-    frame::opcode::value        m_opcode;
-    std::string                 m_header;
-    std::string                 m_extension_data;
-    std::string                 m_payload;
+    lib::shared_ptr<block_cache> m_cache;
 };
 
-namespace alloc {
+/// shared_ptr deleter that offers a message back to its manager
+/**
+ * Messages the manager declines, or whose manager no longer exists, are
+ * freed.
+ */
+struct message_deleter {
+    template <typename message>
+    void operator()(message * msg) const {
+        bool recycled = false;
+        try {
+            recycled = msg->recycle();
+        } catch (...) {}
 
-/// A connection message manager that allocates a new message for each
-/// request.
+        if (!recycled) {
+            delete msg;
+        }
+    }
+};
+
+/// A connection message manager that recycles messages through a pool
+/**
+ * Released messages keep the capacity of their payload string and are kept
+ * on one of a set of free lists, one per power of two payload capacity from
+ * 1 KiB to 16 MiB. A request is served from the smallest list holding a
+ * message whose payload already has room for it, so once the pool has warmed
+ * up sending and receiving messages of a steady size does not allocate. The
+ * shared_ptr control blocks are recycled as well.
+ *
+ * Each list holds at most max_per_class messages; messages beyond that, or
+ * with payloads larger than the largest class, are freed when released.
+ */
 template <typename message>
-class con_msg_manager {
+class con_msg_manager
+  : public lib::enable_shared_from_this<con_msg_manager<message> >
+{
 public:
+    typedef con_msg_manager<message> type;
     typedef lib::shared_ptr<con_msg_manager> ptr;
     typedef lib::weak_ptr<con_msg_manager> weak_ptr;
 
     typedef typename message::ptr message_ptr;
 
-    /// Get a message buffer with specified size
+    /// log2 of the payload capacity limit of the smallest class
+    static size_t const min_class_bits = 10;
+    /// Number of size classes
+    static size_t const class_count = 15;
+    /// Most messages kept on each free list
+    static size_t const max_per_class = 8;
+
+    con_msg_manager() : m_cache(lib::make_shared<block_cache>()) {
+        for (size_t i = 0; i < class_count; ++i) {
+            m_free[i].reserve(max_per_class);
+        }
+    }
+
+    ~con_msg_manager() {
+        for (size_t i = 0; i < class_count; ++i) {
+            for (size_t j = 0; j < m_free[i].size(); ++j) {
+                delete m_free[i][j];
+            }
+        }
+    }
+
+    /// Get an empty message buffer
+    /**
+     * Messages requested without a size are mostly outgoing frames that the
+     * protocol processor is about to fill with a whole data message, so this
+     * prefers the largest message in the pool.
+     *
+     * @return A shared pointer to an empty message
+     */
+    message_ptr get_message() {
+        message * msg = NULL;
+        {
+            lib::lock_guard<lib::mutex> lock(m_lock);
+            for (size_t i = class_count; i-- > 0;) {
+                if (!m_free[i].empty()) {
+                    msg = m_free[i].back();
+                    m_free[i].pop_back();
+                    break;
+                }
+            }
+        }
+
+        if (!msg) {
+            msg = new message(type::shared_from_this());
+        }
+        return wrap(msg);
+    }
+
+    /// Get a message buffer with specified size and opcode
     /**
+     * @param op The opcode to use
      * @param size Minimum size in bytes to request for the message payload.
      *
-     * @return A shared pointer to a new message with specified size.
+     * @return A shared pointer to a message with room for size payload bytes
      */
-    message_ptr get_message(size_t size) const {
-        return lib::make_shared<message>(size);
+    message_ptr get_message(frame::opcode::value op, size_t size) {
+        message * msg = take(size);
+
+        if (msg) {
+            msg->set_opcode(op);
+        } else {
+            msg = new message(type::shared_from_this(),op,size);
+        }
+        return wrap(msg);
     }
 
     /// Recycle a message
     /**
-     * This method shouldn't be called. If it is, return false to indicate an
-     * error. The rest of the method recycle chain should notice this and free
-     * the memory.
+     * Called from the message's shared_ptr deleter once the last reference is
+     * gone. Resets the message and keeps it for reuse if there is room.
      *
      * @param msg The message to be recycled.
      *
-     * @return true if the message was successfully recycled, false otherwse.
+     * @return true if the message was kept, false if the caller must free it.
      */
     bool recycle(message * msg) {
-        return false;
+        std::string & payload = msg->get_raw_payload();
+        size_t index = class_index(payload.capacity());
+        if (index >= class_count) {
+            return false;
+        }
+
+        payload.clear();
+        msg->set_header(std::string());
+        msg->set_prepared(false);
+        msg->set_fin(true);
+        msg->set_terminal(false);
+        msg->set_compressed(false);
+
+        lib::lock_guard<lib::mutex> lock(m_lock);
+        if (m_free[index].size() >= max_per_class) {
+            return false;
+        }
+        m_free[index].push_back(msg);
+        return true;
+    }
+private:
+    /// Index of the smallest class whose capacity limit is at least size
+    static size_t class_index(size_t size) {
+        size_t index = 0;
+        while (index < class_count &&
+            size > (size_t(1) << (min_class_bits + index)))
+        {
+            ++index;
+        }
+        return index;
+    }
+
+    /// Remove and return a pooled message with room for size bytes, or NULL
+    message * take(size_t size) {
+        size_t first = class_index(size);
+
+        lib::lock_guard<lib::mutex> lock(m_lock);
+        for (size_t i = first; i < class_count; ++i) {
+            std::vector<message *> & list = m_free[i];
+            for (size_t j = list.size(); j-- > 0;) {
+                // only the first class can hold messages that are too small
+                if (i > first || list[j]->get_payload().capacity() >= size) {
+                    message * msg = list[j];
+                    list[j] = list.back();
+                    list.pop_back();
+                    return msg;
+                }
+            }
+        }
+        return NULL;
     }
+
+    message_ptr wrap(message * msg) {
+        return message_ptr(msg, message_deleter(),
+            block_allocator<message>(m_cache));
+    }
+
+    lib::mutex                      m_lock;
+    std::vector<message *>          m_free[class_count];
+    lib::shared_ptr<block_cache>    m_cache;
 };
 
-/// An endpoint message manager that allocates a new manager for each
-/// connection.
+/// An endpoint message manager that allocates a new pool for each connection
 template <typename con_msg_manager>
 class endpoint_msg_manager {
 public:
@@ -201,29 +327,12 @@ public:
      * @return A pointer to the requested connection message manager.
      */
     con_msg_man_ptr get_manager() const {
-        return lib::make_shared<con_msg_manager>();
+        return con_msg_man_ptr(lib::make_shared<con_msg_manager>());
     }
 };
 
-} // namespace alloc
-
-namespace pool {
-
-/// A connection messages manager that maintains a pool of messages that is
-/// used to fulfill get_message requests.
-class con_msg_manager {
-
-};
-
-/// An endpoint manager that maintains a shared pool of connection managers
-/// and returns an appropriate one for the requesting connection.
-class endpoint_msg_manager {
-
-};
-
 } // namespace pool
-
 } // namespace message_buffer
 } // namespace websocketpp
 
-#endif // WEBSOCKETPP_MESSAGE_BUFFER_ALLOC_HPP
+#endif // WEBSOCKETPP_MESSAGE_BUFFER_POOL_HPP
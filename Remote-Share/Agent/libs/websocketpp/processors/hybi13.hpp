@@ -961,8 +961,9 @@ protected:
     void masked_copy (std::string const & i, std::string & o,
         frame::masking_key_type key) const
     {
-        frame::byte_mask(i.begin(),i.end(),o.begin(),key);
-        // TODO: SIMD masking
+        // o is already sized to hold i; mask straight from one to the other
+        frame::word_mask_exact(reinterpret_cast<uint8_t const *>(i.data()),
+            reinterpret_cast<uint8_t *>(&o[0]), i.size(), key);
     }
 
     /// Generic prepare control frame with opcode and payload.
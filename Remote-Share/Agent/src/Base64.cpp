@@ -0,0 +1,195 @@
+#include "Base64.hpp"
+#include "CpuFeatures.hpp"
+#include <string_view>
+
+#if defined(REMOTE_SHARE_X86)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+const char kAlphabet[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+    "abcdefghijklmnopqrstuvwxyz"
+    "0123456789+/";
+
+// Encodes whole 3-byte groups plus the padded tail.
+void EncodeTail(const uint8_t* in, size_t size, char* out) {
+    size_t i = 0;
+    for (; i + 3 <= size; i += 3) {
+        uint32_t v = (uint32_t(in[i]) << 16) | (uint32_t(in[i + 1]) << 8) | in[i + 2];
+        out[0] = kAlphabet[(v >> 18) & 0x3F];
+        out[1] = kAlphabet[(v >> 12) & 0x3F];
+        out[2] = kAlphabet[(v >> 6) & 0x3F];
+        out[3] = kAlphabet[v & 0x3F];
+        out += 4;
+    }
+    size_t rest = size - i;
+    if (rest == 1) {
+        uint32_t v = uint32_t(in[i]) << 16;
+        out[0] = kAlphabet[(v >> 18) & 0x3F];
+        out[1] = kAlphabet[(v >> 12) & 0x3F];
+        out[2] = '=';
+        out[3] = '=';
+    } else if (rest == 2) {
+        uint32_t v = (uint32_t(in[i]) << 16) | (uint32_t(in[i + 1]) << 8);
+        out[0] = kAlphabet[(v >> 18) & 0x3F];
+        out[1] = kAlphabet[(v >> 12) & 0x3F];
+        out[2] = kAlphabet[(v >> 6) & 0x3F];
+        out[3] = '=';
+    }
+}
+
+// A SIMD kernel encodes as many leading bytes as it can without reading past
+// the input and returns how many it consumed (always a multiple of 3).
+typedef size_t (*BulkEncodeFn)(const uint8_t* in, size_t size, char* out);
+
+size_t EncodeBulkNone(const uint8_t*, size_t, char*) {
+    return 0;
+}
+
+#if defined(REMOTE_SHARE_X86)
+// The vector kernels follow Wojciech Muła's approach: a byte shuffle spreads
+// each 3-byte group over 4 bytes, two multiplies move the four 6-bit fields
+// into place, and a 16-entry pshufb table maps each field to its ASCII range
+// with a single add.
+
+REMOTE_SHARE_TARGET("ssse3")
+inline __m128i SplitSextets128(__m128i in) {
+    in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    const __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+    const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+    const __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+    const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+    return _mm_or_si128(t1, t3);
+}
+
+REMOTE_SHARE_TARGET("ssse3")
+inline __m128i SextetsToAscii128(__m128i indices) {
+    __m128i result = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+    const __m128i less = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+    result = _mm_or_si128(result, _mm_and_si128(less, _mm_set1_epi8(13)));
+    const __m128i shiftLut = _mm_setr_epi8(
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+        '/' - 63, 'A', 0, 0);
+    result = _mm_shuffle_epi8(shiftLut, result);
+    return _mm_add_epi8(result, indices);
+}
+
+// 12 input bytes -> 16 characters per step; each load reads 16 bytes.
+REMOTE_SHARE_TARGET("ssse3")
+size_t EncodeBulkSsse3(const uint8_t* in, size_t size, char* out) {
+    size_t i = 0;
+    for (; i + 16 <= size; i += 12) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        v = SextetsToAscii128(SplitSextets128(v));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), v);
+        out += 16;
+    }
+    return i;
+}
+
+// 24 input bytes -> 32 characters per step. The two 12-byte groups are loaded
+// into separate lanes so the in-lane shuffle sees the same layout as SSSE3.
+REMOTE_SHARE_TARGET("avx2")
+size_t EncodeBulkAvx2(const uint8_t* in, size_t size, char* out) {
+    const __m256i shuffle = _mm256_set_epi8(
+        10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+        10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+    const __m256i shiftLut = _mm256_setr_epi8(
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+
+    size_t i = 0;
+    for (; i + 28 <= size; i += 24) {
+        __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + 12));
+        __m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+
+        v = _mm256_shuffle_epi8(v, shuffle);
+        const __m256i t0 = _mm256_and_si256(v, _mm256_set1_epi32(0x0fc0fc00));
+        const __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+        const __m256i t2 = _mm256_and_si256(v, _mm256_set1_epi32(0x003f03f0));
+        const __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+        const __m256i indices = _mm256_or_si256(t1, t3);
+
+        __m256i result = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+        const __m256i less = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+        result = _mm256_or_si256(result, _mm256_and_si256(less, _mm256_set1_epi8(13)));
+        result = _mm256_add_epi8(_mm256_shuffle_epi8(shiftLut, result), indices);
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), result);
+        out += 32;
+    }
+    return i;
+}
+#endif
+
+struct Base64Kernel {
+    BulkEncodeFn bulk;
+    const char* name;
+};
+
+Base64Kernel SelectBase64Kernel() {
+#if defined(REMOTE_SHARE_X86)
+    const CpuFeatures& cpu = GetCpuFeatures();
+    if (cpu.avx2) {
+        return {EncodeBulkAvx2, "avx2"};
+    }
+    if (cpu.ssse3) {
+        return {EncodeBulkSsse3, "ssse3"};
+    }
+#endif
+    return {EncodeBulkNone, "scalar"};
+}
+
+const Base64Kernel& GetBase64Kernel() {
+    static const Base64Kernel kernel = SelectBase64Kernel();
+    return kernel;
+}
+
+} // namespace
+
+namespace Base64 {
+
+void Encode(const uint8_t* in, size_t size, char* out) {
+    size_t done = GetBase64Kernel().bulk(in, size, out);
+    EncodeTail(in + done, size - done, out + done / 3 * 4);
+}
+
+void EncodeScalar(const uint8_t* in, size_t size, char* out) {
+    EncodeTail(in, size, out);
+}
+
+bool EncodeWithKernel(const char* kernel, const uint8_t* in, size_t size, char* out) {
+    std::string_view name(kernel);
+    BulkEncodeFn bulk = nullptr;
+    if (name == "scalar") {
+        bulk = EncodeBulkNone;
+    }
+#if defined(REMOTE_SHARE_X86)
+    const CpuFeatures& cpu = GetCpuFeatures();
+    if (name == "ssse3" && cpu.ssse3) {
+        bulk = EncodeBulkSsse3;
+    }
+    if (name == "avx2" && cpu.avx2) {
+        bulk = EncodeBulkAvx2;
+    }
+#endif
+    if (!bulk) {
+        return false;
+    }
+    size_t done = bulk(in, size, out);
+    EncodeTail(in + done, size - done, out + done / 3 * 4);
+    return true;
+}
+
+const char* KernelName() {
+    return GetBase64Kernel().name;
+}
+
+} // namespace Base64
@@ -0,0 +1,28 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Standard base64 (RFC 4648 alphabet, '=' padding) for the JSON frame path.
+// The encoder works in place on a buffer the caller has already sized, and
+// picks an SSSE3 or AVX2 kernel at runtime when the CPU has one.
+namespace Base64 {
+
+// Number of characters Encode() writes for size input bytes.
+inline size_t EncodedSize(size_t size) {
+    return (size + 2) / 3 * 4;
+}
+
+// Writes exactly EncodedSize(size) characters to out. No terminator.
+void Encode(const uint8_t* in, size_t size, char* out);
+
+// Same, forced onto the portable scalar kernel.
+void EncodeScalar(const uint8_t* in, size_t size, char* out);
+
+// Same, forced onto the named kernel, for tests and benchmarks. Returns false
+// (writing nothing) if this CPU or build does not have it.
+bool EncodeWithKernel(const char* kernel, const uint8_t* in, size_t size, char* out);
+
+// Name of the kernel Encode() uses on this CPU ("avx2", "ssse3", "scalar").
+const char* KernelName();
+
+} // namespace Base64
@@ -1,173 +1,212 @@
-#include "CaptureManager.hpp" 
-#include <iostream>      
-#include <stdexcept>     
-#include <algorithm>     
-#include <limits>        
-#include <vector>        
-#include <Windows.h>     
-
-CaptureManager::CaptureManager() {
-}
+#include "CaptureManager.hpp"
+#include <iostream>
+#include <stdexcept>
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <vector>
+#include <Windows.h>
 
-CaptureManager::~CaptureManager() {
-}
+namespace {
 
-std::vector<uint8_t> CaptureManager::CaptureFullScreen(int& outWidth, int& outHeight) {
-    return CapturePixelsInternal(NULL, outWidth, outHeight);
-}
+// GDI capture surface that keeps its screen DC, memory DC and bitmap alive
+// across frames. They are only recreated when the captured size changes.
+class GdiCaptureSurface : public CaptureSurface {
+public:
+    explicit GdiCaptureSurface(HWND hwnd) : m_hwnd(hwnd) {}
+    ~GdiCaptureSurface() override { Destroy(); }
 
-std::vector<uint8_t> CaptureManager::CaptureWindow(HWND hwnd, int& outWidth, int& outHeight) {
-    if (hwnd == NULL) {
-        std::cerr << "CaptureWindow called with NULL HWND. Using CaptureFullScreen instead." << std::endl;
-        return CaptureFullScreen(outWidth, outHeight);
-    }
-    return CapturePixelsInternal(hwnd, outWidth, outHeight);
-}
+    bool QueryGeometry(int& width, int& height) override {
+        if (m_hwnd == NULL) {
+            // For full screen capture, use the virtual screen dimensions
+            width = GetSystemMetrics(SM_CXVIRTUALSCREEN);
+            height = GetSystemMetrics(SM_CYVIRTUALSCREEN);
 
-std::vector<uint8_t> CaptureManager::CapturePixelsInternal(HWND hwnd, int& width, int& height) {
-    HDC hdcScreen = NULL;
-    HDC hdcCompatible = NULL;
-    HBITMAP hBitmap = NULL;
-    std::vector<uint8_t> pixels;
-    int x_src = 0, y_src = 0; 
-    
-    // Get screen DC first to get DPI information
-    hdcScreen = GetDC(NULL);
-    if (!hdcScreen) {
-        std::cerr << "GetDC(NULL) failed. Error: " << GetLastError() << std::endl;
-        return pixels;
-    }
+            // If virtual screen metrics fail, fall back to primary monitor
+            if (width <= 0 || height <= 0) {
+                width = GetSystemMetrics(SM_CXSCREEN);
+                height = GetSystemMetrics(SM_CYSCREEN);
+            }
 
-    // Get DPI information
-    const int dpiX = GetDeviceCaps(hdcScreen, LOGPIXELSX);
-    const int dpiY = GetDeviceCaps(hdcScreen, LOGPIXELSY);
-    
-    if (hwnd == NULL) { 
-        // For full screen capture, use the virtual screen dimensions
-        width = GetSystemMetrics(SM_CXVIRTUALSCREEN);
-        height = GetSystemMetrics(SM_CYVIRTUALSCREEN);
-        
-        // If virtual screen metrics fail, fall back to primary monitor
-        if (width <= 0 || height <= 0) {
-            width = GetSystemMetrics(SM_CXSCREEN);
-            height = GetSystemMetrics(SM_CYSCREEN);
+            m_xSrc = GetSystemMetrics(SM_XVIRTUALSCREEN);
+            m_ySrc = GetSystemMetrics(SM_YVIRTUALSCREEN);
+            return true;
         }
-        
-        x_src = GetSystemMetrics(SM_XVIRTUALSCREEN);
-        y_src = GetSystemMetrics(SM_YVIRTUALSCREEN);
-    } else { 
-        // Window capture logic remains the same
+
         RECT client_rect;
-        if (!GetClientRect(hwnd, &client_rect)) {
-            std::cerr << "GetClientRect failed for HWND: " << hwnd << ". Error: " << GetLastError() << std::endl;
-            ReleaseDC(NULL, hdcScreen);
-            return pixels; 
+        if (!GetClientRect(m_hwnd, &client_rect)) {
+            std::cerr << "GetClientRect failed for HWND: " << m_hwnd << ". Error: " << GetLastError() << std::endl;
+            return false;
         }
-        
+
         // First try to get window rect for screen coordinates
         RECT window_rect;
-        if (GetWindowRect(hwnd, &window_rect)) {
+        if (GetWindowRect(m_hwnd, &window_rect)) {
             width = window_rect.right - window_rect.left;
             height = window_rect.bottom - window_rect.top;
-            x_src = window_rect.left;
-            y_src = window_rect.top;
-        } 
+            m_xSrc = window_rect.left;
+            m_ySrc = window_rect.top;
+        }
         // Fallback to client area if window rect fails
         else {
             POINT points[2] = {
                 {client_rect.left, client_rect.top},
                 {client_rect.right, client_rect.bottom}
             };
-            if (MapWindowPoints(hwnd, NULL, points, 2)) {
+            if (MapWindowPoints(m_hwnd, NULL, points, 2)) {
                 width = points[1].x - points[0].x;
                 height = points[1].y - points[0].y;
-                x_src = points[0].x;
-                y_src = points[0].y;
+                m_xSrc = points[0].x;
+                m_ySrc = points[0].y;
             } else {
-                std::cerr << "Warning: Failed to map window points for HWND: " << hwnd << ". Using client area with screen position (0,0)" << std::endl;
+                std::cerr << "Warning: Failed to map window points for HWND: " << m_hwnd << ". Using client area with screen position (0,0)" << std::endl;
                 width = client_rect.right - client_rect.left;
                 height = client_rect.bottom - client_rect.top;
-                x_src = 0;
-                y_src = 0;
+                m_xSrc = 0;
+                m_ySrc = 0;
             }
         }
-        
-        // Get screen DC for window capture
-        // hdcScreen = GetDC(NULL);
-        // if (!hdcScreen) {
-        //     std::cerr << "GetDC(NULL) failed for window capture. Error: " << GetLastError() << std::endl;
-        //     return pixels;
-        // }
+        return true;
     }
 
-    hdcCompatible = CreateCompatibleDC(hdcScreen);
-    if (!hdcCompatible) {
-        std::cerr << "CreateCompatibleDC failed! Error: " << GetLastError() << std::endl;
-        ReleaseDC(NULL, hdcScreen);
-        return pixels;
-    }
-    
-    hBitmap = CreateCompatibleBitmap(hdcScreen, width, height);
-    if (!hBitmap) {
-        std::cerr << "CreateCompatibleBitmap failed! Error: " << GetLastError() << std::endl;
-        DeleteDC(hdcCompatible);
-        ReleaseDC(NULL, hdcScreen);
-        return pixels;
+    bool Rebuild(int width, int height) override {
+        Destroy();
+
+        m_hdcScreen = GetDC(NULL);
+        if (!m_hdcScreen) {
+            std::cerr << "GetDC(NULL) failed. Error: " << GetLastError() << std::endl;
+            return false;
+        }
+
+        m_hdcCompatible = CreateCompatibleDC(m_hdcScreen);
+        if (!m_hdcCompatible) {
+            std::cerr << "CreateCompatibleDC failed! Error: " << GetLastError() << std::endl;
+            Destroy();
+            return false;
+        }
+
+        m_hBitmap = CreateCompatibleBitmap(m_hdcScreen, width, height);
+        if (!m_hBitmap) {
+            std::cerr << "CreateCompatibleBitmap failed! Error: " << GetLastError() << std::endl;
+            Destroy();
+            return false;
+        }
+        m_oldBitmap = SelectObject(m_hdcCompatible, m_hBitmap);
+
+        if (m_hwnd == NULL) {
+            SetStretchBltMode(m_hdcCompatible, COLORONCOLOR);
+        }
+
+        // Set up the bitmap info header
+        m_bi = {0};
+        m_bi.biSize = sizeof(BITMAPINFOHEADER);
+        m_bi.biWidth = width;
+        m_bi.biHeight = -height;  // Negative height to ensure top-down DIB
+        m_bi.biPlanes = 1;
+        m_bi.biBitCount = 24;     // 24 bits per pixel (RGB)
+        m_bi.biCompression = BI_RGB;
+
+        m_width = width;
+        m_height = height;
+        return true;
     }
-    
-    HGDIOBJ oldBitmap = SelectObject(hdcCompatible, hBitmap);
-    
-    if (hwnd == NULL) { 
-        // Full screen capture with DPI awareness
-        SetStretchBltMode(hdcCompatible, COLORONCOLOR);
-        StretchBlt(hdcCompatible, 0, 0, width, height, 
-                  hdcScreen, x_src, y_src, width, height, 
-                  SRCCOPY);
-    } else { 
-        // Window capture logic remains the same
-        BOOL success = PrintWindow(hwnd, hdcCompatible, PW_CLIENTONLY);
-        if (!success) {
-            std::cerr << "PrintWindow failed for HWND: " << hwnd 
-                      << ". Falling back to BitBlt. Error: " << GetLastError() << std::endl;
-            BitBlt(hdcCompatible, 0, 0, width, height, hdcScreen, x_src, y_src, SRCCOPY);
+
+    bool Grab(uint8_t* dst, int stride) override {
+        if (m_hwnd == NULL) {
+            // Full screen capture with DPI awareness
+            StretchBlt(m_hdcCompatible, 0, 0, m_width, m_height,
+                       m_hdcScreen, m_xSrc, m_ySrc, m_width, m_height,
+                       SRCCOPY);
+        } else {
+            BOOL success = PrintWindow(m_hwnd, m_hdcCompatible, PW_CLIENTONLY);
+            if (!success) {
+                std::cerr << "PrintWindow failed for HWND: " << m_hwnd
+                          << ". Falling back to BitBlt. Error: " << GetLastError() << std::endl;
+                BitBlt(m_hdcCompatible, 0, 0, m_width, m_height, m_hdcScreen, m_xSrc, m_ySrc, SRCCOPY);
+            }
         }
+
+        // GetDIBits always writes rows padded to 4 bytes.
+        if (stride != ((m_width * 3 + 3) / 4) * 4) {
+            std::cerr << "Unexpected row pitch " << stride << " for a " << m_width << " pixel wide DIB" << std::endl;
+            return false;
+        }
+        if (!GetDIBits(m_hdcCompatible, m_hBitmap, 0, m_height, dst, (BITMAPINFO*)&m_bi, DIB_RGB_COLORS)) {
+            std::cerr << "GetDIBits failed! Error: " << GetLastError() << std::endl;
+            return false;
+        }
+        return true;
     }
-    
-    // Set up the bitmap info header
-    BITMAPINFOHEADER bi = {0};
-    bi.biSize = sizeof(BITMAPINFOHEADER);
-    bi.biWidth = width;
-    bi.biHeight = -height;  // Negative height to ensure top-down DIB
-    bi.biPlanes = 1;
-    bi.biBitCount = 24;     // 24 bits per pixel (RGB)
-    bi.biCompression = BI_RGB;
-    bi.biSizeImage = 0;
-    bi.biXPelsPerMeter = 0;
-    bi.biYPelsPerMeter = 0;
-    bi.biClrUsed = 0;
-    bi.biClrImportant = 0;
-    
-    // Calculate the required buffer size
-    int bytesPerPixel = 3;  // 24 bits = 3 bytes
-    int rowPitch = ((width * bytesPerPixel + 3) / 4) * 4;  // Align to 4 bytes
-    pixels.resize(static_cast<size_t>(rowPitch) * height);
-    
-    // Get the pixel data
-    if (!GetDIBits(hdcCompatible, hBitmap, 0, height, pixels.data(), (BITMAPINFO*)&bi, DIB_RGB_COLORS)) {
-        std::cerr << "GetDIBits failed! Error: " << GetLastError() << std::endl;
-        pixels.clear();
+
+    PixelFormat Format() const override { return PixelFormat::BGR24; }
+
+private:
+    void Destroy() {
+        if (m_hdcCompatible && m_oldBitmap) {
+            SelectObject(m_hdcCompatible, m_oldBitmap);
+        }
+        if (m_hBitmap) {
+            DeleteObject(m_hBitmap);
+        }
+        if (m_hdcCompatible) {
+            DeleteDC(m_hdcCompatible);
+        }
+        if (m_hdcScreen) {
+            ReleaseDC(NULL, m_hdcScreen);
+        }
+        m_oldBitmap = NULL;
+        m_hBitmap = NULL;
+        m_hdcCompatible = NULL;
+        m_hdcScreen = NULL;
     }
-    
-    // Clean up
-    if (hBitmap) {
-        DeleteObject(hBitmap);
+
+    HWND m_hwnd;
+    HDC m_hdcScreen = NULL;
+    HDC m_hdcCompatible = NULL;
+    HBITMAP m_hBitmap = NULL;
+    HGDIOBJ m_oldBitmap = NULL;
+    BITMAPINFOHEADER m_bi = {0};
+    int m_width = 0, m_height = 0;
+    int m_xSrc = 0, m_ySrc = 0;
+};
+
+} // namespace
+
+CaptureManager::CaptureManager(size_t poolSlots)
+    : m_poolSlots(poolSlots) {
+}
+
+CaptureManager::~CaptureManager() {
+}
+
+PooledFrame CaptureManager::CaptureFullScreen() {
+    return CapturePixelsInternal(NULL);
+}
+
+PooledFrame CaptureManager::CaptureWindow(HWND hwnd) {
+    if (hwnd == NULL) {
+        std::cerr << "CaptureWindow called with NULL HWND. Using CaptureFullScreen instead." << std::endl;
+        return CaptureFullScreen();
     }
-    if (hdcCompatible) {
-        DeleteDC(hdcCompatible);
+    return CapturePixelsInternal(hwnd);
+}
+
+PooledFrame CaptureManager::Capture() {
+    HWND target = m_target.load();
+    return target == NULL ? CaptureFullScreen() : CaptureWindow(target);
+}
+
+PooledFrame CaptureManager::CapturePixelsInternal(HWND hwnd) {
+    std::unique_ptr<CaptureSurface> surface;
+    if (!m_session || hwnd != m_sessionTarget) {
+        surface.reset(new GdiCaptureSurface(hwnd));
+        m_sessionTarget = hwnd;
     }
-    if (hdcScreen) {
-        ReleaseDC(NULL, hdcScreen);
+    if (!m_session) {
+        m_session.reset(new CaptureSession(std::move(surface), m_poolSlots));
+    } else if (surface) {
+        m_session->SetSurface(std::move(surface));
     }
-    
-    return pixels;
-}
\ No newline at end of file
+
+    return m_session->Capture();
+}
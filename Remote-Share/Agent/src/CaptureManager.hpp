@@ -1,13 +1,31 @@
-#pragma once 
+#pragma once
+#include <atomic>
 #include <vector>
-#include <cstdint> 
-#include <Windows.h> 
-class CaptureManager {
+#include <cstdint>
+#include <memory>
+#include <Windows.h>
+#include "CaptureSession.hpp"
+#include "FrameSource.hpp"
+class CaptureManager : public FrameSource {
 public:
-    CaptureManager();
+    // poolSlots is how many captured frames may be alive at once; a pipeline
+    // that keeps frames queued between stages needs more than the default.
+    explicit CaptureManager(size_t poolSlots = 3);
     ~CaptureManager();
-    std::vector<uint8_t> CaptureFullScreen(int& outWidth, int& outHeight);
-    std::vector<uint8_t> CaptureWindow(HWND hwnd, int& outWidth, int& outHeight);
+    PooledFrame CaptureFullScreen();
+    PooledFrame CaptureWindow(HWND hwnd);
+
+    // What Capture() grabs; NULL shares the full screen. Safe from any thread.
+    void SetTarget(HWND hwnd) { m_target.store(hwnd); }
+    HWND Target() const { return m_target.load(); }
+
+    PooledFrame Capture() override;
 private:
-    std::vector<uint8_t> CapturePixelsInternal(HWND hwnd, int& width, int& height);
-};
\ No newline at end of file
+    PooledFrame CapturePixelsInternal(HWND hwnd);
+    // One session for the lifetime of the manager; its surface is swapped
+    // whenever the capture target changes.
+    std::unique_ptr<CaptureSession> m_session;
+    HWND m_sessionTarget = NULL;
+    size_t m_poolSlots;
+    std::atomic<HWND> m_target{NULL};
+};
@@ -0,0 +1,50 @@
+#include "CaptureSession.hpp"
+#include <chrono>
+#include <iostream>
+#include <utility>
+
+CaptureSession::CaptureSession(std::unique_ptr<CaptureSurface> surface, size_t poolSlots)
+    : m_surface(std::move(surface)), m_pool(poolSlots) {
+}
+
+void CaptureSession::SetSurface(std::unique_ptr<CaptureSurface> surface) {
+    m_surface = std::move(surface);
+    m_valid = false;
+}
+
+PooledFrame CaptureSession::Capture() {
+    int width = 0, height = 0;
+    if (!m_surface || !m_surface->QueryGeometry(width, height) || width <= 0 || height <= 0) {
+        return PooledFrame();
+    }
+
+    if (!m_valid || width != m_width || height != m_height) {
+        if (!m_surface->Rebuild(width, height)) {
+            std::cerr << "Failed to rebuild capture surface for " << width << "x" << height << std::endl;
+            m_valid = false;
+            return PooledFrame();
+        }
+        PixelFormat format = m_surface->Format();
+        int rowPitch = ((width * BytesPerPixel(format) + 3) / 4) * 4;  // Align to 4 bytes
+        m_pool.Configure(width, height, rowPitch, format);
+        m_width = width;
+        m_height = height;
+        m_valid = true;
+        ++m_rebuilds;
+    }
+
+    PooledFrame frame = m_pool.Acquire();
+    if (!frame) {
+        return frame;
+    }
+    if (!m_surface->Grab(frame.Data(), frame.Stride())) {
+        // Surfaces can go stale (display mode change, desktop switch); start
+        // from scratch on the next frame.
+        m_valid = false;
+        frame.Release();
+        return frame;
+    }
+    frame.SetTimestampUs(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count()));
+    return frame;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include "FramePool.hpp"
+
+// Platform-specific source of pixels (GDI screen/window, a fake in tests, ...).
+// A surface owns whatever device contexts or bitmaps it needs; the session only
+// asks it to rebuild them when the source geometry changes.
+class CaptureSurface {
+public:
+    virtual ~CaptureSurface() = default;
+
+    // Reports the current size of the source. Returns false if it is gone.
+    virtual bool QueryGeometry(int& width, int& height) = 0;
+
+    // (Re)creates the backing surfaces for the given size.
+    virtual bool Rebuild(int width, int height) = 0;
+
+    // Copies the current contents into dst, rows top-down, stride bytes apart.
+    virtual bool Grab(uint8_t* dst, int stride) = 0;
+
+    virtual PixelFormat Format() const = 0;
+};
+
+// Long-lived capture state for one source: keeps the surface and a pool of
+// frame buffers alive between frames and rebuilds them only on resize.
+class CaptureSession {
+public:
+    explicit CaptureSession(std::unique_ptr<CaptureSurface> surface, size_t poolSlots = 3);
+
+    // Grabs one frame into a pooled buffer. Returns an empty lease if the
+    // source is unavailable, the grab failed or every buffer is still in use.
+    PooledFrame Capture();
+
+    // Switches to a different source. The pool is kept, so frames leased
+    // from the previous surface stay valid.
+    void SetSurface(std::unique_ptr<CaptureSurface> surface);
+
+    // Number of times the surface was rebuilt (first frame included).
+    uint64_t RebuildCount() const { return m_rebuilds; }
+    const FramePool& Pool() const { return m_pool; }
+
+private:
+    std::unique_ptr<CaptureSurface> m_surface;
+    FramePool m_pool;
+    int m_width = 0;
+    int m_height = 0;
+    bool m_valid = false;
+    uint64_t m_rebuilds = 0;
+};
@@ -0,0 +1,25 @@
+#pragma once
+
+// Instruction set extensions available on the machine we are running on.
+// SIMD kernels are compiled for every level the compiler can target and pick
+// one at runtime from this, so one agent binary runs everywhere.
+struct CpuFeatures {
+    bool sse2 = false;
+    bool ssse3 = false;
+    bool avx2 = false;
+};
+
+// Detected once on first use.
+const CpuFeatures& GetCpuFeatures();
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define REMOTE_SHARE_X86 1
+#endif
+
+// Lets GCC/Clang compile a single function for a higher ISA level than the
+// rest of the translation unit. MSVC allows intrinsics anywhere.
+#if defined(REMOTE_SHARE_X86) && (defined(__GNUC__) || defined(__clang__))
+#define REMOTE_SHARE_TARGET(isa) __attribute__((target(isa)))
+#else
+#define REMOTE_SHARE_TARGET(isa)
+#endif
@@ -0,0 +1,110 @@
+#include "FrameClock.hpp"
+#include <algorithm>
+
+namespace {
+
+FrameClock::Clock::duration IntervalForRate(double fps) {
+    // Clamp to something sane so a bad setting cannot stall or spin the loop.
+    fps = std::min(std::max(fps, 0.1), 1000.0);
+    return std::chrono::duration_cast<FrameClock::Clock::duration>(std::chrono::duration<double>(1.0 / fps));
+}
+
+} // namespace
+
+FrameClock::FrameClock(double fps)
+    : m_interval(IntervalForRate(fps)) {
+}
+
+int FrameClock::WaitNextTick() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    Clock::time_point now = Clock::now();
+    ++m_stats.ticks;
+    if (!m_started) {
+        m_started = true;
+        m_wake = false;
+        m_lastTick = now;
+        return 0;
+    }
+
+    Clock::time_point deadline = m_lastTick + m_interval;
+    if (now >= deadline) {
+        // The caller's work ran past the deadline. Tick right away and drop
+        // the ticks that went by, keeping to the original grid.
+        ++m_stats.overruns;
+        m_wake = false;
+        int64_t skipped = (now - deadline) / m_interval;
+        m_stats.missedTicks += skipped;
+        m_lastTick = deadline + skipped * m_interval;
+        return static_cast<int>(skipped);
+    }
+
+    while (!m_wake && now < deadline) {
+        m_cv.wait_until(lock, deadline);
+        now = Clock::now();
+        // The rate may have changed while waiting.
+        deadline = m_lastTick + m_interval;
+    }
+
+    if (m_wake) {
+        // Woken early: tick now and start a new grid from here.
+        m_wake = false;
+        m_lastTick = now;
+        return 0;
+    }
+
+    double lateUs = std::chrono::duration<double, std::micro>(now - deadline).count();
+    m_jitterSumUs += lateUs;
+    ++m_jitterSamples;
+    m_stats.jitterMeanUs = m_jitterSumUs / m_jitterSamples;
+    m_stats.jitterMaxUs = std::max(m_stats.jitterMaxUs, lateUs);
+    m_lastTick = deadline;
+    return 0;
+}
+
+void FrameClock::SetRate(double fps) {
+    Clock::duration interval = IntervalForRate(fps);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (interval == m_interval) {
+        return;
+    }
+    bool faster = interval < m_interval;
+    m_interval = interval;
+    if (faster && m_started) {
+        // Time already spent waiting at the old rate is not an overrun at the
+        // new one: the next deadline is at the earliest now.
+        Clock::time_point earliest = Clock::now() - interval;
+        if (m_lastTick < earliest) {
+            m_lastTick = earliest;
+        }
+        // Re-evaluate a wait in progress against the shorter deadline.
+        m_cv.notify_all();
+    }
+}
+
+double FrameClock::Rate() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return 1.0 / std::chrono::duration<double>(m_interval).count();
+}
+
+void FrameClock::Wake() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_wake = true;
+    m_cv.notify_all();
+}
+
+void FrameClock::Reset() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_started = false;
+}
+
+FrameClockStats FrameClock::Stats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void FrameClock::ResetStats() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats = FrameClockStats();
+    m_jitterSamples = 0;
+    m_jitterSumUs = 0.0;
+}
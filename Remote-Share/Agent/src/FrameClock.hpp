@@ -0,0 +1,58 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+struct FrameClockStats {
+    uint64_t ticks = 0;
+    // Ticks where the caller came back after the deadline had already passed.
+    uint64_t overruns = 0;
+    // Ticks dropped because of overruns (never delivered late as a burst).
+    uint64_t missedTicks = 0;
+    // How late a timed wait woke up past its deadline.
+    double jitterMeanUs = 0.0;
+    double jitterMaxUs = 0.0;
+};
+
+// Paces a loop on absolute steady_clock deadlines, so the time spent working
+// between ticks does not stretch the period. When the caller overruns, the
+// ticks it missed are skipped and the clock stays on its original grid
+// instead of firing them back to back.
+//
+// The rate can change at any time from any thread. A faster rate takes effect
+// immediately, waking a wait in progress; a slower one applies from the
+// current deadline on.
+class FrameClock {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    explicit FrameClock(double fps = 30.0);
+
+    // Blocks until the next tick. Returns how many ticks were skipped.
+    int WaitNextTick();
+
+    void SetRate(double fps);
+    double Rate() const;
+
+    // Ends the current wait early, or makes the next one return at once.
+    void Wake();
+
+    // Forgets the schedule, e.g. after a long pause; the next tick is
+    // immediate.
+    void Reset();
+
+    FrameClockStats Stats() const;
+    void ResetStats();
+
+private:
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cv;
+    Clock::duration m_interval;
+    Clock::time_point m_lastTick;
+    bool m_started = false;
+    bool m_wake = false;
+    FrameClockStats m_stats;
+    uint64_t m_jitterSamples = 0;
+    double m_jitterSumUs = 0.0;
+};
@@ -0,0 +1,135 @@
+#include "FrameMessageWriter.hpp"
+#include "Base64.hpp"
+#include <charconv>
+#include <cstring>
+
+namespace {
+
+const char kDataUriPrefix[] = "data:image/jpeg;base64,";
+
+// First pass: adds up how many bytes the message will take.
+class SizeCounter {
+public:
+    void Raw(const char* text) { m_size += std::strlen(text); }
+    void Int(int64_t value) {
+        char digits[24];
+        m_size += std::to_chars(digits, digits + sizeof(digits), value).ptr - digits;
+    }
+    void Jpeg(const JpegBuffer& jpeg) { m_size += Base64::EncodedSize(jpeg.size); }
+
+    size_t Size() const { return m_size; }
+
+private:
+    size_t m_size = 0;
+};
+
+// Second pass: writes the same sequence into a buffer sized by SizeCounter.
+class BufferWriter {
+public:
+    explicit BufferWriter(char* out) : m_out(out) {}
+
+    void Raw(const char* text) {
+        size_t length = std::strlen(text);
+        std::memcpy(m_out, text, length);
+        m_out += length;
+    }
+    void Int(int64_t value) {
+        m_out = std::to_chars(m_out, m_out + 24, value).ptr;
+    }
+    void Jpeg(const JpegBuffer& jpeg) {
+        Base64::Encode(jpeg.Data(), jpeg.size, m_out);
+        m_out += Base64::EncodedSize(jpeg.size);
+    }
+
+private:
+    char* m_out;
+};
+
+// Each message layout is written once and run through both passes, so the
+// size and the bytes cannot disagree.
+template <typename Sink>
+void EmitKeyframe(Sink& out, uint32_t seq, int width, int height, const JpegBuffer& jpeg) {
+    out.Raw("{\"type\":\"frame\",\"seq\":");
+    out.Int(seq);
+    out.Raw(",\"keyframe\":true,\"image\":\"");
+    out.Raw(kDataUriPrefix);
+    out.Jpeg(jpeg);
+    out.Raw("\",\"width\":");
+    out.Int(width);
+    out.Raw(",\"height\":");
+    out.Int(height);
+    out.Raw("}");
+}
+
+template <typename Sink>
+void EmitDeltaFrame(Sink& out, uint32_t seq, int width, int height,
+                    const FrameRect* rects, const JpegBuffer* jpegs, size_t count) {
+    out.Raw("{\"type\":\"delta_frame\",\"seq\":");
+    out.Int(seq);
+    out.Raw(",\"width\":");
+    out.Int(width);
+    out.Raw(",\"height\":");
+    out.Int(height);
+    out.Raw(",\"rects\":[");
+    for (size_t i = 0; i < count; ++i) {
+        out.Raw(i == 0 ? "{\"x\":" : ",{\"x\":");
+        out.Int(rects[i].x);
+        out.Raw(",\"y\":");
+        out.Int(rects[i].y);
+        out.Raw(",\"w\":");
+        out.Int(rects[i].width);
+        out.Raw(",\"h\":");
+        out.Int(rects[i].height);
+        out.Raw(",\"image\":\"");
+        out.Raw(kDataUriPrefix);
+        out.Jpeg(jpegs[i]);
+        out.Raw("\"}");
+    }
+    out.Raw("]}");
+}
+
+// Creates a text message whose payload is exactly size bytes, ready to be
+// filled in place.
+client::message_ptr CreateSizedMessage(WebSocketClient& ws, size_t size, char*& data) {
+    client::message_ptr msg = ws.createMessage(websocketpp::frame::opcode::text, size);
+    if (msg) {
+        std::string& payload = msg->get_raw_payload();
+        payload.resize(size);
+        data = &payload[0];
+    }
+    return msg;
+}
+
+} // namespace
+
+namespace FrameMessageWriter {
+
+client::message_ptr WriteKeyframe(WebSocketClient& ws, uint32_t seq, int width, int height,
+                                  const JpegBuffer& jpeg) {
+    SizeCounter counter;
+    EmitKeyframe(counter, seq, width, height, jpeg);
+
+    char* data = nullptr;
+    client::message_ptr msg = CreateSizedMessage(ws, counter.Size(), data);
+    if (msg) {
+        BufferWriter writer(data);
+        EmitKeyframe(writer, seq, width, height, jpeg);
+    }
+    return msg;
+}
+
+client::message_ptr WriteDeltaFrame(WebSocketClient& ws, uint32_t seq, int width, int height,
+                                    const FrameRect* rects, const JpegBuffer* jpegs, size_t count) {
+    SizeCounter counter;
+    EmitDeltaFrame(counter, seq, width, height, rects, jpegs, count);
+
+    char* data = nullptr;
+    client::message_ptr msg = CreateSizedMessage(ws, counter.Size(), data);
+    if (msg) {
+        BufferWriter writer(data);
+        EmitDeltaFrame(writer, seq, width, height, rects, jpegs, count);
+    }
+    return msg;
+}
+
+} // namespace FrameMessageWriter
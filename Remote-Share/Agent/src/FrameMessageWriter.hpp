@@ -0,0 +1,29 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "FrameView.hpp"
+#include "JpegEncoderPool.hpp"
+#include "WebSocketClient.hpp"
+
+// Builds the JSON text frames ("frame" and "delta_frame", the same messages
+// the viewer has always understood) without intermediate strings. The exact
+// message size is worked out first; then the envelope and the base64 of each
+// JPEG are written straight into the payload of a websocketpp message sized
+// to match, which is what gets sent.
+//
+// Per frame that leaves one allocation of about 4/3 of the JPEG size; the
+// JPEG itself sits in a buffer the caller reuses from frame to frame.
+namespace FrameMessageWriter {
+
+// {"type":"frame","seq":..,"keyframe":true,"image":"data:image/jpeg;base64,..",
+//  "width":..,"height":..}
+client::message_ptr WriteKeyframe(WebSocketClient& ws, uint32_t seq, int width, int height,
+                                  const JpegBuffer& jpeg);
+
+// {"type":"delta_frame","seq":..,"width":..,"height":..,
+//  "rects":[{"x":..,"y":..,"w":..,"h":..,"image":"data:image/jpeg;base64,.."},..]}
+// jpegs[i] is the image for rects[i].
+client::message_ptr WriteDeltaFrame(WebSocketClient& ws, uint32_t seq, int width, int height,
+                                    const FrameRect* rects, const JpegBuffer* jpegs, size_t count);
+
+} // namespace FrameMessageWriter
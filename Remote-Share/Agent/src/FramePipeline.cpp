@@ -0,0 +1,392 @@
+#include "FramePipeline.hpp"
+#include "FrameMessageWriter.hpp"
+#include "FrameProtocol.hpp"
+#include "Trace.hpp"
+#include <iostream>
+
+namespace {
+
+// Longest a damage-driven capture thread sleeps before rechecking the
+// connection.
+const std::chrono::milliseconds kDamageWait(250);
+
+// A damage-reporting source covers the whole frame only when it read all of
+// it back, which is what a keyframe needs.
+bool CoversFrame(const PooledFrame& frame) {
+    const std::vector<FrameRect>& rects = frame.DirtyRects();
+    return rects.size() == 1 && rects[0].x == 0 && rects[0].y == 0 && rects[0].width == frame.Width() &&
+           rects[0].height == frame.Height();
+}
+
+void RecordEncoded(Metrics& metrics, const std::vector<FrameView>& views, const std::vector<JpegBuffer>& jpegs) {
+    uint64_t pixels = 0;
+    uint64_t bytes = 0;
+    for (size_t i = 0; i < views.size(); ++i) {
+        pixels += static_cast<uint64_t>(views[i].width) * views[i].height;
+        bytes += jpegs[i].size;
+    }
+    metrics.AddEncoded(pixels, bytes);
+}
+
+// The JSON flavour of a frame, for viewers without binary support. A
+// keyframe carries one image for the whole frame; a delta frame one image per
+// dirty rect (large rects banded so the pool can encode them in parallel).
+client::message_ptr BuildTextFrame(WebSocketClient& ws, Metrics& metrics, JpegEncoderPool& encoder, std::vector<JpegBuffer>& jpegs,
+                                   const FrameView& view, uint32_t seq, bool keyframe, int quality) {
+    std::vector<FrameRect> rects;
+    if (keyframe) {
+        FrameRect fullFrame;
+        fullFrame.width = view.width;
+        fullFrame.height = view.height;
+        rects.push_back(fullFrame);
+    } else {
+        for (size_t i = 0; i < view.dirtyCount; ++i) {
+            JpegEncoderPool::SplitIntoBands(view.dirtyRects[i], encoder.ThreadCount(), rects);
+        }
+    }
+
+    std::vector<FrameView> views;
+    views.reserve(rects.size());
+    for (const FrameRect& rect : rects) {
+        views.push_back(view.SubView(rect));
+    }
+    uint64_t start = Metrics::NowUs();
+    if (!encoder.CompressAll(views, quality, jpegs)) {
+        // A partial delta would leave the viewer with a torn image.
+        return client::message_ptr();
+    }
+    uint64_t encoded = metrics.RecordSince(Stage::Encode, start);
+    Trace::Complete("encode", start, encoded, "rects", views.size());
+    RecordEncoded(metrics, views, jpegs);
+
+    client::message_ptr msg = keyframe ?
+        FrameMessageWriter::WriteKeyframe(ws, seq, view.width, view.height, jpegs[0]) :
+        FrameMessageWriter::WriteDeltaFrame(ws, seq, view.width, view.height,
+                                            rects.data(), jpegs.data(), rects.size());
+    uint64_t framed = metrics.RecordSince(Stage::Framing, encoded);
+    Trace::Complete("framing", encoded, framed, "bytes", msg ? msg->get_payload().size() : 0);
+    return msg;
+}
+
+// A keyframe or delta frame as one binary message (see FrameProtocol.hpp).
+// Large rects are cut into bands so the encoder pool can compress them in
+// parallel. Bands are encoded into the recycled jpegs buffers and each is
+// copied once, into the outgoing message, with no base64 or JSON in between.
+client::message_ptr BuildBinaryFrame(WebSocketClient& ws, Metrics& metrics, JpegEncoderPool& encoder, std::vector<JpegBuffer>& jpegs,
+                                     const FrameView& view, uint32_t seq, bool keyframe, int quality) {
+    std::vector<FrameRect> rects;
+    if (keyframe) {
+        FrameRect fullFrame;
+        fullFrame.width = view.width;
+        fullFrame.height = view.height;
+        JpegEncoderPool::SplitIntoBands(fullFrame, encoder.ThreadCount(), rects);
+    } else {
+        for (size_t i = 0; i < view.dirtyCount; ++i) {
+            JpegEncoderPool::SplitIntoBands(view.dirtyRects[i], encoder.ThreadCount(), rects);
+        }
+    }
+    size_t rectCount = rects.size();
+
+    std::vector<FrameView> views;
+    views.reserve(rectCount);
+    for (const FrameRect& rect : rects) {
+        views.push_back(view.SubView(rect));
+    }
+    uint64_t start = Metrics::NowUs();
+    if (!encoder.CompressAll(views, quality, jpegs)) {
+        return client::message_ptr();
+    }
+    uint64_t encoded = metrics.RecordSince(Stage::Encode, start);
+    Trace::Complete("encode", start, encoded, "rects", views.size());
+    RecordEncoded(metrics, views, jpegs);
+
+    size_t total = FrameProtocol::kFrameHeaderSize;
+    for (size_t i = 0; i < rectCount; ++i) {
+        total += FrameProtocol::kRectHeaderSize + jpegs[i].size;
+    }
+
+    client::message_ptr msg = ws.createMessage(websocketpp::frame::opcode::binary, total);
+    if (!msg) {
+        return msg;
+    }
+
+    FrameProtocol::FrameHeader header;
+    header.type = keyframe ? FrameProtocol::MessageType::Keyframe : FrameProtocol::MessageType::DeltaFrame;
+    header.codec = FrameProtocol::Codec::Jpeg;
+    header.seq = seq;
+    header.timestampUs = view.timestampUs;
+    header.frameWidth = static_cast<uint16_t>(view.width);
+    header.frameHeight = static_cast<uint16_t>(view.height);
+    header.rectCount = static_cast<uint16_t>(rectCount);
+    uint8_t headerBytes[FrameProtocol::kFrameHeaderSize];
+    FrameProtocol::WriteFrameHeader(header, headerBytes);
+    msg->append_payload(headerBytes, sizeof(headerBytes));
+
+    for (size_t i = 0; i < rectCount; ++i) {
+        FrameProtocol::RectHeader rectHeader;
+        rectHeader.x = static_cast<uint16_t>(rects[i].x);
+        rectHeader.y = static_cast<uint16_t>(rects[i].y);
+        rectHeader.width = static_cast<uint16_t>(rects[i].width);
+        rectHeader.height = static_cast<uint16_t>(rects[i].height);
+        rectHeader.payloadSize = static_cast<uint32_t>(jpegs[i].size);
+        uint8_t rectBytes[FrameProtocol::kRectHeaderSize];
+        FrameProtocol::WriteRectHeader(rectHeader, rectBytes);
+        msg->append_payload(rectBytes, sizeof(rectBytes));
+        msg->append_payload(jpegs[i].Data(), jpegs[i].size);
+    }
+    uint64_t framed = metrics.RecordSince(Stage::Framing, encoded);
+    Trace::Complete("framing", encoded, framed, "bytes", total);
+    return msg;
+}
+
+} // namespace
+
+FramePipeline::FramePipeline(FrameSource& source, WebSocketClient& wsClient, Metrics& metrics,
+                             const PipelineOptions& options)
+    : m_source(source), m_damageDriven(source.ReportsDamage()), m_ws(wsClient), m_metrics(metrics),
+      m_options(options), m_clock(options.activeFps), m_encoder(options.encodeThreads) {
+}
+
+FramePipeline::~FramePipeline() {
+    Stop();
+}
+
+void FramePipeline::Start() {
+    if (m_running.exchange(true)) {
+        return;
+    }
+    m_captureThread = std::thread(&FramePipeline::CaptureLoop, this);
+    m_encodeThread = std::thread(&FramePipeline::EncodeLoop, this);
+    m_sendThread = std::thread(&FramePipeline::SendLoop, this);
+}
+
+void FramePipeline::Stop() {
+    m_running.store(false);
+    m_clock.Wake();
+    m_source.Wake();
+    if (m_captureThread.joinable()) {
+        m_captureThread.join();
+    }
+    if (m_encodeThread.joinable()) {
+        m_encodeThread.join();
+    }
+    if (m_sendThread.joinable()) {
+        m_sendThread.join();
+    }
+}
+
+void FramePipeline::FillCounters(MetricsCounters& counters) const {
+    counters.framesCaptured = m_stats.framesCaptured.load();
+    counters.framesEncoded = m_stats.framesEncoded.load();
+    counters.capturesDeferred = m_stats.capturesDeferred.load();
+    counters.encodeFailures = m_stats.encodeFailures.load();
+    counters.captureRate = m_clock.Rate();
+    SendStats send = m_ws.getSendStats();
+    counters.framesSent = send.framesSent;
+    counters.chunksSent = send.chunksSent;
+}
+
+void FramePipeline::OnFrameWritten(const FrameTiming& timing) {
+    m_metrics.Record(Stage::Send, timing.writtenUs - timing.takenUs);
+    if (timing.encodedUs != 0 && timing.captureUs != 0) {
+        m_metrics.Record(Stage::QueueWait, timing.takenUs - timing.encodedUs);
+        m_metrics.Record(Stage::EndToEnd, timing.writtenUs - timing.captureUs);
+    }
+    m_metrics.AddFrameWritten(timing.bytes);
+    Trace::Complete("frame written", timing.takenUs, timing.writtenUs, "bytes", timing.bytes);
+}
+
+void FramePipeline::RequestKeyframe() {
+    m_keyframeRequested.store(true);
+    // The viewer is waiting on it, so do not sit out an idle-rate tick.
+    m_clock.Wake();
+    if (m_damageDriven) {
+        m_source.Wake();
+    }
+}
+
+void FramePipeline::NotifyActivity() {
+    m_lastInput.store(FrameClock::Clock::now().time_since_epoch().count());
+    m_clock.SetRate(m_options.burstFps);
+    m_clock.Wake();
+}
+
+void FramePipeline::UpdateRate(FrameClock::Clock::time_point now) {
+    FrameClock::Clock::time_point lastInput(FrameClock::Clock::duration(m_lastInput.load()));
+    if (now - lastInput < m_options.burstFor) {
+        m_clock.SetRate(m_options.burstFps);
+    } else if (m_damageDriven || now - m_lastChange < m_options.idleAfter) {
+        // A damage-driven pipeline is idle without polling, so there is no
+        // slow rate to fall back to.
+        m_clock.SetRate(m_options.activeFps);
+    } else {
+        m_clock.SetRate(m_options.idleFps);
+    }
+}
+
+void FramePipeline::CaptureLoop() {
+    Trace::SetThreadName("capture");
+    uint32_t seq = 0;
+    m_lastChange = FrameClock::Clock::now();
+    while (m_running.load()) {
+        if (m_damageDriven) {
+            FrameClock::Clock::time_point waitStart = FrameClock::Clock::now();
+            while (m_running.load() && m_ws.isConnected() && !m_keyframeRequested.load() &&
+                   !m_source.WaitForDamage(kDamageWait)) {
+            }
+            // After a quiet spell the first change goes out at once instead
+            // of on the next tick of the old schedule.
+            if (FrameClock::Clock::now() - waitStart > std::chrono::duration<double>(1.0 / m_clock.Rate())) {
+                m_clock.Reset();
+            }
+        }
+        m_clock.WaitNextTick();
+        if (!m_running.load()) {
+            break;
+        }
+
+        if (!m_ws.isConnected()) {
+            std::cerr << "WebSocket disconnected. Attempting to reconnect..." << std::endl;
+            // Whoever is watching after the reconnect needs a complete frame.
+            m_keyframeRequested.store(true);
+            std::this_thread::sleep_for(std::chrono::seconds(2));
+            m_clock.Reset();
+            continue;
+        }
+
+        if (m_captured.Size() == m_captured.MaxSize()) {
+            // Encoding is behind; leave the screen alone this tick.
+            ++m_stats.capturesDeferred;
+            Trace::Instant("capture deferred");
+        } else {
+            bool keyframe = m_keyframeRequested.exchange(false);
+            if (keyframe && m_damageDriven) {
+                m_source.DamageAll();
+            }
+
+            // The frame is borrowed from the source's pool and goes back to
+            // it once the encode stage is done with it.
+            uint64_t start = Metrics::NowUs();
+            PooledFrame frame = m_source.Capture();
+            uint64_t captured = m_metrics.RecordSince(Stage::Capture, start);
+            Trace::Complete("capture", start, captured, "seq", seq);
+
+            // Nothing goes downstream when no tile changed.
+            if (keyframe) {
+                m_differ.Reset();
+            }
+            bool changed = false;
+            if (frame && m_damageDriven) {
+                // The source already knows what changed. Pixels outside its
+                // rects are stale, so only a full readback may go out whole.
+                changed = !frame.DirtyRects().empty();
+                keyframe = keyframe || CoversFrame(frame);
+                Trace::Instant("damage", "rects", frame.DirtyRects().size());
+            } else if (frame) {
+                size_t dirtyTiles = m_differ.Diff(frame);
+                uint64_t diffed = m_metrics.RecordSince(Stage::Diff, captured);
+                Trace::Complete("diff", captured, diffed, "dirtyTiles", dirtyTiles);
+                changed = dirtyTiles > 0;
+                size_t totalTiles = static_cast<size_t>(m_differ.TilesX()) * m_differ.TilesY();
+                if (dirtyTiles > totalTiles * m_options.keyframeDirtyRatio) {
+                    keyframe = true;
+                }
+            }
+
+            if (changed) {
+                m_lastChange = FrameClock::Clock::now();
+                if (m_recorder) {
+                    TraceScope recordScope("record", "seq", seq);
+                    if (!m_recorder->Write(frame.View(), keyframe)) {
+                        std::cerr << "Recording stopped at frame " << seq << std::endl;
+                        m_recorder = nullptr;
+                    }
+                }
+                CapturedFrame item;
+                item.frame = std::move(frame);
+                item.seq = seq++;
+                item.keyframe = keyframe;
+                // Cannot fail: this thread is the only producer and saw room.
+                m_captured.TryPush(item);
+                ++m_stats.framesCaptured;
+            } else if (keyframe) {
+                // Nothing captured this time; keep the request for the next frame.
+                m_keyframeRequested.store(true);
+            }
+        }
+
+        UpdateRate(FrameClock::Clock::now());
+    }
+}
+
+void FramePipeline::EncodeLoop() {
+    Trace::SetThreadName("encode");
+    Backoff backoff;
+    CapturedFrame item;
+    while (m_running.load()) {
+        if (!m_captured.TryPop(item)) {
+            backoff.Pause();
+            continue;
+        }
+        backoff.Reset();
+
+        TraceScope frameScope("frame", "seq", item.seq);
+        FrameView view = item.frame.View();
+        EncodedFrame encoded;
+        encoded.seq = item.seq;
+        encoded.timing.captureUs = view.timestampUs;
+        if (!m_options.textFrames) {
+            encoded.msg = BuildBinaryFrame(m_ws, m_metrics, m_encoder, m_jpegBuffers, view, item.seq,
+                                           item.keyframe, m_options.jpegQuality);
+        } else {
+            encoded.msg = BuildTextFrame(m_ws, m_metrics, m_encoder, m_jpegBuffers, view, item.seq,
+                                         item.keyframe, m_options.jpegQuality);
+        }
+        // Pixels are no longer needed; let capture reuse the buffer.
+        item.frame.Release();
+
+        if (!encoded.msg) {
+            // The differ already took these tiles into its reference; only a
+            // full frame brings the viewer back in step.
+            ++m_stats.encodeFailures;
+            m_keyframeRequested.store(true);
+            continue;
+        }
+        ++m_stats.framesEncoded;
+        encoded.timing.encodedUs = Metrics::NowUs();
+
+        while (!m_encoded.TryPush(encoded) && m_running.load()) {
+            backoff.Pause();
+        }
+        backoff.Reset();
+    }
+}
+
+void FramePipeline::SendLoop() {
+    Trace::SetThreadName("send");
+    Backoff backoff;
+    EncodedFrame encoded;
+    while (m_running.load()) {
+        if (!encoded.msg && !m_encoded.TryPop(encoded)) {
+            backoff.Pause();
+            continue;
+        }
+        // Wait for the client's frame slot instead of replacing what is in it,
+        // so every encoded delta reaches the viewer.
+        if (m_ws.hasPendingFrame()) {
+            backoff.Pause();
+            continue;
+        }
+        backoff.Reset();
+
+        TraceScope sendScope("sendFrame", "seq", encoded.seq);
+        if (m_ws.sendFrame(encoded.msg, encoded.timing)) {
+            ++m_stats.framesSent;
+        } else {
+            // With the slot free this only fails when the connection is gone,
+            // and a viewer that comes back needs a keyframe.
+            m_keyframeRequested.store(true);
+        }
+        encoded.msg.reset();
+    }
+}
@@ -0,0 +1,142 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include "FrameClock.hpp"
+#include "FrameDiffer.hpp"
+#include "FrameRecording.hpp"
+#include "FrameSource.hpp"
+#include "JpegEncoderPool.hpp"
+#include "Metrics.hpp"
+#include "SpscRing.hpp"
+#include "WebSocketClient.hpp"
+
+struct PipelineOptions {
+    int jpegQuality = 80;
+    // Above this share of the screen a single full frame is cheaper than rects.
+    double keyframeDirtyRatio = 0.5;
+    // Send JSON + base64 frames instead of binary ones.
+    bool textFrames = false;
+    // Threads compressing binary frames; 0 picks a default that leaves half
+    // the machine to the user.
+    size_t encodeThreads = 0;
+
+    // Capture rate. The pipeline runs at activeFps while the screen is
+    // changing, rises to burstFps for burstFor after viewer input, and drops
+    // to idleFps once nothing has changed for idleAfter.
+    double activeFps = 30.0;
+    double burstFps = 60.0;
+    double idleFps = 2.0;
+    std::chrono::milliseconds burstFor{1000};
+    std::chrono::milliseconds idleAfter{2000};
+};
+
+// Counters readable from any thread while the pipeline runs.
+struct PipelineStats {
+    std::atomic<uint64_t> framesCaptured{0};
+    std::atomic<uint64_t> framesEncoded{0};
+    std::atomic<uint64_t> framesSent{0};
+    std::atomic<uint64_t> encodeFailures{0};
+    // Ticks skipped because the encode stage was still full.
+    std::atomic<uint64_t> capturesDeferred{0};
+};
+
+// Capture, encode and send each run on their own thread, joined by small
+// SPSC rings, so frame N+1 is captured while frame N is compressed and N-1 is
+// on the wire.
+//
+//   capture thread: grab (from a FrameSource) + diff, assigns the sequence number
+//        | SpscRing<CapturedFrame>  (leased PooledFrames)
+//   encode thread:  JPEG (fanned out over a JpegEncoderPool) + message framing
+//        | SpscRing<message_ptr>
+//   send thread:    hands frames to WebSocketClient::sendFrame
+//
+// Backpressure flows upstream: the send stage waits while the client still
+// holds an unsent frame, and the capture stage skips a tick when the encode
+// ring is full. Skipping is safe because the differ's reference always
+// matches the last frame that went downstream.
+//
+// Each stage records its time into metrics (see Metrics.hpp); the send and
+// end-to-end times are recorded from the client's frame-written handler.
+//
+// With a source that reports damage (FrameSource::ReportsDamage) the capture
+// thread sleeps until the source has changes instead of ticking, the clock
+// only caps the rate, and the source's dirty rects replace the diff.
+class FramePipeline {
+public:
+    // Frames alive at once: one being captured, one per capture ring slot and
+    // one being encoded. A source's pool needs at least this many.
+    static const size_t kCaptureRingSize = 2;
+    static const size_t kSendRingSize = 2;
+    static const size_t kPoolSlots = kCaptureRingSize + 2;
+
+    // source, wsClient and metrics must outlive the pipeline.
+    FramePipeline(FrameSource& source, WebSocketClient& wsClient, Metrics& metrics, const PipelineOptions& options);
+    ~FramePipeline();
+
+    void Start();
+    void Stop();
+
+    // Writes every frame that goes downstream to recorder, dirty rects only
+    // (whole for keyframes), on the capture thread. Set before Start; the
+    // recorder must outlive the pipeline.
+    void SetRecorder(FrameRecorder* recorder) { m_recorder = recorder; }
+
+    // Makes the next frame a keyframe. Safe from any thread.
+    void RequestKeyframe();
+
+    // Viewer input arrived: capture now and at the burst rate for a while.
+    // Safe from any thread.
+    void NotifyActivity();
+
+    const PipelineStats& Stats() const { return m_stats; }
+    // The pipeline's and the client's counters, for a metrics report.
+    void FillCounters(MetricsCounters& counters) const;
+    // Records the stages that end on the wire; call from the client's
+    // frame-written handler.
+    void OnFrameWritten(const FrameTiming& timing);
+    FrameClockStats ClockStats() const { return m_clock.Stats(); }
+    double CaptureRate() const { return m_clock.Rate(); }
+
+private:
+    struct CapturedFrame {
+        PooledFrame frame;
+        uint32_t seq = 0;
+        bool keyframe = false;
+    };
+
+    struct EncodedFrame {
+        client::message_ptr msg;
+        uint32_t seq = 0;
+        FrameTiming timing;
+    };
+
+    void CaptureLoop();
+    void EncodeLoop();
+    void SendLoop();
+    void UpdateRate(FrameClock::Clock::time_point now);
+
+    FrameSource& m_source;
+    const bool m_damageDriven;
+    WebSocketClient& m_ws;
+    Metrics& m_metrics;
+    FrameRecorder* m_recorder = nullptr;  // capture thread once started
+    PipelineOptions m_options;
+    FrameDiffer m_differ;
+    FrameClock m_clock;
+    JpegEncoderPool m_encoder;
+    std::vector<JpegBuffer> m_jpegBuffers;  // encode thread only
+    FrameClock::Clock::time_point m_lastChange;
+    std::atomic<FrameClock::Clock::rep> m_lastInput{0};
+
+    SpscRing<CapturedFrame, kCaptureRingSize> m_captured;
+    SpscRing<EncodedFrame, kSendRingSize> m_encoded;
+
+    std::atomic<bool> m_keyframeRequested{true};
+    std::atomic<bool> m_running{false};
+    std::thread m_captureThread;
+    std::thread m_encodeThread;
+    std::thread m_sendThread;
+    PipelineStats m_stats;
+};
@@ -0,0 +1,179 @@
+#include "FramePool.hpp"
+#include <utility>
+
+PooledFrame::PooledFrame(PooledFrame&& other) noexcept
+    : m_pool(other.m_pool), m_slot(other.m_slot) {
+    other.m_pool = nullptr;
+}
+
+PooledFrame& PooledFrame::operator=(PooledFrame&& other) noexcept {
+    if (this != &other) {
+        Release();
+        m_pool = other.m_pool;
+        m_slot = other.m_slot;
+        other.m_pool = nullptr;
+    }
+    return *this;
+}
+
+PooledFrame::~PooledFrame() {
+    Release();
+}
+
+uint8_t* PooledFrame::Data() {
+    return m_pool->m_slots[m_slot].data;
+}
+
+const uint8_t* PooledFrame::Data() const {
+    return m_pool->m_slots[m_slot].data;
+}
+
+int PooledFrame::Width() const {
+    return m_pool->m_slots[m_slot].width;
+}
+
+int PooledFrame::Height() const {
+    return m_pool->m_slots[m_slot].height;
+}
+
+int PooledFrame::Stride() const {
+    return m_pool->m_slots[m_slot].stride;
+}
+
+PixelFormat PooledFrame::Format() const {
+    return m_pool->m_slots[m_slot].format;
+}
+
+uint64_t PooledFrame::TimestampUs() const {
+    return m_pool->m_slots[m_slot].timestampUs;
+}
+
+void PooledFrame::SetTimestampUs(uint64_t timestampUs) {
+    m_pool->m_slots[m_slot].timestampUs = timestampUs;
+}
+
+std::vector<FrameRect>& PooledFrame::DirtyRects() {
+    return m_pool->m_slots[m_slot].dirty;
+}
+
+const std::vector<FrameRect>& PooledFrame::DirtyRects() const {
+    return m_pool->m_slots[m_slot].dirty;
+}
+
+FrameView PooledFrame::View() const {
+    FrameView view;
+    if (!m_pool) {
+        return view;
+    }
+    const FramePool::Slot& slot = m_pool->m_slots[m_slot];
+    view.data = slot.data;
+    view.width = slot.width;
+    view.height = slot.height;
+    view.stride = slot.stride;
+    view.format = slot.format;
+    view.timestampUs = slot.timestampUs;
+    view.dirtyRects = slot.dirty.data();
+    view.dirtyCount = slot.dirty.size();
+    return view;
+}
+
+void PooledFrame::Release() {
+    if (m_pool) {
+        m_pool->Release(m_slot);
+        m_pool = nullptr;
+    }
+}
+
+FramePool::FramePool(size_t slotCount, FrameAllocator* allocator)
+    : m_allocator(allocator), m_slots(slotCount) {
+    m_free.reserve(slotCount);
+    for (size_t i = slotCount; i > 0; --i) {
+        m_free.push_back(i - 1);
+    }
+}
+
+FramePool::~FramePool() {
+    if (m_allocator) {
+        for (Slot& slot : m_slots) {
+            if (slot.data) {
+                m_allocator->Free(slot.data, slot.capacity);
+            }
+        }
+    }
+}
+
+bool FramePool::Reserve(Slot& slot, size_t bytes) {
+    if (!m_allocator) {
+        if (bytes > slot.pixels.capacity()) {
+            ++m_allocations;
+        }
+        slot.pixels.resize(bytes);
+        slot.data = slot.pixels.data();
+        return true;
+    }
+    if (bytes <= slot.capacity) {
+        return true;
+    }
+    ++m_allocations;
+    if (slot.data) {
+        m_allocator->Free(slot.data, slot.capacity);
+    }
+    slot.data = m_allocator->Allocate(bytes);
+    slot.capacity = slot.data ? bytes : 0;
+    return slot.data != nullptr;
+}
+
+bool FramePool::Configure(int width, int height, int stride, PixelFormat format) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (width == m_width && height == m_height && stride == m_stride && format == m_format) {
+        return false;
+    }
+    m_width = width;
+    m_height = height;
+    m_stride = stride;
+    m_format = format;
+    return true;
+}
+
+PooledFrame FramePool::Acquire() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_free.empty()) {
+        return PooledFrame();
+    }
+    size_t index = m_free.back();
+    m_free.pop_back();
+
+    // Slots are resized lazily on the way out so a geometry change never
+    // disturbs a buffer that is still being encoded or sent.
+    Slot& slot = m_slots[index];
+    if (slot.width != m_width || slot.height != m_height || slot.stride != m_stride) {
+        size_t bytes = static_cast<size_t>(m_stride) * static_cast<size_t>(m_height);
+        if (!Reserve(slot, bytes)) {
+            slot.width = slot.height = slot.stride = 0;
+            m_free.push_back(index);
+            return PooledFrame();
+        }
+        slot.width = m_width;
+        slot.height = m_height;
+        slot.stride = m_stride;
+    }
+    slot.format = m_format;
+    slot.timestampUs = 0;
+    slot.dirty.clear();
+    return PooledFrame(this, index);
+}
+
+size_t FramePool::FreeCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_free.size();
+}
+
+uint64_t FramePool::AllocationCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_allocations;
+}
+
+void FramePool::Release(size_t slot) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_free.push_back(slot);
+}
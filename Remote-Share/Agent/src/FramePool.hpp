@@ -0,0 +1,120 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include "FrameView.hpp"
+
+class FramePool;
+
+// Where slot buffers come from when plain heap memory will not do, e.g. shared
+// memory segments the X server writes into. Called with the pool's lock held,
+// only when a slot needs a bigger buffer; must outlive the pool.
+class FrameAllocator {
+public:
+    virtual ~FrameAllocator() = default;
+
+    // Returns nullptr on failure, which makes Acquire return an empty lease.
+    virtual uint8_t* Allocate(size_t bytes) = 0;
+    virtual void Free(uint8_t* data, size_t bytes) = 0;
+};
+
+// A frame buffer borrowed from a FramePool. Move-only; the buffer goes back to
+// the pool when the lease is destroyed or Release() is called. The pool must
+// outlive every lease it hands out.
+class PooledFrame {
+public:
+    PooledFrame() = default;
+    PooledFrame(PooledFrame&& other) noexcept;
+    PooledFrame& operator=(PooledFrame&& other) noexcept;
+    PooledFrame(const PooledFrame&) = delete;
+    PooledFrame& operator=(const PooledFrame&) = delete;
+    ~PooledFrame();
+
+    explicit operator bool() const { return m_pool != nullptr; }
+
+    uint8_t* Data();
+    const uint8_t* Data() const;
+    int Width() const;
+    int Height() const;
+    int Stride() const;
+    PixelFormat Format() const;
+
+    uint64_t TimestampUs() const;
+    void SetTimestampUs(uint64_t timestampUs);
+
+    // Regions changed since the previous frame. Capacity is kept between
+    // leases, so filling it does not allocate once it has grown.
+    std::vector<FrameRect>& DirtyRects();
+    const std::vector<FrameRect>& DirtyRects() const;
+
+    // Borrowed view of the pixels; valid for as long as this lease.
+    FrameView View() const;
+
+    // Returns the buffer to the pool early. The lease is empty afterwards.
+    void Release();
+
+private:
+    friend class FramePool;
+
+    PooledFrame(FramePool* pool, size_t slot) : m_pool(pool), m_slot(slot) {}
+
+    FramePool* m_pool = nullptr;
+    size_t m_slot = 0;
+};
+
+// Fixed set of reusable frame buffers. Buffers only grow when the configured
+// geometry needs more room than they already hold, so a steady stream of
+// same-sized frames never touches the allocator.
+class FramePool {
+public:
+    // Slots are heap buffers unless an allocator is given.
+    explicit FramePool(size_t slotCount = 3, FrameAllocator* allocator = nullptr);
+    ~FramePool();
+    FramePool(const FramePool&) = delete;
+    FramePool& operator=(const FramePool&) = delete;
+
+    // Sets the geometry of frames handed out from now on. Buffers that are
+    // currently leased keep their old geometry until they come back.
+    // Returns true if the geometry changed.
+    bool Configure(int width, int height, int stride, PixelFormat format);
+
+    // Borrows a free buffer sized for the current geometry. Returns an empty
+    // lease if every slot is still in use or its buffer could not be grown.
+    PooledFrame Acquire();
+
+    size_t SlotCount() const { return m_slots.size(); }
+    size_t FreeCount() const;
+
+    // Number of times a slot buffer had to be (re)allocated. Stays constant
+    // while the geometry is stable.
+    uint64_t AllocationCount() const;
+
+private:
+    friend class PooledFrame;
+
+    struct Slot {
+        std::vector<uint8_t> pixels;  // unused with an allocator
+        uint8_t* data = nullptr;
+        size_t capacity = 0;          // allocator buffers only
+        int width = 0;
+        int height = 0;
+        int stride = 0;
+        PixelFormat format = PixelFormat::BGR24;
+        uint64_t timestampUs = 0;
+        std::vector<FrameRect> dirty;
+    };
+
+    void Release(size_t slot);
+    bool Reserve(Slot& slot, size_t bytes);
+
+    mutable std::mutex m_mutex;
+    FrameAllocator* m_allocator;
+    std::vector<Slot> m_slots;
+    std::vector<size_t> m_free;
+    int m_width = 0;
+    int m_height = 0;
+    int m_stride = 0;
+    PixelFormat m_format = PixelFormat::BGR24;
+    uint64_t m_allocations = 0;
+};
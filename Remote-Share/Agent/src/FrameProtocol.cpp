@@ -0,0 +1,57 @@
+#include "FrameProtocol.hpp"
+
+namespace {
+
+// Byte-wise stores so the wire format does not depend on host endianness.
+void PutU16(uint8_t* out, uint16_t value) {
+    out[0] = static_cast<uint8_t>(value);
+    out[1] = static_cast<uint8_t>(value >> 8);
+}
+
+void PutU32(uint8_t* out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+void PutU64(uint8_t* out, uint64_t value) {
+    for (int i = 0; i < 8; ++i) {
+        out[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+} // namespace
+
+namespace FrameProtocol {
+
+void WriteFrameHeader(const FrameHeader& header, uint8_t* out) {
+    out[0] = kVersion;
+    out[1] = static_cast<uint8_t>(header.type);
+    out[2] = static_cast<uint8_t>(header.codec);
+    out[3] = 0;
+    PutU32(out + 4, header.seq);
+    PutU64(out + 8, header.timestampUs);
+    PutU16(out + 16, header.frameWidth);
+    PutU16(out + 18, header.frameHeight);
+    PutU16(out + 20, header.rectCount);
+    PutU16(out + 22, 0);
+}
+
+void WriteRectHeader(const RectHeader& header, uint8_t* out) {
+    PutU16(out + 0, header.x);
+    PutU16(out + 2, header.y);
+    PutU16(out + 4, header.width);
+    PutU16(out + 6, header.height);
+    PutU32(out + 8, header.payloadSize);
+}
+
+void WriteChunkHeader(const ChunkHeader& header, uint8_t* out) {
+    out[0] = kVersion;
+    out[1] = static_cast<uint8_t>(MessageType::FrameChunk);
+    PutU16(out + 2, 0);
+    PutU32(out + 4, header.streamId);
+    PutU32(out + 8, header.offset);
+    PutU32(out + 12, header.totalSize);
+}
+
+} // namespace FrameProtocol
@@ -0,0 +1,92 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Binary frame messages sent to the viewer as WebSocket binary messages.
+// Everything is little-endian. One message carries one whole frame:
+//
+//   frame header (24 bytes)
+//     u8  version       kVersion
+//     u8  type          MessageType
+//     u8  codec         Codec of every rect payload
+//     u8  flags         reserved, 0
+//     u32 seq           frame sequence number
+//     u64 timestampUs   capture time (agent steady clock)
+//     u16 frameWidth
+//     u16 frameHeight
+//     u16 rectCount
+//     u16 reserved
+//   rectCount times:
+//     rect header (12 bytes)
+//       u16 x, u16 y, u16 width, u16 height
+//       u32 payloadSize
+//     payloadSize bytes of encoded image
+//
+// The rects of a keyframe tile the whole frame (large frames are sent as
+// horizontal bands encoded in parallel); a delta frame has rects for the
+// changed regions only, to be drawn over the previous frame.
+//
+// Frame messages larger than the client's fragment size are split into chunk
+// messages so control messages can be sent between them. The viewer joins the
+// chunks of a stream back into the frame message and parses that:
+//
+//   chunk header (16 bytes)
+//     u8  version       kVersion
+//     u8  type          MessageType::FrameChunk
+//     u16 reserved
+//     u32 streamId      same for every chunk of one frame message
+//     u32 offset        where this chunk's bytes go in the frame message
+//     u32 totalSize     size of the whole frame message
+//   the chunk's bytes of the frame message
+//
+// Chunks of a stream are sent in order and never interleaved with another
+// stream; a chunk that does not continue the current stream drops it.
+namespace FrameProtocol {
+
+const uint8_t kVersion = 1;
+const size_t kFrameHeaderSize = 24;
+const size_t kRectHeaderSize = 12;
+const size_t kChunkHeaderSize = 16;
+
+enum class MessageType : uint8_t {
+    Keyframe = 1,
+    DeltaFrame = 2,
+    FrameChunk = 3,
+    Input = 4           // viewer to agent, see InputProtocol.hpp
+};
+
+enum class Codec : uint8_t {
+    Jpeg = 1
+};
+
+struct FrameHeader {
+    MessageType type = MessageType::Keyframe;
+    Codec codec = Codec::Jpeg;
+    uint32_t seq = 0;
+    uint64_t timestampUs = 0;
+    uint16_t frameWidth = 0;
+    uint16_t frameHeight = 0;
+    uint16_t rectCount = 0;
+};
+
+struct RectHeader {
+    uint16_t x = 0;
+    uint16_t y = 0;
+    uint16_t width = 0;
+    uint16_t height = 0;
+    uint32_t payloadSize = 0;
+};
+
+struct ChunkHeader {
+    uint32_t streamId = 0;
+    uint32_t offset = 0;
+    uint32_t totalSize = 0;
+};
+
+// Serialize into out, which must hold kFrameHeaderSize / kRectHeaderSize /
+// kChunkHeaderSize bytes.
+void WriteFrameHeader(const FrameHeader& header, uint8_t* out);
+void WriteRectHeader(const RectHeader& header, uint8_t* out);
+void WriteChunkHeader(const ChunkHeader& header, uint8_t* out);
+
+} // namespace FrameProtocol
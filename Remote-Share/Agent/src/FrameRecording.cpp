@@ -0,0 +1,386 @@
+#include "FrameRecording.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <limits>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef REMOTE_SHARE_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace {
+
+using namespace FrameRecording;
+
+// Byte-wise so the file format does not depend on host endianness.
+void PutU16(uint8_t* out, uint16_t value) {
+    out[0] = static_cast<uint8_t>(value);
+    out[1] = static_cast<uint8_t>(value >> 8);
+}
+
+void PutU32(uint8_t* out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+void PutU64(uint8_t* out, uint64_t value) {
+    for (int i = 0; i < 8; ++i) {
+        out[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+uint16_t GetU16(const uint8_t* in) {
+    return static_cast<uint16_t>(in[0] | (in[1] << 8));
+}
+
+uint32_t GetU32(const uint8_t* in) {
+    uint32_t value = 0;
+    for (int i = 3; i >= 0; --i) {
+        value = (value << 8) | in[i];
+    }
+    return value;
+}
+
+uint64_t GetU64(const uint8_t* in) {
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; --i) {
+        value = (value << 8) | in[i];
+    }
+    return value;
+}
+
+void WriteFrameHeader(const FrameHeader& header, uint8_t* out) {
+    PutU32(out + 0, kFrameMagic);
+    PutU32(out + 4, header.storedSize);
+    PutU32(out + 8, header.rawSize);
+    PutU16(out + 12, header.rectCount);
+    PutU16(out + 14, header.width);
+    PutU16(out + 16, header.height);
+    out[18] = static_cast<uint8_t>(header.format);
+    out[19] = static_cast<uint8_t>(header.compression);
+    PutU32(out + 20, 0);
+    PutU64(out + 24, header.timestampUs);
+}
+
+bool ReadFrameHeader(const uint8_t* in, FrameHeader& header) {
+    if (GetU32(in) != kFrameMagic || in[18] > static_cast<uint8_t>(PixelFormat::BGRX32) ||
+        in[19] > static_cast<uint8_t>(Compression::Zstd)) {
+        return false;
+    }
+    header.storedSize = GetU32(in + 4);
+    header.rawSize = GetU32(in + 8);
+    header.rectCount = GetU16(in + 12);
+    header.width = GetU16(in + 14);
+    header.height = GetU16(in + 16);
+    header.format = static_cast<PixelFormat>(in[18]);
+    header.compression = static_cast<Compression>(in[19]);
+    header.timestampUs = GetU64(in + 24);
+    return true;
+}
+
+} // namespace
+
+namespace FrameRecording {
+
+bool ZstdAvailable() {
+#ifdef REMOTE_SHARE_HAVE_ZSTD
+    return true;
+#else
+    return false;
+#endif
+}
+
+} // namespace FrameRecording
+
+FrameRecorder::FrameRecorder() = default;
+
+FrameRecorder::~FrameRecorder() {
+    Close();
+#ifdef REMOTE_SHARE_HAVE_ZSTD
+    ZSTD_freeCCtx(static_cast<ZSTD_CCtx*>(m_zstd));
+#endif
+}
+
+bool FrameRecorder::Open(const std::string& path, bool compress, int zstdLevel) {
+    Close();
+    m_file = std::fopen(path.c_str(), "wb");
+    if (!m_file) {
+        std::cerr << "Cannot create recording " << path << std::endl;
+        return false;
+    }
+    uint8_t header[kFileHeaderSize] = {};
+    PutU32(header, kFileMagic);
+    PutU16(header + 4, kVersion);
+    if (std::fwrite(header, 1, sizeof(header), m_file) != sizeof(header)) {
+        std::cerr << "Cannot write recording " << path << std::endl;
+        Close();
+        return false;
+    }
+
+    m_compress = compress && ZstdAvailable();
+    if (compress && !m_compress) {
+        std::cerr << "Built without zstd; recording uncompressed frames" << std::endl;
+    }
+#ifdef REMOTE_SHARE_HAVE_ZSTD
+    if (m_compress && !m_zstd) {
+        m_zstd = ZSTD_createCCtx();
+    }
+#endif
+    m_zstdLevel = zstdLevel;
+    m_frames = 0;
+    m_rawBytes = 0;
+    m_storedBytes = kFileHeaderSize;
+    return true;
+}
+
+void FrameRecorder::Close() {
+    if (m_file) {
+        std::fclose(m_file);
+        m_file = nullptr;
+    }
+}
+
+bool FrameRecorder::Write(const FrameView& frame, bool full) {
+    if (!m_file || frame.Empty() || frame.width > 0xffff || frame.height > 0xffff) {
+        return false;
+    }
+
+    m_rects.clear();
+    if (!full && m_frames != 0 && frame.width == m_width && frame.height == m_height &&
+        frame.dirtyCount <= 0xffff) {
+        for (size_t i = 0; i < frame.dirtyCount; ++i) {
+            const FrameRect& dirty = frame.dirtyRects[i];
+            FrameRect rect;
+            rect.x = std::max(0, dirty.x);
+            rect.y = std::max(0, dirty.y);
+            rect.width = std::min(frame.width, dirty.x + dirty.width) - rect.x;
+            rect.height = std::min(frame.height, dirty.y + dirty.height) - rect.y;
+            if (rect.width > 0 && rect.height > 0) {
+                m_rects.push_back(rect);
+            }
+        }
+    } else {
+        FrameRect all;
+        all.width = frame.width;
+        all.height = frame.height;
+        m_rects.push_back(all);
+    }
+
+    const int bytesPerPixel = BytesPerPixel(frame.format);
+    uint64_t rawSize = 0;
+    for (const FrameRect& rect : m_rects) {
+        rawSize += static_cast<uint64_t>(rect.width) * rect.height * bytesPerPixel;
+    }
+    if (rawSize > std::numeric_limits<uint32_t>::max()) {
+        return false;
+    }
+
+    // Rows are packed into one buffer: zstd wants it contiguous, and one
+    // fwrite beats one per row.
+    m_raw.resize(static_cast<size_t>(rawSize));
+    uint8_t* out = m_raw.data();
+    for (const FrameRect& rect : m_rects) {
+        size_t rowBytes = static_cast<size_t>(rect.width) * bytesPerPixel;
+        for (int y = rect.y; y < rect.y + rect.height; ++y) {
+            std::memcpy(out, frame.Row(y) + static_cast<size_t>(rect.x) * bytesPerPixel, rowBytes);
+            out += rowBytes;
+        }
+    }
+
+    FrameHeader header;
+    header.rawSize = static_cast<uint32_t>(rawSize);
+    header.storedSize = header.rawSize;
+    header.rectCount = static_cast<uint16_t>(m_rects.size());
+    header.width = static_cast<uint16_t>(frame.width);
+    header.height = static_cast<uint16_t>(frame.height);
+    header.format = frame.format;
+    const uint8_t* payload = m_raw.data();
+#ifdef REMOTE_SHARE_HAVE_ZSTD
+    if (m_compress && m_zstd) {
+        m_packed.resize(ZSTD_compressBound(m_raw.size()));
+        size_t packed = ZSTD_compressCCtx(static_cast<ZSTD_CCtx*>(m_zstd), m_packed.data(), m_packed.size(),
+                                          m_raw.data(), m_raw.size(), m_zstdLevel);
+        if (!ZSTD_isError(packed)) {
+            payload = m_packed.data();
+            header.storedSize = static_cast<uint32_t>(packed);
+            header.compression = Compression::Zstd;
+        }
+    }
+#endif
+    if (m_frames == 0) {
+        m_firstUs = frame.timestampUs;
+    }
+    header.timestampUs = frame.timestampUs > m_firstUs ? frame.timestampUs - m_firstUs : 0;
+
+    uint8_t headerBytes[kFrameHeaderSize];
+    WriteFrameHeader(header, headerBytes);
+    bool ok = std::fwrite(headerBytes, 1, sizeof(headerBytes), m_file) == sizeof(headerBytes);
+    for (const FrameRect& rect : m_rects) {
+        uint8_t rectBytes[kRectSize];
+        PutU16(rectBytes + 0, static_cast<uint16_t>(rect.x));
+        PutU16(rectBytes + 2, static_cast<uint16_t>(rect.y));
+        PutU16(rectBytes + 4, static_cast<uint16_t>(rect.width));
+        PutU16(rectBytes + 6, static_cast<uint16_t>(rect.height));
+        ok = ok && std::fwrite(rectBytes, 1, sizeof(rectBytes), m_file) == sizeof(rectBytes);
+    }
+    ok = ok && std::fwrite(payload, 1, header.storedSize, m_file) == header.storedSize;
+    if (!ok) {
+        std::cerr << "Writing the recording failed" << std::endl;
+        Close();
+        return false;
+    }
+
+    m_width = frame.width;
+    m_height = frame.height;
+    ++m_frames;
+    m_rawBytes += header.rawSize;
+    m_storedBytes += kFrameHeaderSize + m_rects.size() * kRectSize + header.storedSize;
+    return true;
+}
+
+RecordingReader::RecordingReader() = default;
+
+RecordingReader::~RecordingReader() {
+    Close();
+#ifdef REMOTE_SHARE_HAVE_ZSTD
+    ZSTD_freeDCtx(static_cast<ZSTD_DCtx*>(m_zstd));
+#endif
+}
+
+void RecordingReader::Close() {
+#ifndef _WIN32
+    if (m_mapped) {
+        munmap(const_cast<uint8_t*>(m_data), m_size);
+    }
+#endif
+    m_mapped = false;
+    m_data = nullptr;
+    m_size = 0;
+    m_contents.clear();
+    m_frames.clear();
+}
+
+bool RecordingReader::Open(const std::string& path) {
+    Close();
+#ifndef _WIN32
+    int fd = open(path.c_str(), O_RDONLY);
+    struct stat info;
+    if (fd >= 0 && fstat(fd, &info) == 0 && info.st_size > 0) {
+        void* mapping = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED) {
+            madvise(mapping, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+            m_data = static_cast<const uint8_t*>(mapping);
+            m_size = static_cast<size_t>(info.st_size);
+            m_mapped = true;
+        }
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+#else
+    std::ifstream in(path, std::ios::binary);
+    if (in) {
+        m_contents.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        m_data = m_contents.data();
+        m_size = m_contents.size();
+    }
+#endif
+    if (!m_data) {
+        std::cerr << "Cannot read recording " << path << std::endl;
+        return false;
+    }
+    if (m_size < kFileHeaderSize || GetU32(m_data) != kFileMagic || GetU16(m_data + 4) != kVersion) {
+        std::cerr << path << " is not a version " << kVersion << " recording" << std::endl;
+        Close();
+        return false;
+    }
+
+    size_t offset = kFileHeaderSize;
+    while (offset < m_size) {
+        Entry entry;
+        const FrameHeader& header = entry.header;
+        entry.rectsOffset = offset + kFrameHeaderSize;
+        bool whole = m_size - offset >= kFrameHeaderSize;
+        bool ok = whole && ReadFrameHeader(m_data + offset, entry.header);
+        entry.payloadOffset = entry.rectsOffset + static_cast<size_t>(header.rectCount) * kRectSize;
+        if (!whole || (ok && (entry.payloadOffset > m_size || header.storedSize > m_size - entry.payloadOffset))) {
+            // A recorder that was killed leaves part of a frame, header or
+            // payload, at the end; the frames before it are fine.
+            std::cerr << path << " is cut short; replaying its first " << m_frames.size() << " frames" << std::endl;
+            break;
+        }
+        ok = ok && (header.compression == Compression::None ? header.storedSize == header.rawSize : ZstdAvailable());
+
+        // Every rect inside the frame and the payload exactly their pixels,
+        // so Apply never has to check.
+        uint64_t rawSize = 0;
+        for (size_t i = 0; ok && i < header.rectCount; ++i) {
+            const uint8_t* rect = m_data + entry.rectsOffset + i * kRectSize;
+            uint32_t x = GetU16(rect), y = GetU16(rect + 2), width = GetU16(rect + 4), height = GetU16(rect + 6);
+            ok = x + width <= header.width && y + height <= header.height;
+            rawSize += static_cast<uint64_t>(width) * height * BytesPerPixel(header.format);
+        }
+        ok = ok && rawSize == header.rawSize;
+        if (!ok) {
+            std::cerr << path << ": frame " << m_frames.size() << " at byte " << offset << " is damaged"
+                      << (header.compression == Compression::Zstd && !ZstdAvailable()
+                              ? " or zstd-compressed, which this build cannot read" : "")
+                      << std::endl;
+            Close();
+            return false;
+        }
+        m_frames.push_back(entry);
+        offset = entry.payloadOffset + header.storedSize;
+    }
+    if (m_frames.empty()) {
+        std::cerr << path << " has no frames" << std::endl;
+        Close();
+        return false;
+    }
+    return true;
+}
+
+bool RecordingReader::Apply(size_t index, uint8_t* dst, int stride) {
+    const Entry& entry = m_frames[index];
+    const FrameHeader& header = entry.header;
+    const uint8_t* payload = m_data + entry.payloadOffset;
+    if (header.compression == Compression::Zstd) {
+#ifdef REMOTE_SHARE_HAVE_ZSTD
+        if (!m_zstd) {
+            m_zstd = ZSTD_createDCtx();
+        }
+        m_scratch.resize(header.rawSize);
+        size_t size = ZSTD_decompressDCtx(static_cast<ZSTD_DCtx*>(m_zstd), m_scratch.data(), m_scratch.size(),
+                                          payload, header.storedSize);
+        if (ZSTD_isError(size) || size != header.rawSize) {
+            return false;
+        }
+        payload = m_scratch.data();
+#else
+        return false;
+#endif
+    }
+
+    const int bytesPerPixel = BytesPerPixel(header.format);
+    for (size_t i = 0; i < header.rectCount; ++i) {
+        const uint8_t* rect = m_data + entry.rectsOffset + i * kRectSize;
+        int x = GetU16(rect), y = GetU16(rect + 2), width = GetU16(rect + 4), height = GetU16(rect + 6);
+        size_t rowBytes = static_cast<size_t>(width) * bytesPerPixel;
+        for (int row = 0; row < height; ++row) {
+            std::memcpy(dst + static_cast<size_t>(y + row) * stride + static_cast<size_t>(x) * bytesPerPixel,
+                        payload, rowBytes);
+            payload += rowBytes;
+        }
+    }
+    return true;
+}
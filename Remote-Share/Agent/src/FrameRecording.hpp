@@ -0,0 +1,141 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "FrameView.hpp"
+
+// Raw frame recordings: what the capture stage handed downstream, so the same
+// input can be replayed into the pipeline run after run (ReplayFrameSource).
+// Everything is little-endian.
+//
+//   file header (16 bytes)
+//     u32 magic         kFileMagic ("RSRC")
+//     u16 version       kVersion
+//     u16 reserved
+//     u64 reserved
+//   frame records, back to back until the end of the file:
+//     frame header (32 bytes)
+//       u32 magic         kFrameMagic ("RSFR")
+//       u32 storedSize    payload bytes in the file
+//       u32 rawSize       payload bytes once decompressed
+//       u16 rectCount
+//       u16 width
+//       u16 height
+//       u8  format        PixelFormat
+//       u8  compression   Compression
+//       u32 reserved
+//       u64 timestampUs   capture time, microseconds after the first frame
+//     rectCount times: u16 x, u16 y, u16 width, u16 height
+//     storedSize bytes of payload
+//
+// The raw payload is the pixels of each rect in turn, rows top-down, each
+// width * bytes-per-pixel long with no padding. A frame's rects are what
+// changed since the previous frame; the first frame, and the first after a
+// size change, has one rect covering the whole frame.
+namespace FrameRecording {
+
+const uint32_t kFileMagic = 0x43525352;   // "RSRC"
+const uint32_t kFrameMagic = 0x52465352;  // "RSFR"
+const uint16_t kVersion = 1;
+const size_t kFileHeaderSize = 16;
+const size_t kFrameHeaderSize = 32;
+const size_t kRectSize = 8;
+
+enum class Compression : uint8_t {
+    None = 0,
+    Zstd = 1     // the whole payload as one zstd frame
+};
+
+struct FrameHeader {
+    uint32_t storedSize = 0;
+    uint32_t rawSize = 0;
+    uint16_t rectCount = 0;
+    uint16_t width = 0;
+    uint16_t height = 0;
+    PixelFormat format = PixelFormat::BGR24;
+    Compression compression = Compression::None;
+    uint64_t timestampUs = 0;
+};
+
+// True if this build can write (and read) zstd payloads.
+bool ZstdAvailable();
+
+} // namespace FrameRecording
+
+// Appends frames to a recording. Used from one thread (the pipeline's capture
+// thread); payload buffers are kept between frames.
+class FrameRecorder {
+public:
+    FrameRecorder();
+    ~FrameRecorder();
+    FrameRecorder(const FrameRecorder&) = delete;
+    FrameRecorder& operator=(const FrameRecorder&) = delete;
+
+    // Creates path, replacing it. compress asks for zstd, and is ignored
+    // (with a warning) in builds without it.
+    bool Open(const std::string& path, bool compress, int zstdLevel = 1);
+    void Close();
+    bool IsOpen() const { return m_file != nullptr; }
+
+    // Writes the frame's dirty rects, or all of it when full is set. A frame
+    // whose size differs from the previous one is always written whole.
+    bool Write(const FrameView& frame, bool full);
+
+    uint64_t FramesWritten() const { return m_frames; }
+    uint64_t RawBytes() const { return m_rawBytes; }
+    uint64_t StoredBytes() const { return m_storedBytes; }
+
+private:
+    FILE* m_file = nullptr;
+    bool m_compress = false;
+    int m_zstdLevel = 1;
+    void* m_zstd = nullptr;  // ZSTD_CCtx
+    uint64_t m_firstUs = 0;
+    int m_width = 0;
+    int m_height = 0;
+    std::vector<FrameRect> m_rects;
+    std::vector<uint8_t> m_raw;
+    std::vector<uint8_t> m_packed;
+    uint64_t m_frames = 0;
+    uint64_t m_rawBytes = 0;
+    uint64_t m_storedBytes = 0;
+};
+
+// A recording opened for reading. On POSIX systems the file is memory-mapped
+// and uncompressed payloads are read in place; elsewhere it is read into
+// memory once. Opening indexes every frame, so a damaged file is refused up
+// front rather than halfway through a run.
+class RecordingReader {
+public:
+    RecordingReader();
+    ~RecordingReader();
+    RecordingReader(const RecordingReader&) = delete;
+    RecordingReader& operator=(const RecordingReader&) = delete;
+
+    bool Open(const std::string& path);
+    void Close();
+
+    size_t FrameCount() const { return m_frames.size(); }
+    const FrameRecording::FrameHeader& Header(size_t index) const { return m_frames[index].header; }
+
+    // Draws frame index's rects into dst, which holds a frame of that
+    // frame's size, rows stride bytes apart.
+    bool Apply(size_t index, uint8_t* dst, int stride);
+
+private:
+    struct Entry {
+        FrameRecording::FrameHeader header;
+        size_t rectsOffset = 0;
+        size_t payloadOffset = 0;
+    };
+
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+    bool m_mapped = false;
+    std::vector<uint8_t> m_contents;  // when not mapped
+    std::vector<Entry> m_frames;
+    std::vector<uint8_t> m_scratch;   // decompressed payload
+    void* m_zstd = nullptr;           // ZSTD_DCtx
+};
@@ -0,0 +1,40 @@
+#pragma once
+#include <chrono>
+#include "FramePool.hpp"
+
+// Where the pipeline's frames come from. CaptureManager grabs the Windows
+// screen or a window, X11FrameSource an X11 one; SyntheticFrameSource draws
+// frames without a display, for the headless agent and benchmarks.
+//
+// Capture is only ever called from the pipeline's capture thread. Frames are
+// leased from the source's own pool, which must hold at least
+// FramePipeline::kPoolSlots frames.
+class FrameSource {
+public:
+    virtual ~FrameSource() = default;
+
+    // Grabs the current contents. Returns an empty lease if nothing could be
+    // captured this time (source gone, grab failed, every buffer in use).
+    virtual PooledFrame Capture() = 0;
+
+    // Sources that are told what changed (X11 with XDamage) return true and
+    // fill in each frame's DirtyRects themselves: everything that changed
+    // since the previous frame is inside them, and only the pixels inside
+    // them are current. The pipeline then sleeps in WaitForDamage instead of
+    // polling on its clock, and skips its own diff.
+    virtual bool ReportsDamage() const { return false; }
+
+    // Blocks until there is damage to capture, Wake is called or timeout
+    // passes. Returns true if there is damage.
+    virtual bool WaitForDamage(std::chrono::milliseconds timeout) {
+        (void)timeout;
+        return true;
+    }
+
+    // Makes the next frame cover the whole source, for a keyframe, and ends
+    // a wait. Any thread.
+    virtual void DamageAll() {}
+
+    // Ends a WaitForDamage early. Any thread.
+    virtual void Wake() {}
+};
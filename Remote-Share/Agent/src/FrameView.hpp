@@ -0,0 +1,61 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+enum class PixelFormat : uint8_t {
+    BGR24,   // 3 bytes per pixel, GDI 24-bpp DIB order
+    BGRX32   // 4 bytes per pixel, last byte ignored
+};
+
+inline int BytesPerPixel(PixelFormat format) {
+    return format == PixelFormat::BGRX32 ? 4 : 3;
+}
+
+struct FrameRect {
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+};
+
+// Non-owning description of a frame somewhere in memory. Rows are stride bytes
+// apart, which may be more than width * bytes-per-pixel (padded DIB rows) or a
+// lot more (a sub-rectangle of a bigger frame). Copying a view never copies
+// pixels; whoever handed it out keeps the memory alive.
+struct FrameView {
+    const uint8_t* data = nullptr;
+    int width = 0;
+    int height = 0;
+    int stride = 0;
+    PixelFormat format = PixelFormat::BGR24;
+    uint64_t timestampUs = 0;            // steady_clock time of capture
+    const FrameRect* dirtyRects = nullptr; // regions changed since the previous frame
+    size_t dirtyCount = 0;
+
+    bool Empty() const { return data == nullptr || width <= 0 || height <= 0; }
+
+    const uint8_t* Row(int y) const {
+        return data + static_cast<size_t>(y) * static_cast<size_t>(stride);
+    }
+
+    // View of a sub-rectangle, clipped to the frame. Shares the parent's rows
+    // and stride; the dirty list is not carried over.
+    FrameView SubView(const FrameRect& rect) const {
+        int x0 = rect.x < 0 ? 0 : rect.x;
+        int y0 = rect.y < 0 ? 0 : rect.y;
+        int x1 = rect.x + rect.width > width ? width : rect.x + rect.width;
+        int y1 = rect.y + rect.height > height ? height : rect.y + rect.height;
+
+        FrameView sub;
+        if (x1 <= x0 || y1 <= y0) {
+            return sub;
+        }
+        sub.data = Row(y0) + static_cast<size_t>(x0) * BytesPerPixel(format);
+        sub.width = x1 - x0;
+        sub.height = y1 - y0;
+        sub.stride = stride;
+        sub.format = format;
+        sub.timestampUs = timestampUs;
+        return sub;
+    }
+};
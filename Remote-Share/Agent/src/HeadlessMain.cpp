@@ -0,0 +1,470 @@
+// RemoteShareAgentHeadless: the agent's pipeline fed by a SyntheticFrameSource,
+// a recording (ReplayFrameSource) or, where built with X11, an X display such
+// as Xvfb instead of the Windows screen, with viewer input counted instead of
+// injected. Builds anywhere the core library does, so encode, framing,
+// transport and pacing can be measured on machines without a desktop.
+#include "FramePipeline.hpp"
+#include "ImageProcessor.hpp"
+#include "InputThread.hpp"
+#include "LatencyHistogram.hpp"
+#include "Metrics.hpp"
+#include "ReplayFrameSource.hpp"
+#include "SyntheticFrameSource.hpp"
+#include "Trace.hpp"
+#include "ViewerMessage.hpp"
+#include "WebSocketClient.hpp"
+#ifdef REMOTE_SHARE_HAVE_X11
+#include "X11FrameSource.hpp"
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <nlohmann/json.hpp>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+const char kDefaultHost[] = "localhost";
+const char kDefaultPort[] = "8080";
+const char kDefaultSessionId[] = "def_pas";
+const int JPEG_QUALITY = 80;
+
+std::atomic<bool> g_stop{false};
+
+void OnSignal(int) {
+    g_stop.store(true);
+}
+
+// Viewer input has nowhere to go without a desktop; keep count so input
+// latency and coalescing can still be exercised.
+class CountingInputSink : public InputSink {
+public:
+    void Inject(const std::vector<InputEvent>& events) override {
+        m_events.fetch_add(events.size(), std::memory_order_relaxed);
+    }
+    uint64_t Events() const { return m_events.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> m_events{0};
+};
+
+void PrintUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [host] [options]\n"
+              << "  --port N            relay port (default " << kDefaultPort << ")\n"
+              << "  --session ID        session to stream into (default " << kDefaultSessionId << ")\n"
+              << "  --source NAME       synthetic (default), replay:PATH for a recording"
+#ifdef REMOTE_SHARE_HAVE_X11
+              << ", x11 for the root window of $DISPLAY, x11:WINDOW for one window"
+#endif
+              << "\n"
+#ifdef REMOTE_SHARE_HAVE_X11
+              << "  --damage            x11: capture on XDamage reports instead of polling\n"
+#endif
+              << "  --replay-speed S    recorded (default) or max: one recorded frame per capture,\n"
+              << "                      paced by --fps\n"
+              << "  --loop              replay: start over at the end instead of stopping\n"
+              << "  --size WxH          synthetic screen size, up to 7680x4320 and beyond (default 1920x1080)\n"
+              << "  --workload NAME     synthetic: idle, typing, scrolling, drag (default), video or noise\n"
+              << "  --change-rate N     synthetic: N content changes per second (default: one per capture)\n"
+              << "  --fps N             capture rate while the screen changes (default 30)\n"
+              << "  --duration SEC      stop after SEC seconds (default: run until interrupted)\n"
+              << "  --text-frames       send JSON + base64 frames\n"
+              << "  --encode-threads N  JPEG encoder threads\n"
+              << "  --stats-file PATH   append a latency table every 10 seconds\n"
+              << "  --trace PATH        write a Chrome trace of every frame on exit\n"
+              << "  --record PATH       record every frame sent, for --source replay:PATH\n"
+              << "  --record-raw        do not zstd-compress the recording\n"
+              << "  --bench-capture N   time N captures from the source and exit, without connecting"
+              << std::endl;
+}
+
+struct SourceOptions {
+    std::string spec = "synthetic";
+    SyntheticOptions synthetic;
+    bool damage = false;
+    ReplayFrameSource::Speed replaySpeed = ReplayFrameSource::Speed::Recorded;
+    bool loop = false;
+};
+
+// Sets width and height to the size frames will have. Returns nullptr (with
+// the reason logged) if the source cannot be used.
+std::unique_ptr<FrameSource> MakeSource(const SourceOptions& options, int& width, int& height) {
+    const std::string& spec = options.spec;
+    if (spec == "synthetic") {
+        SyntheticOptions synthetic = options.synthetic;
+        synthetic.width = width;
+        synthetic.height = height;
+        return std::unique_ptr<FrameSource>(new SyntheticFrameSource(synthetic, FramePipeline::kPoolSlots));
+    }
+    if (spec.compare(0, 7, "replay:") == 0) {
+        std::unique_ptr<ReplayFrameSource> source(new ReplayFrameSource(
+            spec.substr(7), options.replaySpeed, options.loop, FramePipeline::kPoolSlots));
+        if (!source->IsOpen()) {
+            return nullptr;
+        }
+        width = source->Width();
+        height = source->Height();
+        return std::unique_ptr<FrameSource>(source.release());
+    }
+#ifdef REMOTE_SHARE_HAVE_X11
+    if (spec.compare(0, 3, "x11") == 0) {
+        unsigned long window = X11FrameSource::kRootWindow;
+        if (spec.size() > 3 && (spec[3] != ':' || !ParseX11Window(spec.substr(4), window))) {
+            std::cerr << "Bad --source, expected x11:WINDOW with a window id: " << spec << std::endl;
+            return nullptr;
+        }
+        std::unique_ptr<X11FrameSource> source(new X11FrameSource(nullptr, FramePipeline::kPoolSlots, options.damage));
+        if (!source->IsOpen()) {
+            return nullptr;
+        }
+        source->SetTarget(window);
+        if (!source->QuerySize(width, height)) {
+            std::cerr << "X11 window " << spec.substr(4) << " does not exist or is not on screen" << std::endl;
+            return nullptr;
+        }
+        return std::unique_ptr<FrameSource>(source.release());
+    }
+#endif
+    std::cerr << "Unknown --source: " << spec << std::endl;
+    return nullptr;
+}
+
+// Captures back to back with nothing downstream, one buffer in flight, and
+// prints the cost per frame and per megapixel. The first few frames grow the
+// pool and are left out.
+int RunCaptureBench(FrameSource& source, int frames) {
+    const int kWarmupFrames = 5;
+    for (int i = 0; i < kWarmupFrames; ++i) {
+        source.Capture();
+    }
+
+    LatencyHistogram histogram;
+    uint64_t pixels = 0;
+    uint64_t failures = 0;
+    uint64_t startUs = Metrics::NowUs();
+    for (int i = 0; i < frames && !g_stop.load(); ++i) {
+        uint64_t frameStartUs = Metrics::NowUs();
+        PooledFrame frame = source.Capture();
+        histogram.Record(Metrics::NowUs() - frameStartUs);
+        if (frame) {
+            pixels += static_cast<uint64_t>(frame.Width()) * static_cast<uint64_t>(frame.Height());
+        } else {
+            ++failures;
+        }
+    }
+    uint64_t elapsedUs = std::max<uint64_t>(1, Metrics::NowUs() - startUs);
+
+    LatencyHistogram::Snapshot snapshot;
+    histogram.TakeSnapshot(snapshot);
+    LatencySummary summary = snapshot.Summarize();
+    if (pixels == 0) {
+        std::cerr << "No frames captured" << std::endl;
+        return 1;
+    }
+    double mpix = static_cast<double>(pixels) / 1e6;
+    std::printf("capture: %llu frames, %llu failed, %.1f fps\n"
+                "  per frame   mean %.0f us  p50 %llu us  p99 %llu us  max %llu us\n"
+                "  per Mpix    %.0f us (%.2f Gpix/s)\n",
+                static_cast<unsigned long long>(summary.count), static_cast<unsigned long long>(failures),
+                summary.count * 1e6 / elapsedUs, summary.mean, static_cast<unsigned long long>(summary.p50),
+                static_cast<unsigned long long>(summary.p99), static_cast<unsigned long long>(summary.max),
+                elapsedUs / mpix, mpix * 1e3 / elapsedUs);
+    return failures == 0 ? 0 : 1;
+}
+
+// User plus system CPU time of the whole process; 0 where not available.
+uint64_t ProcessCpuUs() {
+#ifndef _WIN32
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        return static_cast<uint64_t>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000 +
+               static_cast<uint64_t>(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+    }
+#endif
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string host = kDefaultHost;
+    std::string port = kDefaultPort;
+    std::string session_id = kDefaultSessionId;
+    int width = 1920;
+    int height = 1080;
+    int duration_sec = 0;
+    std::string stats_file;
+    std::string trace_path;
+    SourceOptions source_options;
+    int bench_frames = 0;
+    std::string record_path;
+    bool record_compressed = true;
+    PipelineOptions pipeline_options;
+    pipeline_options.jpegQuality = JPEG_QUALITY;
+    bool host_given = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--port" && has_value) {
+            port = argv[++i];
+        } else if (arg == "--session" && has_value) {
+            session_id = argv[++i];
+        } else if (arg == "--source" && has_value) {
+            source_options.spec = argv[++i];
+        } else if (arg == "--workload" && has_value) {
+            if (!ParseSyntheticWorkload(argv[++i], source_options.synthetic.workload)) {
+                std::cerr << "Bad --workload, expected idle, typing, scrolling, drag, video or noise: " << argv[i]
+                          << std::endl;
+                return 1;
+            }
+        } else if (arg == "--change-rate" && has_value) {
+            source_options.synthetic.changesPerSec = std::atof(argv[++i]);
+            if (source_options.synthetic.changesPerSec <= 0.0) {
+                std::cerr << "Bad --change-rate, expected changes per second: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (arg == "--damage") {
+            source_options.damage = true;
+        } else if (arg == "--replay-speed" && has_value) {
+            std::string speed = argv[++i];
+            if (speed == "recorded") {
+                source_options.replaySpeed = ReplayFrameSource::Speed::Recorded;
+            } else if (speed == "max") {
+                source_options.replaySpeed = ReplayFrameSource::Speed::Max;
+            } else {
+                std::cerr << "Bad --replay-speed, expected recorded or max: " << speed << std::endl;
+                return 1;
+            }
+        } else if (arg == "--loop") {
+            source_options.loop = true;
+        } else if (arg == "--record" && has_value) {
+            record_path = argv[++i];
+        } else if (arg == "--record-raw") {
+            record_compressed = false;
+        } else if (arg == "--bench-capture" && has_value) {
+            bench_frames = std::atoi(argv[++i]);
+            if (bench_frames <= 0) {
+                std::cerr << "Bad --bench-capture, expected a frame count: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (arg == "--size" && has_value) {
+            if (std::sscanf(argv[++i], "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0) {
+                std::cerr << "Bad --size, expected WxH: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (arg == "--fps" && has_value) {
+            double fps = std::atof(argv[++i]);
+            if (fps > 0.0) {
+                pipeline_options.activeFps = fps;
+                pipeline_options.burstFps = std::max(fps, pipeline_options.burstFps);
+            }
+        } else if (arg == "--duration" && has_value) {
+            duration_sec = std::atoi(argv[++i]);
+        } else if (arg == "--text-frames") {
+            pipeline_options.textFrames = true;
+        } else if (arg == "--encode-threads" && has_value) {
+            int threads = std::atoi(argv[++i]);
+            pipeline_options.encodeThreads = threads > 0 ? static_cast<size_t>(threads) : 0;
+        } else if (arg == "--stats-file" && has_value) {
+            stats_file = argv[++i];
+        } else if (arg == "--trace" && has_value) {
+            trace_path = argv[++i];
+        } else if (arg == "--help" || arg == "-h") {
+            PrintUsage(argv[0]);
+            return 0;
+        } else if (!host_given && arg.compare(0, 2, "--") != 0) {
+            host = arg;
+            host_given = true;
+        } else {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::signal(SIGINT, OnSignal);
+    std::signal(SIGTERM, OnSignal);
+
+    if (!trace_path.empty()) {
+        Trace::Enable();
+        Trace::SetThreadName("main");
+    }
+
+    std::unique_ptr<FrameSource> source = MakeSource(source_options, width, height);
+    if (!source) {
+        return 1;
+    }
+    if (bench_frames > 0) {
+        return RunCaptureBench(*source, bench_frames);
+    }
+    // Replays end the run once the last frame is out (unless looping).
+    const ReplayFrameSource* replay = dynamic_cast<const ReplayFrameSource*>(source.get());
+
+    FrameRecorder recorder;
+    if (!record_path.empty() && !recorder.Open(record_path, record_compressed)) {
+        return 1;
+    }
+
+    try {
+        ImageProcessor::InitializeCompressor();
+    } catch (const std::runtime_error& e) {
+        std::cerr << "Error initializing ImageProcessor: " << e.what() << std::endl;
+        return 1;
+    }
+
+    std::string server_url = "ws://" + host + ":" + port + "/agent?sessionId=" + session_id;
+    std::string source_name = source_options.spec;
+    if (source_name == "synthetic") {
+        source_name += std::string(" ") + SyntheticWorkloadName(source_options.synthetic.workload);
+    }
+    std::cout << "Streaming a " << source_name << " " << width << "x" << height << " screen to " << server_url
+              << std::endl;
+
+    WebSocketClient ws_client(server_url);
+    CountingInputSink input_sink;
+    InputThread input_thread(input_sink);
+    Metrics metrics;
+    FramePipeline pipeline(*source, ws_client, metrics, pipeline_options);
+    if (recorder.IsOpen()) {
+        pipeline.SetRecorder(&recorder);
+    }
+
+    ws_client.setOnOpenHandler([]() {
+        std::cout << "WebSocket connected to server." << std::endl;
+    });
+    ws_client.setOnCloseHandler([]() {
+        std::cerr << "WebSocket disconnected from server. Attempting reconnect..." << std::endl;
+    });
+    ws_client.setOnFrameWrittenHandler([&pipeline](const FrameTiming& timing) {
+        pipeline.OnFrameWritten(timing);
+    });
+    ws_client.setOnMessageHandler([&input_thread, &pipeline](const std::string& message) {
+        InputEvent event;
+        switch (ParseViewerMessage(message, event)) {
+        case ViewerCommand::Input:
+            pipeline.NotifyActivity();
+            input_thread.Post(event);
+            break;
+        case ViewerCommand::Keyframe:
+            pipeline.RequestKeyframe();
+            break;
+        case ViewerCommand::Close:
+            std::cout << "Received close connection command from viewer." << std::endl;
+            g_stop.store(true);
+            break;
+        case ViewerCommand::ToggleFullscreen:
+        case ViewerCommand::None:
+            break;
+        }
+    });
+
+    input_thread.Start();
+    try {
+        ws_client.connect();
+    } catch (const std::exception& e) {
+        std::cerr << "WebSocket connection failed: " << e.what() << std::endl;
+        ImageProcessor::ShutdownCompressor();
+        return 1;
+    }
+
+    int connect_timeout_ms = 5000;
+    int elapsed_ms = 0;
+    while (!ws_client.isConnected() && elapsed_ms < connect_timeout_ms && !g_stop.load()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        elapsed_ms += 100;
+    }
+    if (!ws_client.isConnected()) {
+        std::cerr << "Failed to connect to WebSocket server." << std::endl;
+        input_thread.Stop();
+        ImageProcessor::ShutdownCompressor();
+        return 1;
+    }
+
+    nlohmann::json screen_info = {
+        {"type", "screen_info"},
+        {"width", width},
+        {"height", height},
+        {"scaleX", 1.0},
+        {"scaleY", 1.0}
+    };
+    ws_client.send(screen_info.dump());
+
+    pipeline.Start();
+    uint64_t run_start_us = Metrics::NowUs();
+    uint64_t run_start_cpu_us = ProcessCpuUs();
+
+    // Same reporting as the Windows agent: a stats message every couple of
+    // seconds, a table to stdout (and --stats-file) every ten.
+    const int kStatsIntervalSec = 2;
+    const int kConsoleIntervalSec = 10;
+    MetricsReport report;
+    for (int tick = 1; !g_stop.load() && (duration_sec <= 0 || tick <= duration_sec); ++tick) {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        if (replay && replay->Finished()) {
+            std::cout << "Replay finished after " << replay->FramesReplayed() << " frames." << std::endl;
+            g_stop.store(true);
+        }
+        if (tick % kStatsIntervalSec == 0) {
+            MetricsCounters counters;
+            pipeline.FillCounters(counters);
+            metrics.TakeReport(counters, report);
+            if (ws_client.isConnected()) {
+                ws_client.send(report.ToJson());
+            }
+        }
+        if (tick % kConsoleIntervalSec == 0) {
+            std::string text = report.ToText();
+            std::cout << text << std::flush;
+            if (!stats_file.empty()) {
+                std::ofstream out(stats_file, std::ios::app);
+                if (out) {
+                    out << text << std::endl;
+                }
+            }
+        }
+    }
+
+    pipeline.Stop();
+    input_thread.Stop();
+    uint64_t run_us = std::max<uint64_t>(1, Metrics::NowUs() - run_start_us);
+    uint64_t run_cpu_us = ProcessCpuUs() - run_start_cpu_us;
+
+    // The whole run, for CI logs.
+    MetricsCounters counters;
+    pipeline.FillCounters(counters);
+    metrics.TotalReport(counters, report);
+    std::cout << report.ToText() << "input: " << input_sink.Events() << " events" << std::endl;
+    // One line per run, for charting soak tests and benchmarks across
+    // workloads and resolutions. CPU is of all cores: 200% is two busy ones.
+    std::printf("summary: %s %dx%d, %.1f fps, %.1f KB/frame, %.2f Mbit/s, %.0f%% CPU\n", source_name.c_str(), width,
+                height, report.Fps(), report.BytesPerFrame() / 1e3, report.SendMbps(), run_cpu_us * 100.0 / run_us);
+    if (recorder.IsOpen()) {
+        recorder.Close();
+        std::printf("recording: %llu frames, %.1f MB (%.1f MB raw) in %s\n",
+                    static_cast<unsigned long long>(recorder.FramesWritten()), recorder.StoredBytes() / 1e6,
+                    recorder.RawBytes() / 1e6, record_path.c_str());
+    }
+    if (!stats_file.empty()) {
+        std::ofstream out(stats_file, std::ios::app);
+        if (out) {
+            out << report.ToText() << std::endl;
+        }
+    }
+    if (!trace_path.empty()) {
+        Trace::Dump(trace_path);
+    }
+
+    ImageProcessor::ShutdownCompressor();
+    return 0;
+}
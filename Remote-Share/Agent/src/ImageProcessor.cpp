@@ -3,33 +3,46 @@
 #include <stdexcept>
 #include <vector>
 
-tjhandle ImageProcessor::s_jpegCompressor = nullptr;
+namespace {
 
-static const std::string base64_chars =
-             "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
-             "abcdefghijklmnopqrstuvwxyz"
-             "0123456789+/";
+// All frames use the same subsampling, so MaxJpegSize does not depend on the
+// caller.
+const int kSubsampling = TJSAMP_420;
 
-std::string ImageProcessor::base64_encode_impl(const std::vector<uint8_t>& in) {
-    std::string out;
-    int val = 0, valb = -6;
-    for (uint8_t c : in) {
-        val = (val << 8) + c;
-        valb += 8;
-        while (valb >= 0) {
-            out.push_back(base64_chars[(val >> valb) & 0x3F]);
-            valb -= 6;
+// Owns one thread's compressor and frees it when the thread exits.
+struct ThreadCompressor {
+    tjhandle handle = nullptr;
+    int quality = -1;  // last quality passed to tj3Set
+    ~ThreadCompressor() {
+        if (handle) {
+            tj3Destroy(handle);
         }
     }
-    if (valb > -6) {
-        out.push_back(base64_chars[((val << 8) >> (valb + 8)) & 0x3F]);
-    }
-    while (out.size() % 4) {
-        out.push_back('=');
+};
+
+thread_local ThreadCompressor t_compressor;
+
+ThreadCompressor* GetThreadCompressor() {
+    if (!t_compressor.handle) {
+        tjhandle handle = tj3Init(TJINIT_COMPRESS);
+        if (!handle) {
+            const char* error_str = tj3GetErrorStr(NULL);
+            std::cerr << "Failed to initialize libjpeg-turbo compressor: " << (error_str ? error_str : "Unknown error") << std::endl;
+            return nullptr;
+        }
+        // Settings that never change are applied once per handle. With
+        // NOREALLOC the caller's buffer is used as-is and never replaced.
+        tj3Set(handle, TJPARAM_SUBSAMP, kSubsampling);
+        tj3Set(handle, TJPARAM_FASTDCT, 1);
+        tj3Set(handle, TJPARAM_NOREALLOC, 1);
+        t_compressor.handle = handle;
+        t_compressor.quality = -1;
     }
-    return out;
+    return &t_compressor;
 }
 
+} // namespace
+
 ImageProcessor::ImageProcessor() {
 }
 
@@ -37,61 +50,60 @@ ImageProcessor::~ImageProcessor() {
 }
 
 void ImageProcessor::InitializeCompressor() {
-    if (!s_jpegCompressor) {
-        s_jpegCompressor = tjInitCompress();
-        if (!s_jpegCompressor) {
-            const char* error_str = tjGetErrorStr();
-            std::cerr << "Failed to initialize libjpeg-turbo compressor: " << (error_str ? error_str : "Unknown error") << std::endl;
-            throw std::runtime_error("Failed to initialize libjpeg-turbo compressor.");
-        }
+    if (!GetThreadCompressor()) {
+        throw std::runtime_error("Failed to initialize libjpeg-turbo compressor.");
     }
 }
 
 void ImageProcessor::ShutdownCompressor() {
-    if (s_jpegCompressor) {
-        tjDestroy(s_jpegCompressor);
-        s_jpegCompressor = nullptr;
+    if (t_compressor.handle) {
+        tj3Destroy(t_compressor.handle);
+        t_compressor.handle = nullptr;
     }
 }
 
-std::vector<uint8_t> ImageProcessor::CompressToJpeg(const std::vector<uint8_t>& pixelData, int width, int height, int quality) {
-    std::vector<uint8_t> jpegData;
-    if (!s_jpegCompressor) {
-        std::cerr << "libjpeg-turbo compressor not initialized." << std::endl;
-        return jpegData;
+size_t ImageProcessor::MaxJpegSize(int width, int height) {
+    if (width <= 0 || height <= 0) {
+        return 0;
     }
-    if (pixelData.empty() || width <= 0 || height <= 0) {
+    return tj3JPEGBufSize(width, height, kSubsampling);
+}
+
+size_t ImageProcessor::CompressToJpeg(const FrameView& frame, uint8_t* dst, size_t capacity, int quality) {
+    ThreadCompressor* compressor = GetThreadCompressor();
+    if (!compressor) {
+        return 0;
+    }
+    if (frame.Empty() || frame.stride < frame.width * BytesPerPixel(frame.format)) {
         std::cerr << "Invalid pixel data or dimensions for JPEG compression." << std::endl;
-        return jpegData;
+        return 0;
+    }
+    if (!dst || capacity == 0) {
+        std::cerr << "No output buffer for JPEG compression." << std::endl;
+        return 0;
     }
-    unsigned char* jpegBuf = NULL; 
-    unsigned long jpegSize = 0;    
-    int pixelFormat = TJPF_BGR; 
-    int result = tjCompress2(s_jpegCompressor,
-                             pixelData.data(),      
-                             width,                 
-                             width * 3,             
-                             height,                
-                             pixelFormat,           
-                             &jpegBuf,              
-                             &jpegSize,             
-                             TJSAMP_420,            
-                             quality,               
-                             TJFLAG_FASTDCT         
-                            );
+    if (quality != compressor->quality) {
+        tj3Set(compressor->handle, TJPARAM_QUALITY, quality);
+        compressor->quality = quality;
+    }
+
+    // The view's stride is passed through as-is, so padded DIB rows and
+    // sub-rectangles of a larger frame compress without repacking.
+    int pixelFormat = frame.format == PixelFormat::BGRX32 ? TJPF_BGRX : TJPF_BGR;
+    unsigned char* jpegBuf = dst;
+    size_t jpegSize = capacity;
+    int result = tj3Compress8(compressor->handle,
+                              frame.data,
+                              frame.width,
+                              frame.stride,
+                              frame.height,
+                              pixelFormat,
+                              &jpegBuf,
+                              &jpegSize);
     if (result != 0) {
-        const char* error_str = tjGetErrorStr();
+        const char* error_str = tj3GetErrorStr(compressor->handle);
         std::cerr << "Failed to compress image with libjpeg-turbo: " << (error_str ? error_str : "Unknown error") << std::endl;
-        if (jpegBuf) { 
-            tjFree(jpegBuf);
-        }
-        return jpegData;
+        return 0;
     }
-    jpegData.assign(jpegBuf, jpegBuf + jpegSize);
-    tjFree(jpegBuf);
-    return jpegData;
+    return jpegSize;
 }
-
-std::string ImageProcessor::EncodeToBase64(const std::vector<uint8_t>& binaryData) {
-    return base64_encode_impl(binaryData);
-}
\ No newline at end of file
@@ -4,16 +4,23 @@
 #include <string>
 #include <cstdint>
 #include <turbojpeg.h> 
+#include "FrameView.hpp"
 class ImageProcessor {
 public:
     ImageProcessor();
     ~ImageProcessor();
+    // Each thread compresses with its own tjhandle, created on first use and
+    // destroyed when the thread exits, so CompressToJpeg is safe to call from
+    // several threads at once. Initialize/Shutdown act on the calling
+    // thread's handle; Initialize throws if libjpeg-turbo is unusable.
     static void InitializeCompressor();
     static void ShutdownCompressor();
-    static std::vector<uint8_t> CompressToJpeg(const std::vector<uint8_t>& pixelData, int width, int height, int quality = 80);
-    static std::string EncodeToBase64(const std::vector<uint8_t>& binaryData);
-private:
-    static tjhandle s_jpegCompressor;
-    static std::string base64_encode_impl(const std::vector<uint8_t>& in);
+    // Largest JPEG a width x height frame can compress to. A buffer this big
+    // always fits the output.
+    static size_t MaxJpegSize(int width, int height);
+    // Compresses straight into dst, which holds capacity bytes; nothing is
+    // allocated. Returns the JPEG size, or 0 on failure (including a dst
+    // smaller than the JPEG turned out to be).
+    static size_t CompressToJpeg(const FrameView& frame, uint8_t* dst, size_t capacity, int quality = 80);
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,73 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+// One viewer input event, decoded on the network thread and injected later on
+// the input thread (see InputThread). Fixed size and trivially copyable, so
+// decoding one never touches the heap.
+struct InputEvent {
+    // Order matches ParseType's name table.
+    enum class Type : uint8_t {
+        MouseMove,
+        MouseDown,
+        MouseUp,
+        Click,
+        ContextMenu,
+        Wheel,
+        KeyDown,
+        KeyUp
+    };
+
+    // Longest browser `key`/`code` string kept. Longer names (media and
+    // browser keys) have no mapping anyway and are stored empty.
+    static const size_t kMaxKeyLength = 16;
+
+    Type type = Type::MouseMove;
+    int x = 0;
+    int y = 0;
+    int button = -1;
+    int deltaY = 0;
+    uint64_t timestampUs = 0;  // viewer clock, 0 if unknown
+    bool ctrlKey = false;
+    bool shiftKey = false;
+    bool altKey = false;
+    bool metaKey = false;
+
+    bool IsKeyboard() const { return type == Type::KeyDown || type == Type::KeyUp; }
+
+    std::string_view Key() const { return std::string_view(m_key, m_keyLength); }
+    std::string_view Code() const { return std::string_view(m_code, m_codeLength); }
+    void SetKey(std::string_view key) { m_keyLength = Store(key, m_key); }
+    void SetCode(std::string_view code) { m_codeLength = Store(code, m_code); }
+
+    // Maps the viewer's inputType ("mousemove", "keydown", ...). Returns
+    // false for types the agent does not inject.
+    static bool ParseType(std::string_view inputType, Type& type) {
+        static const std::string_view kNames[] = {
+            "mousemove", "mousedown", "mouseup", "click", "contextmenu", "wheel", "keydown", "keyup"
+        };
+        for (size_t i = 0; i < sizeof(kNames) / sizeof(kNames[0]); ++i) {
+            if (kNames[i] == inputType) {
+                type = static_cast<Type>(i);
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    static uint8_t Store(std::string_view value, char* out) {
+        if (value.size() > kMaxKeyLength) {
+            return 0;
+        }
+        std::memcpy(out, value.data(), value.size());
+        return static_cast<uint8_t>(value.size());
+    }
+
+    char m_key[kMaxKeyLength] = {};
+    char m_code[kMaxKeyLength] = {};
+    uint8_t m_keyLength = 0;
+    uint8_t m_codeLength = 0;
+};
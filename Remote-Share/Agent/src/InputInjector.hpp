@@ -3,11 +3,20 @@
 #include <string>
 #include <vector>
 #include <Windows.h> // Required for INPUT structure and other Windows API types
-#include <map>       // For key code mapping
+#include <string_view>
+#include "InputEvent.hpp"
+#include "InputSink.hpp"
 
-class InputInjector {
+class InputInjector : public InputSink {
 public:
-    InputInjector(); // Constructor to initialize key mappings
+    InputInjector();
+
+    // Injects a batch of events with a single SendInput call, in order.
+    void Inject(const std::vector<InputEvent>& events) override;
+
+    // Re-reads the screen size used to scale mouse coordinates. Call when the
+    // display configuration changes; it is cached otherwise.
+    void RefreshScreenMetrics() override;
 
     // Injects a mouse event
     // @param inputType: "mousemove", "mousedown", "mouseup", "click", "contextmenu", "wheel"
@@ -29,16 +38,14 @@ private:
     // Helper function to send an array of INPUT structures
     void SendInputEvents(const std::vector<INPUT>& inputs);
 
-    // Get screen dimensions for mouse scaling
-    int GetScreenWidth();
-    int GetScreenHeight();
-
-    // Map browser key 'code' to Windows Virtual Key Code (VK)
-    std::map<std::string, WORD> browserCodeToVkMap;
-
-    // Initialize the mapping from browser 'code' strings to Windows Virtual Key Codes
-    void InitializeKeyMap();
+    // Append the INPUT structures for one event to inputs
+    void AppendMouseInput(InputEvent::Type type, int x, int y, int button, int deltaY,
+                          std::vector<INPUT>& inputs);
+    void AppendKeyboardInput(InputEvent::Type type, std::string_view key, std::string_view code,
+                             std::vector<INPUT>& inputs);
 
-    // Helper to get virtual key for standard keys (like 'A', '1', 'Enter')
-    WORD GetVirtualKey(const std::string& key);
+    // Cached screen dimensions for mouse scaling
+    int m_screenWidth = 0;
+    int m_screenHeight = 0;
+    std::vector<INPUT> m_batch;  // reused by Inject
 };
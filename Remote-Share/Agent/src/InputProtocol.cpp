@@ -0,0 +1,59 @@
+#include "InputProtocol.hpp"
+
+namespace {
+
+uint16_t ReadU16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+uint64_t ReadU64(const uint8_t* p) {
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; --i) {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+} // namespace
+
+namespace InputProtocol {
+
+bool IsInputRecord(const uint8_t* data, size_t size) {
+    return size == kRecordSize && data[0] == FrameProtocol::kVersion &&
+           data[1] == static_cast<uint8_t>(FrameProtocol::MessageType::Input);
+}
+
+bool ParseRecord(const uint8_t* data, size_t size, InputEvent& event) {
+    if (!IsInputRecord(data, size)) {
+        return false;
+    }
+    uint8_t kind = data[2];
+    if (kind < static_cast<uint8_t>(Kind::MouseMove) || kind > static_cast<uint8_t>(Kind::KeyUp)) {
+        return false;
+    }
+    // Kind is InputEvent::Type shifted by one so that 0 is never valid.
+    event.type = static_cast<InputEvent::Type>(kind - 1);
+
+    uint8_t modifiers = data[3];
+    event.ctrlKey = (modifiers & kCtrl) != 0;
+    event.shiftKey = (modifiers & kShift) != 0;
+    event.altKey = (modifiers & kAlt) != 0;
+    event.metaKey = (modifiers & kMeta) != 0;
+
+    event.x = ReadU16(data + 4);
+    event.y = ReadU16(data + 6);
+    event.button = static_cast<int8_t>(data[8]);
+    event.deltaY = static_cast<int16_t>(ReadU16(data + 10));
+
+    size_t keyLength = data[12];
+    size_t codeLength = data[13];
+    if (keyLength > InputEvent::kMaxKeyLength || codeLength > InputEvent::kMaxKeyLength) {
+        return false;
+    }
+    event.timestampUs = ReadU64(data + 16);
+    event.SetCode(std::string_view(reinterpret_cast<const char*>(data + 24), codeLength));
+    event.SetKey(std::string_view(reinterpret_cast<const char*>(data + 40), keyLength));
+    return true;
+}
+
+} // namespace InputProtocol
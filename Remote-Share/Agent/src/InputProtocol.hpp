@@ -0,0 +1,59 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "FrameProtocol.hpp"
+#include "InputEvent.hpp"
+
+// Binary input messages sent by the viewer as WebSocket binary messages, one
+// fixed-size record per event. Little-endian, same version byte as the frame
+// protocol:
+//
+//   input record (56 bytes)
+//     u8  version       FrameProtocol::kVersion
+//     u8  type          FrameProtocol::MessageType::Input
+//     u8  kind          Kind
+//     u8  modifiers     Modifier bits
+//     u16 x             remote screen coordinates, already scaled by the viewer
+//     u16 y
+//     i8  button        MouseEvent.button, -1 for none
+//     u8  reserved
+//     i16 deltaY        wheel delta, rounded and clamped
+//     u8  keyLength     bytes used in key
+//     u8  codeLength    bytes used in code
+//     u16 reserved
+//     u64 timestampUs   event time on the viewer's clock
+//     u8  code[16]      KeyboardEvent.code, ASCII
+//     u8  key[16]       KeyboardEvent.key, UTF-8
+//
+// A key or code longer than 16 bytes is sent with length 0. The viewer may
+// still send JSON "input" messages; the agent accepts both.
+namespace InputProtocol {
+
+const size_t kRecordSize = 56;
+
+enum class Kind : uint8_t {
+    MouseMove = 1,
+    MouseDown = 2,
+    MouseUp = 3,
+    Click = 4,
+    ContextMenu = 5,
+    Wheel = 6,
+    KeyDown = 7,
+    KeyUp = 8
+};
+
+enum Modifier : uint8_t {
+    kCtrl = 1 << 0,
+    kShift = 1 << 1,
+    kAlt = 1 << 2,
+    kMeta = 1 << 3
+};
+
+// True if the message is an input record (right version, type and size).
+bool IsInputRecord(const uint8_t* data, size_t size);
+
+// Decodes an input record. Returns false, leaving event unspecified, if the
+// message is not a valid record.
+bool ParseRecord(const uint8_t* data, size_t size, InputEvent& event);
+
+} // namespace InputProtocol
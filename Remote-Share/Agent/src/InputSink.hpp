@@ -0,0 +1,18 @@
+#pragma once
+#include <vector>
+#include "InputEvent.hpp"
+
+// Where viewer input ends up. InputInjector replays it through SendInput on
+// Windows; the headless agent only counts it.
+//
+// Both calls come from the input thread only.
+class InputSink {
+public:
+    virtual ~InputSink() = default;
+
+    // Injects a batch of events, in order.
+    virtual void Inject(const std::vector<InputEvent>& events) = 0;
+
+    // The display configuration changed; re-read anything cached about it.
+    virtual void RefreshScreenMetrics() {}
+};
@@ -0,0 +1,206 @@
+#include "InputThread.hpp"
+#include "Trace.hpp"
+#include <iostream>
+
+#ifdef _WIN32
+namespace {
+const wchar_t kNotifyWindowClass[] = L"RemoteShareInputNotify";
+}
+#endif
+
+InputThread::InputThread(InputSink& sink)
+    : m_sink(sink) {
+#ifdef _WIN32
+    m_wake = CreateEventW(NULL, FALSE, FALSE, NULL);
+#endif
+}
+
+InputThread::~InputThread() {
+    Stop();
+#ifdef _WIN32
+    if (m_wake) {
+        CloseHandle(m_wake);
+    }
+#endif
+}
+
+void InputThread::Start() {
+    if (m_running.exchange(true)) {
+        return;
+    }
+    m_thread = std::thread(&InputThread::Run, this);
+}
+
+void InputThread::Stop() {
+    m_running.store(false);
+    Wake();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+void InputThread::Post(const InputEvent& event) {
+    ++m_stats.eventsPosted;
+    InputEvent queued = event;
+    if (queued.type == InputEvent::Type::MouseMove) {
+        // Only this thread sets m_moveHeld, so once it reads clear no move
+        // can be held ahead of this one.
+        if (m_moveHeld.load() || !m_queue.TryPush(queued)) {
+            std::lock_guard<std::mutex> lock(m_heldMutex);
+            if (m_moveHeld.load()) {
+                ++m_stats.movesDropped;
+            }
+            m_heldMove = std::move(queued);
+            m_moveHeld.store(true);
+        }
+        Wake();
+        return;
+    }
+
+    Backoff backoff;
+    while (m_moveHeld.load() || !m_queue.TryPush(queued)) {
+        if (!m_running.load()) {
+            return;  // nobody left to drain the queue
+        }
+        Wake();
+        backoff.Pause();
+    }
+    Wake();
+}
+
+// A move directly after another move replaces it; moves between button or
+// key events are kept so drags and clicks land where the viewer saw them.
+void InputThread::Append(std::vector<InputEvent>& batch, InputEvent& event) {
+    if (event.type == InputEvent::Type::MouseMove && !batch.empty() &&
+        batch.back().type == InputEvent::Type::MouseMove) {
+        batch.back() = std::move(event);
+        ++m_stats.movesCoalesced;
+    } else {
+        batch.push_back(std::move(event));
+    }
+}
+
+// Moves everything queued so far into batch, then the held move if there is
+// one. It goes last: it was posted after everything in the queue.
+void InputThread::DrainInto(std::vector<InputEvent>& batch) {
+    InputEvent event;
+    for (;;) {
+        while (m_queue.TryPop(event)) {
+            Append(batch, event);
+        }
+        if (!m_moveHeld.load()) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(m_heldMutex);
+        // The producer may have filled the queue again before it held the
+        // move; those events come first.
+        if (m_queue.TryPop(event)) {
+            Append(batch, event);
+            continue;
+        }
+        Append(batch, m_heldMove);
+        m_heldMove = InputEvent();
+        m_moveHeld.store(false);
+        return;
+    }
+}
+
+void InputThread::Run() {
+    Trace::SetThreadName("input");
+#ifdef _WIN32
+    if (!CreateNotifyWindow()) {
+        std::cerr << "InputThread: no display change notifications (error " << GetLastError()
+                  << "); screen size is read once." << std::endl;
+    }
+#endif
+    m_sink.RefreshScreenMetrics();
+
+    std::vector<InputEvent> batch;
+    batch.reserve(kQueueSize);
+    while (m_running.load()) {
+        DrainInto(batch);
+        if (!batch.empty()) {
+            TraceScope scope("inject", "events", batch.size());
+            m_sink.Inject(batch);
+            ++m_stats.batchesInjected;
+            batch.clear();
+            continue;
+        }
+        Wait();
+    }
+
+#ifdef _WIN32
+    if (m_notifyWindow) {
+        DestroyWindow(m_notifyWindow);
+        m_notifyWindow = NULL;
+    }
+#endif
+}
+
+#ifdef _WIN32
+void InputThread::Wake() {
+    if (m_wake) {
+        SetEvent(m_wake);
+    }
+}
+
+void InputThread::Wait() {
+    // Sleep until an event is posted or a window message arrives.
+    MsgWaitForMultipleObjects(1, &m_wake, FALSE, INFINITE, QS_ALLINPUT);
+    PumpMessages();
+}
+
+void InputThread::PumpMessages() {
+    MSG msg;
+    while (PeekMessageW(&msg, NULL, 0, 0, PM_REMOVE)) {
+        TranslateMessage(&msg);
+        DispatchMessageW(&msg);
+    }
+}
+
+// Display changes are broadcast to top-level windows only, so this is a
+// hidden top-level window rather than a message-only one.
+bool InputThread::CreateNotifyWindow() {
+    HINSTANCE instance = GetModuleHandleW(NULL);
+    WNDCLASSEXW wc = {0};
+    wc.cbSize = sizeof(wc);
+    wc.lpfnWndProc = &InputThread::NotifyWndProc;
+    wc.hInstance = instance;
+    wc.lpszClassName = kNotifyWindowClass;
+    if (!RegisterClassExW(&wc) && GetLastError() != ERROR_CLASS_ALREADY_EXISTS) {
+        return false;
+    }
+    m_notifyWindow = CreateWindowExW(0, kNotifyWindowClass, L"", WS_OVERLAPPED,
+                                     0, 0, 0, 0, NULL, NULL, instance, this);
+    return m_notifyWindow != NULL;
+}
+
+LRESULT CALLBACK InputThread::NotifyWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
+    if (msg == WM_NCCREATE) {
+        CREATESTRUCTW* create = reinterpret_cast<CREATESTRUCTW*>(lParam);
+        SetWindowLongPtrW(hwnd, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(create->lpCreateParams));
+    }
+    InputThread* self = reinterpret_cast<InputThread*>(GetWindowLongPtrW(hwnd, GWLP_USERDATA));
+    if (self && (msg == WM_DISPLAYCHANGE || msg == WM_SETTINGCHANGE)) {
+        self->m_sink.RefreshScreenMetrics();
+    }
+    return DefWindowProcW(hwnd, msg, wParam, lParam);
+}
+
+#else
+
+void InputThread::Wake() {
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_woken = true;
+    }
+    m_wakeCv.notify_one();
+}
+
+void InputThread::Wait() {
+    std::unique_lock<std::mutex> lock(m_wakeMutex);
+    m_wakeCv.wait(lock, [this]() { return m_woken; });
+    m_woken = false;
+}
+
+#endif
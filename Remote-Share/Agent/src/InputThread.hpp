@@ -0,0 +1,81 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <condition_variable>
+#endif
+#include "InputSink.hpp"
+#include "SpscRing.hpp"
+
+// Counters readable from any thread.
+struct InputStats {
+    std::atomic<uint64_t> eventsPosted{0};
+    std::atomic<uint64_t> movesCoalesced{0};  // replaced by a newer move in the same batch
+    std::atomic<uint64_t> movesDropped{0};    // replaced by a newer move while the queue was full
+    std::atomic<uint64_t> batchesInjected{0};
+};
+
+// Injects viewer input on its own thread so a burst of events never holds up
+// the network thread. The network thread posts parsed events into an SPSC
+// ring; the input thread drains whatever has arrived, collapses runs of
+// mouse moves to the newest position and hands the batch to the sink in one
+// call (one SendInput call for InputInjector).
+//
+// On Windows the thread also owns a hidden window so it hears about display
+// changes and only then asks the sink to re-read the screen size.
+class InputThread {
+public:
+    // The sink is only touched from the input thread once started.
+    explicit InputThread(InputSink& sink);
+    ~InputThread();
+
+    void Start();
+    void Stop();
+
+    // Called from one producer thread (the WebSocket thread). Never blocks on
+    // mouse moves: if the queue is full the move waits in a one-event slot
+    // behind it, where a newer move replaces it, so the newest position is
+    // always the one injected. Other events wait for room (and for the slot
+    // to empty) so no key or button transition is lost or reordered.
+    void Post(const InputEvent& event);
+
+    const InputStats& Stats() const { return m_stats; }
+
+private:
+    static const size_t kQueueSize = 256;
+
+    void Run();
+    void DrainInto(std::vector<InputEvent>& batch);
+    void Append(std::vector<InputEvent>& batch, InputEvent& event);
+    void Wake();
+    // Sleeps until Wake() (or, on Windows, a window message).
+    void Wait();
+
+    InputSink& m_sink;
+    SpscRing<InputEvent, kQueueSize> m_queue;
+    // The newest move that did not fit in the queue. While it is held,
+    // everything in the queue is older than it and nothing else is queued.
+    std::mutex m_heldMutex;
+    InputEvent m_heldMove;
+    std::atomic<bool> m_moveHeld{false};  // set by the producer only
+#ifdef _WIN32
+    bool CreateNotifyWindow();
+    void PumpMessages();
+    static LRESULT CALLBACK NotifyWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
+
+    HANDLE m_wake = NULL;      // auto-reset event, set after every Post
+    HWND m_notifyWindow = NULL;
+#else
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wakeCv;
+    bool m_woken = false;
+#endif
+    std::atomic<bool> m_running{false};
+    std::thread m_thread;
+    InputStats m_stats;
+};
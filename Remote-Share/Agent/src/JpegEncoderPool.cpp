@@ -0,0 +1,120 @@
+#include "JpegEncoderPool.hpp"
+#include "ImageProcessor.hpp"
+#include "Trace.hpp"
+#include <algorithm>
+
+namespace {
+// Bands shorter than this cost more in per-JPEG overhead than they save.
+const int kMinBandHeight = 64;
+const int kMcuHeight = 16;
+}
+
+JpegEncoderPool::JpegEncoderPool(size_t threads) {
+    if (threads == 0) {
+        threads = DefaultThreadCount();
+    }
+    for (size_t i = 1; i < threads; ++i) {
+        m_workers.emplace_back(&JpegEncoderPool::WorkerLoop, this);
+    }
+}
+
+JpegEncoderPool::~JpegEncoderPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_startCv.notify_all();
+    for (std::thread& worker : m_workers) {
+        worker.join();
+    }
+}
+
+size_t JpegEncoderPool::DefaultThreadCount() {
+    size_t hardware = std::thread::hardware_concurrency();
+    return std::max<size_t>(1, hardware / 2);
+}
+
+void JpegEncoderPool::SplitIntoBands(const FrameRect& rect, size_t maxBands, std::vector<FrameRect>& out) {
+    size_t bands = std::min(maxBands, static_cast<size_t>(rect.height / kMinBandHeight));
+    if (bands <= 1) {
+        out.push_back(rect);
+        return;
+    }
+    int bandHeight = (rect.height + static_cast<int>(bands) - 1) / static_cast<int>(bands);
+    bandHeight = (bandHeight + kMcuHeight - 1) / kMcuHeight * kMcuHeight;
+    for (int y = 0; y < rect.height; y += bandHeight) {
+        FrameRect band = rect;
+        band.y = rect.y + y;
+        band.height = std::min(bandHeight, rect.height - y);
+        out.push_back(band);
+    }
+}
+
+bool JpegEncoderPool::CompressAll(const std::vector<FrameView>& views, int quality,
+                                  std::vector<JpegBuffer>& outputs) {
+    outputs.resize(views.size());
+    m_views = &views;
+    m_outputs = &outputs;
+    m_quality = quality;
+    m_nextJob.store(0);
+    m_failed.store(false);
+
+    // A single job gains nothing from waking the workers.
+    if (views.size() <= 1 || m_workers.empty()) {
+        RunJobs();
+        return !m_failed.load();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_activeWorkers = m_workers.size();
+        ++m_generation;
+    }
+    m_startCv.notify_all();
+
+    // The calling thread takes jobs too instead of just waiting.
+    RunJobs();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_doneCv.wait(lock, [this]() { return m_activeWorkers == 0; });
+    return !m_failed.load();
+}
+
+void JpegEncoderPool::RunJobs() {
+    const std::vector<FrameView>& views = *m_views;
+    for (size_t job = m_nextJob.fetch_add(1); job < views.size(); job = m_nextJob.fetch_add(1)) {
+        TraceScope scope("jpeg", "job", job);
+        const FrameView& view = views[job];
+        JpegBuffer& out = (*m_outputs)[job];
+        size_t worstCase = ImageProcessor::MaxJpegSize(view.width, view.height);
+        if (out.bytes.size() < worstCase) {
+            out.bytes.resize(worstCase);
+        }
+        out.size = ImageProcessor::CompressToJpeg(view, out.bytes.data(), out.bytes.size(), m_quality);
+        if (out.size == 0) {
+            m_failed.store(true);
+        }
+    }
+}
+
+void JpegEncoderPool::WorkerLoop() {
+    Trace::SetThreadName("jpeg worker");
+    uint64_t seenGeneration = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_startCv.wait(lock, [&]() { return m_stopping || m_generation != seenGeneration; });
+            if (m_stopping) {
+                return;
+            }
+            seenGeneration = m_generation;
+        }
+
+        RunJobs();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (--m_activeWorkers == 0) {
+            m_doneCv.notify_one();
+        }
+    }
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "FrameView.hpp"
+
+// Output slot that is kept from frame to frame. bytes only ever grows, to the
+// worst-case size of the views encoded into it, so once the geometry is stable
+// encoding allocates nothing.
+struct JpegBuffer {
+    std::vector<uint8_t> bytes;
+    size_t size = 0;  // length of the JPEG at the front of bytes
+
+    const uint8_t* Data() const { return bytes.data(); }
+};
+
+// Compresses many JPEGs at once on a fixed set of threads. Each thread,
+// including the caller's, uses its own libjpeg-turbo handle (see
+// ImageProcessor), so jobs never share encoder state.
+//
+// A large frame parallelises by being cut into horizontal bands that are
+// encoded, sent and drawn as separate rectangles (SplitIntoBands).
+class JpegEncoderPool {
+public:
+    // threads is the total number of threads that encode, counting the one
+    // calling CompressAll. 0 picks DefaultThreadCount().
+    explicit JpegEncoderPool(size_t threads = 0);
+    ~JpegEncoderPool();
+
+    JpegEncoderPool(const JpegEncoderPool&) = delete;
+    JpegEncoderPool& operator=(const JpegEncoderPool&) = delete;
+
+    size_t ThreadCount() const { return m_workers.size() + 1; }
+
+    // Compresses every view; outputs[i] receives the JPEG for views[i].
+    // Pass the same outputs every time so their buffers are reused.
+    // Blocks until all are done. Returns false if any of them failed.
+    bool CompressAll(const std::vector<FrameView>& views, int quality,
+                     std::vector<JpegBuffer>& outputs);
+
+    // Appends rect to out, cut into at most maxBands horizontal bands. Band
+    // heights are multiples of 16 rows so every band boundary falls on a
+    // 4:2:0 MCU edge. Rects too small to be worth splitting stay whole.
+    static void SplitIntoBands(const FrameRect& rect, size_t maxBands, std::vector<FrameRect>& out);
+
+    // Half the hardware threads, leaving the rest for the user's own work.
+    static size_t DefaultThreadCount();
+
+private:
+    void WorkerLoop();
+    void RunJobs();
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_startCv;
+    std::condition_variable m_doneCv;
+    uint64_t m_generation = 0;
+    size_t m_activeWorkers = 0;
+    bool m_stopping = false;
+
+    // The batch being worked on; only valid while CompressAll runs.
+    const std::vector<FrameView>* m_views = nullptr;
+    std::vector<JpegBuffer>* m_outputs = nullptr;
+    int m_quality = 80;
+    std::atomic<size_t> m_nextJob{0};
+    std::atomic<bool> m_failed{false};
+};
@@ -0,0 +1,377 @@
+#include "KeyMap.hpp"
+#include <cstddef>
+
+namespace KeyMap {
+namespace {
+
+constexpr Entry Key(std::string_view name, uint8_t vk, uint16_t scanCode, bool extended, uint32_t keysym) {
+    return Entry{name, KeyInfo{vk, scanCode, extended, keysym}};
+}
+
+// KeyboardEvent.code -> virtual key, set 1 scan code, X11 keysym. Numeric
+// values so the table builds anywhere; InputInjector.cpp checks a sample of
+// them against the Windows headers.
+constexpr Entry kCodeEntries[] = {
+    Key("KeyA", 'A', 0x1E, false, 'a'), Key("KeyB", 'B', 0x30, false, 'b'),
+    Key("KeyC", 'C', 0x2E, false, 'c'), Key("KeyD", 'D', 0x20, false, 'd'),
+    Key("KeyE", 'E', 0x12, false, 'e'), Key("KeyF", 'F', 0x21, false, 'f'),
+    Key("KeyG", 'G', 0x22, false, 'g'), Key("KeyH", 'H', 0x23, false, 'h'),
+    Key("KeyI", 'I', 0x17, false, 'i'), Key("KeyJ", 'J', 0x24, false, 'j'),
+    Key("KeyK", 'K', 0x25, false, 'k'), Key("KeyL", 'L', 0x26, false, 'l'),
+    Key("KeyM", 'M', 0x32, false, 'm'), Key("KeyN", 'N', 0x31, false, 'n'),
+    Key("KeyO", 'O', 0x18, false, 'o'), Key("KeyP", 'P', 0x19, false, 'p'),
+    Key("KeyQ", 'Q', 0x10, false, 'q'), Key("KeyR", 'R', 0x13, false, 'r'),
+    Key("KeyS", 'S', 0x1F, false, 's'), Key("KeyT", 'T', 0x14, false, 't'),
+    Key("KeyU", 'U', 0x16, false, 'u'), Key("KeyV", 'V', 0x2F, false, 'v'),
+    Key("KeyW", 'W', 0x11, false, 'w'), Key("KeyX", 'X', 0x2D, false, 'x'),
+    Key("KeyY", 'Y', 0x15, false, 'y'), Key("KeyZ", 'Z', 0x2C, false, 'z'),
+
+    Key("Digit1", '1', 0x02, false, '1'), Key("Digit2", '2', 0x03, false, '2'),
+    Key("Digit3", '3', 0x04, false, '3'), Key("Digit4", '4', 0x05, false, '4'),
+    Key("Digit5", '5', 0x06, false, '5'), Key("Digit6", '6', 0x07, false, '6'),
+    Key("Digit7", '7', 0x08, false, '7'), Key("Digit8", '8', 0x09, false, '8'),
+    Key("Digit9", '9', 0x0A, false, '9'), Key("Digit0", '0', 0x0B, false, '0'),
+
+    Key("F1", 0x70, 0x3B, false, 0xFFBE), Key("F2", 0x71, 0x3C, false, 0xFFBF),
+    Key("F3", 0x72, 0x3D, false, 0xFFC0), Key("F4", 0x73, 0x3E, false, 0xFFC1),
+    Key("F5", 0x74, 0x3F, false, 0xFFC2), Key("F6", 0x75, 0x40, false, 0xFFC3),
+    Key("F7", 0x76, 0x41, false, 0xFFC4), Key("F8", 0x77, 0x42, false, 0xFFC5),
+    Key("F9", 0x78, 0x43, false, 0xFFC6), Key("F10", 0x79, 0x44, false, 0xFFC7),
+    Key("F11", 0x7A, 0x57, false, 0xFFC8), Key("F12", 0x7B, 0x58, false, 0xFFC9),
+    Key("F13", 0x7C, 0x64, false, 0xFFCA), Key("F14", 0x7D, 0x65, false, 0xFFCB),
+    Key("F15", 0x7E, 0x66, false, 0xFFCC), Key("F16", 0x7F, 0x67, false, 0xFFCD),
+    Key("F17", 0x80, 0x68, false, 0xFFCE), Key("F18", 0x81, 0x69, false, 0xFFCF),
+    Key("F19", 0x82, 0x6A, false, 0xFFD0), Key("F20", 0x83, 0x6B, false, 0xFFD1),
+    Key("F21", 0x84, 0x6C, false, 0xFFD2), Key("F22", 0x85, 0x6D, false, 0xFFD3),
+    Key("F23", 0x86, 0x6E, false, 0xFFD4), Key("F24", 0x87, 0x76, false, 0xFFD5),
+
+    Key("Numpad0", 0x60, 0x52, false, 0xFFB0), Key("Numpad1", 0x61, 0x4F, false, 0xFFB1),
+    Key("Numpad2", 0x62, 0x50, false, 0xFFB2), Key("Numpad3", 0x63, 0x51, false, 0xFFB3),
+    Key("Numpad4", 0x64, 0x4B, false, 0xFFB4), Key("Numpad5", 0x65, 0x4C, false, 0xFFB5),
+    Key("Numpad6", 0x66, 0x4D, false, 0xFFB6), Key("Numpad7", 0x67, 0x47, false, 0xFFB7),
+    Key("Numpad8", 0x68, 0x48, false, 0xFFB8), Key("Numpad9", 0x69, 0x49, false, 0xFFB9),
+    Key("NumpadMultiply", 0x6A, 0x37, false, 0xFFAA),
+    Key("NumpadAdd", 0x6B, 0x4E, false, 0xFFAB),
+    Key("NumpadSubtract", 0x6D, 0x4A, false, 0xFFAD),
+    Key("NumpadDecimal", 0x6E, 0x53, false, 0xFFAE),
+    Key("NumpadDivide", 0x6F, 0x35, true, 0xFFAF),
+    Key("NumpadEnter", 0x0D, 0x1C, true, 0xFF8D),
+
+    Key("Backspace", 0x08, 0x0E, false, 0xFF08),
+    Key("Tab", 0x09, 0x0F, false, 0xFF09),
+    Key("Enter", 0x0D, 0x1C, false, 0xFF0D),
+    Key("ShiftLeft", 0xA0, 0x2A, false, 0xFFE1),
+    Key("ShiftRight", 0xA1, 0x36, false, 0xFFE2),
+    Key("ControlLeft", 0xA2, 0x1D, false, 0xFFE3),
+    Key("ControlRight", 0xA3, 0x1D, true, 0xFFE4),
+    Key("AltLeft", 0xA4, 0x38, false, 0xFFE9),
+    Key("AltRight", 0xA5, 0x38, true, 0xFFEA),
+    Key("MetaLeft", 0x5B, 0x5B, true, 0xFFEB),
+    Key("MetaRight", 0x5C, 0x5C, true, 0xFFEC),
+    Key("ContextMenu", 0x5D, 0x5D, true, 0xFF67),
+    Key("Escape", 0x1B, 0x01, false, 0xFF1B),
+    Key("Space", 0x20, 0x39, false, ' '),
+    Key("PageUp", 0x21, 0x49, true, 0xFF55),
+    Key("PageDown", 0x22, 0x51, true, 0xFF56),
+    Key("End", 0x23, 0x4F, true, 0xFF57),
+    Key("Home", 0x24, 0x47, true, 0xFF50),
+    Key("ArrowLeft", 0x25, 0x4B, true, 0xFF51),
+    Key("ArrowUp", 0x26, 0x48, true, 0xFF52),
+    Key("ArrowRight", 0x27, 0x4D, true, 0xFF53),
+    Key("ArrowDown", 0x28, 0x50, true, 0xFF54),
+    Key("Insert", 0x2D, 0x52, true, 0xFF63),
+    Key("Delete", 0x2E, 0x53, true, 0xFFFF),
+    Key("CapsLock", 0x14, 0x3A, false, 0xFFE5),
+    Key("NumLock", 0x90, 0x45, true, 0xFF7F),
+    Key("ScrollLock", 0x91, 0x46, false, 0xFF14),
+    Key("PrintScreen", 0x2C, 0x37, true, 0xFF61),
+    // Pause sends the three-byte E1 1D 45 sequence, which SendInput cannot
+    // express as one scan code; inject it by virtual key.
+    Key("Pause", 0x13, 0, false, 0xFF13),
+
+    // Punctuation, named after the US layout position
+    Key("Semicolon", 0xBA, 0x27, false, ';'),
+    Key("Equal", 0xBB, 0x0D, false, '='),
+    Key("Comma", 0xBC, 0x33, false, ','),
+    Key("Minus", 0xBD, 0x0C, false, '-'),
+    Key("Period", 0xBE, 0x34, false, '.'),
+    Key("Slash", 0xBF, 0x35, false, '/'),
+    Key("Backquote", 0xC0, 0x29, false, '`'),
+    Key("BracketLeft", 0xDB, 0x1A, false, '['),
+    Key("Backslash", 0xDC, 0x2B, false, '\\'),
+    Key("BracketRight", 0xDD, 0x1B, false, ']'),
+    Key("Quote", 0xDE, 0x28, false, '\''),
+    Key("IntlBackslash", 0xE2, 0x56, false, '<'),
+};
+
+// KeyboardEvent.key names -> virtual key and keysym, for the fallback path.
+// Single letters and digits are handled in LookupKey.
+constexpr Entry kKeyEntries[] = {
+    Key("Backspace", 0x08, 0, false, 0xFF08),
+    Key("Tab", 0x09, 0, false, 0xFF09),
+    Key("Enter", 0x0D, 0, false, 0xFF0D),
+    Key("Shift", 0x10, 0, false, 0xFFE1),
+    Key("Control", 0x11, 0, false, 0xFFE3),
+    Key("Alt", 0x12, 0, false, 0xFFE9),
+    Key("Meta", 0x5B, 0, true, 0xFFEB),
+    Key("ContextMenu", 0x5D, 0, true, 0xFF67),
+    Key("Pause", 0x13, 0, false, 0xFF13),
+    Key("CapsLock", 0x14, 0, false, 0xFFE5),
+    Key("Escape", 0x1B, 0, false, 0xFF1B),
+    Key(" ", 0x20, 0, false, ' '),
+    Key("PageUp", 0x21, 0, true, 0xFF55),
+    Key("PageDown", 0x22, 0, true, 0xFF56),
+    Key("End", 0x23, 0, true, 0xFF57),
+    Key("Home", 0x24, 0, true, 0xFF50),
+    Key("ArrowLeft", 0x25, 0, true, 0xFF51),
+    Key("ArrowUp", 0x26, 0, true, 0xFF52),
+    Key("ArrowRight", 0x27, 0, true, 0xFF53),
+    Key("ArrowDown", 0x28, 0, true, 0xFF54),
+    Key("PrintScreen", 0x2C, 0, true, 0xFF61),
+    Key("Insert", 0x2D, 0, true, 0xFF63),
+    Key("Delete", 0x2E, 0, true, 0xFFFF),
+    Key("NumLock", 0x90, 0, true, 0xFF7F),
+    Key("ScrollLock", 0x91, 0, false, 0xFF14),
+    Key("F1", 0x70, 0, false, 0xFFBE), Key("F2", 0x71, 0, false, 0xFFBF),
+    Key("F3", 0x72, 0, false, 0xFFC0), Key("F4", 0x73, 0, false, 0xFFC1),
+    Key("F5", 0x74, 0, false, 0xFFC2), Key("F6", 0x75, 0, false, 0xFFC3),
+    Key("F7", 0x76, 0, false, 0xFFC4), Key("F8", 0x77, 0, false, 0xFFC5),
+    Key("F9", 0x78, 0, false, 0xFFC6), Key("F10", 0x79, 0, false, 0xFFC7),
+    Key("F11", 0x7A, 0, false, 0xFFC8), Key("F12", 0x7B, 0, false, 0xFFC9),
+    Key("F13", 0x7C, 0, false, 0xFFCA), Key("F14", 0x7D, 0, false, 0xFFCB),
+    Key("F15", 0x7E, 0, false, 0xFFCC), Key("F16", 0x7F, 0, false, 0xFFCD),
+    Key("F17", 0x80, 0, false, 0xFFCE), Key("F18", 0x81, 0, false, 0xFFCF),
+    Key("F19", 0x82, 0, false, 0xFFD0), Key("F20", 0x83, 0, false, 0xFFD1),
+    Key("F21", 0x84, 0, false, 0xFFD2), Key("F22", 0x85, 0, false, 0xFFD3),
+    Key("F23", 0x86, 0, false, 0xFFD4), Key("F24", 0x87, 0, false, 0xFFD5),
+};
+
+// Perfect hash with displacement: a name hashes once to 64 bits; the high bits
+// pick a bucket, and each bucket stores the displacement that sends all of its
+// names to distinct free slots. Displacements are searched at compile time,
+// so a table that cannot be built fails the build rather than a lookup.
+//
+// Every name in the tables fits in 16 bytes (InputEvent keeps no more). A
+// name is read as two possibly overlapping words that between them cover
+// every byte, so the words plus the length identify it exactly: they are both
+// the hash input and the equality check, and no string compare is needed.
+const size_t kMaxNameLength = 16;
+
+struct NameKey {
+    uint64_t head = 0;
+    uint64_t tail = 0;
+    uint64_t length = 0;
+
+    constexpr bool operator==(const NameKey& other) const {
+        return head == other.head && tail == other.tail && length == other.length;
+    }
+};
+
+// Written out byte by byte to stay constexpr; compilers fold it into one load.
+constexpr uint64_t Load64(const char* p) {
+    return static_cast<uint64_t>(static_cast<uint8_t>(p[0])) |
+           static_cast<uint64_t>(static_cast<uint8_t>(p[1])) << 8 |
+           static_cast<uint64_t>(static_cast<uint8_t>(p[2])) << 16 |
+           static_cast<uint64_t>(static_cast<uint8_t>(p[3])) << 24 |
+           static_cast<uint64_t>(static_cast<uint8_t>(p[4])) << 32 |
+           static_cast<uint64_t>(static_cast<uint8_t>(p[5])) << 40 |
+           static_cast<uint64_t>(static_cast<uint8_t>(p[6])) << 48 |
+           static_cast<uint64_t>(static_cast<uint8_t>(p[7])) << 56;
+}
+
+constexpr uint64_t Load32(const char* p) {
+    return static_cast<uint64_t>(static_cast<uint8_t>(p[0])) |
+           static_cast<uint64_t>(static_cast<uint8_t>(p[1])) << 8 |
+           static_cast<uint64_t>(static_cast<uint8_t>(p[2])) << 16 |
+           static_cast<uint64_t>(static_cast<uint8_t>(p[3])) << 24;
+}
+
+// name must be at most kMaxNameLength bytes.
+constexpr NameKey ReadName(std::string_view name) {
+    const char* p = name.data();
+    size_t n = name.size();
+    NameKey key;
+    key.length = n;
+    if (n >= 8) {
+        key.head = Load64(p);
+        key.tail = Load64(p + n - 8);
+    } else if (n >= 4) {
+        key.head = Load32(p);
+        key.tail = Load32(p + n - 4);
+    } else if (n > 0) {
+        key.head = static_cast<uint64_t>(static_cast<uint8_t>(p[0])) |
+                   static_cast<uint64_t>(static_cast<uint8_t>(p[n / 2])) << 8 |
+                   static_cast<uint64_t>(static_cast<uint8_t>(p[n - 1])) << 16;
+    }
+    return key;
+}
+
+constexpr uint64_t HashName(const NameKey& key) {
+    uint64_t h = (key.head ^ key.length) * 0x9E3779B97F4A7C15ull;
+    return (h ^ (h >> 29) ^ key.tail) * 0xC2B2AE3D27D4EB4Full;
+}
+
+constexpr unsigned Log2(size_t value) {
+    unsigned bits = 0;
+    while (value > 1) {
+        value >>= 1;
+        ++bits;
+    }
+    return bits;
+}
+
+const uint16_t kEmptySlot = 0xFFFF;
+
+template <size_t Entries, size_t Slots, size_t Buckets>
+struct PerfectHash {
+    static_assert((Slots & (Slots - 1)) == 0 && (Buckets & (Buckets - 1)) == 0,
+                  "slot and bucket counts must be powers of two");
+    static_assert(Entries < Slots, "table too small");
+
+    uint16_t slots[Slots] = {};
+    uint16_t displacement[Buckets] = {};
+    NameKey names[Entries] = {};
+    bool built = false;
+
+    static constexpr size_t BucketOf(uint64_t h) { return h >> (64 - Log2(Buckets)); }
+    static constexpr size_t SlotOf(uint64_t h, uint16_t d) {
+        return ((h ^ d) * 0xFF51AFD7ED558CCDull) >> (64 - Log2(Slots));
+    }
+
+    // Index into the entry array, or -1.
+    constexpr int Find(std::string_view name) const {
+        if (name.size() > kMaxNameLength) {
+            return -1;
+        }
+        NameKey key = ReadName(name);
+        uint64_t h = HashName(key);
+        uint16_t index = slots[SlotOf(h, displacement[BucketOf(h)])];
+        if (index != kEmptySlot && names[index] == key) {
+            return index;
+        }
+        return -1;
+    }
+};
+
+template <size_t Slots, size_t Buckets, size_t Entries>
+constexpr PerfectHash<Entries, Slots, Buckets> BuildPerfectHash(const Entry (&entries)[Entries]) {
+    PerfectHash<Entries, Slots, Buckets> table;
+    uint64_t hashes[Entries] = {};
+    size_t bucketSize[Buckets] = {};
+    for (size_t i = 0; i < Entries; ++i) {
+        if (entries[i].name.size() > kMaxNameLength) {
+            return table;
+        }
+        table.names[i] = ReadName(entries[i].name);
+        hashes[i] = HashName(table.names[i]);
+        ++bucketSize[table.BucketOf(hashes[i])];
+    }
+    for (size_t s = 0; s < Slots; ++s) {
+        table.slots[s] = kEmptySlot;
+    }
+
+    // Place the largest buckets first, while the table is emptiest.
+    bool placed[Buckets] = {};
+    for (size_t round = 0; round < Buckets; ++round) {
+        size_t bucket = 0;
+        size_t largest = 0;
+        for (size_t b = 0; b < Buckets; ++b) {
+            if (!placed[b] && bucketSize[b] >= largest) {
+                bucket = b;
+                largest = bucketSize[b];
+            }
+        }
+        placed[bucket] = true;
+        if (largest == 0) {
+            continue;
+        }
+
+        bool found = false;
+        for (uint32_t d = 0; d < 0x10000 && !found; ++d) {
+            uint16_t displacement = static_cast<uint16_t>(d);
+            found = true;
+            for (size_t i = 0; i < Entries && found; ++i) {
+                if (table.BucketOf(hashes[i]) != bucket) {
+                    continue;
+                }
+                size_t slot = table.SlotOf(hashes[i], displacement);
+                if (table.slots[slot] != kEmptySlot) {
+                    found = false;
+                    break;
+                }
+                // Collisions within the bucket itself
+                for (size_t j = 0; j < i; ++j) {
+                    if (table.BucketOf(hashes[j]) == bucket && table.SlotOf(hashes[j], displacement) == slot) {
+                        found = false;
+                        break;
+                    }
+                }
+            }
+            if (found) {
+                table.displacement[bucket] = displacement;
+                for (size_t i = 0; i < Entries; ++i) {
+                    if (table.BucketOf(hashes[i]) == bucket) {
+                        table.slots[table.SlotOf(hashes[i], displacement)] = static_cast<uint16_t>(i);
+                    }
+                }
+            }
+        }
+        if (!found) {
+            return table;
+        }
+    }
+    table.built = true;
+    return table;
+}
+
+constexpr auto kCodeTable = BuildPerfectHash<256, 64>(kCodeEntries);
+constexpr auto kKeyTable = BuildPerfectHash<128, 32>(kKeyEntries);
+static_assert(kCodeTable.built, "no perfect hash for the code table; change the slot or bucket count");
+static_assert(kKeyTable.built, "no perfect hash for the key table; change the slot or bucket count");
+
+static_assert(kCodeTable.Find("KeyA") == 0, "code table lookup");
+static_assert(kCodeTable.Find("Keya") == -1, "code table lookup");
+static_assert(kKeyTable.Find("F24") == sizeof(kKeyEntries) / sizeof(kKeyEntries[0]) - 1, "key table lookup");
+
+} // namespace
+
+bool LookupCode(std::string_view code, KeyInfo& info) {
+    int index = kCodeTable.Find(code);
+    if (index < 0) {
+        return false;
+    }
+    info = kCodeEntries[index].info;
+    return true;
+}
+
+bool LookupKey(std::string_view key, KeyInfo& info) {
+    if (key.size() == 1) {
+        char c = key[0];
+        if (c >= 'a' && c <= 'z') {
+            info = KeyInfo{static_cast<uint8_t>(c - 'a' + 'A'), 0, false, static_cast<uint32_t>(c)};
+            return true;
+        }
+        if ((c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')) {
+            info = KeyInfo{static_cast<uint8_t>(c), 0, false, static_cast<uint32_t>(c)};
+            return true;
+        }
+    }
+    int index = kKeyTable.Find(key);
+    if (index < 0) {
+        return false;
+    }
+    info = kKeyEntries[index].info;
+    return true;
+}
+
+const Entry* CodeEntries(size_t& count) {
+    count = sizeof(kCodeEntries) / sizeof(kCodeEntries[0]);
+    return kCodeEntries;
+}
+
+const Entry* KeyEntries(size_t& count) {
+    count = sizeof(kKeyEntries) / sizeof(kKeyEntries[0]);
+    return kKeyEntries;
+}
+
+} // namespace KeyMap
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Translates browser keyboard names into platform key identifiers. The
+// tables are perfect-hashed at compile time (see KeyMap.cpp), so a lookup is
+// one hash of the name, one table probe and a compare of the three words the
+// name was hashed from, with no string compare and no allocation. Nothing
+// here depends on Windows; the injectors pick the field they need.
+namespace KeyMap {
+
+struct KeyInfo {
+    uint8_t vk = 0;          // Windows virtual-key code
+    uint16_t scanCode = 0;   // set 1 make code, 0 if the key must be sent by vk
+    bool extended = false;   // needs the E0 prefix (KEYEVENTF_EXTENDEDKEY)
+    uint32_t keysym = 0;     // X11 keysym
+};
+
+struct Entry {
+    std::string_view name;
+    KeyInfo info;
+};
+
+// Physical key, from KeyboardEvent.code ("KeyA", "ShiftRight", ...). Scan
+// codes are the ones the code names stand for, so they do not depend on the
+// agent's keyboard layout.
+bool LookupCode(std::string_view code, KeyInfo& info);
+
+// Logical key, from KeyboardEvent.key ("a", "Enter", "F5", ...), for events
+// whose code is empty or unknown. Never has a scan code.
+bool LookupKey(std::string_view key, KeyInfo& info);
+
+// The tables behind LookupCode and LookupKey, for tests. LookupKey also
+// takes single letters and digits, which are not in its table.
+const Entry* CodeEntries(size_t& count);
+const Entry* KeyEntries(size_t& count);
+
+} // namespace KeyMap
@@ -0,0 +1,113 @@
+#include "LatencyHistogram.hpp"
+
+namespace {
+
+unsigned HighestBit(uint64_t value) {
+    unsigned bit = 0;
+    while (value >>= 1) {
+        ++bit;
+    }
+    return bit;
+}
+
+} // namespace
+
+size_t LatencyHistogram::BucketOf(uint64_t us) {
+    if (us < kExactLimit) {
+        return static_cast<size_t>(us);
+    }
+    const uint64_t maxValue = (uint64_t(1) << kMaxValueBits) - 1;
+    if (us > maxValue) {
+        us = maxValue;
+    }
+    // Keep the top kSubBucketBits + 1 bits: the leading one picks the power
+    // of two, the rest the sub-bucket inside it.
+    unsigned shift = HighestBit(us) - kSubBucketBits;
+    size_t group = shift - 1;
+    size_t sub = static_cast<size_t>(us >> shift) - kSubBuckets;
+    return kExactLimit + group * kSubBuckets + sub;
+}
+
+uint64_t LatencyHistogram::BucketUpperBound(size_t bucket) {
+    if (bucket < kExactLimit) {
+        return bucket;
+    }
+    size_t group = (bucket - kExactLimit) / kSubBuckets;
+    uint64_t sub = (bucket - kExactLimit) % kSubBuckets + kSubBuckets;
+    unsigned shift = static_cast<unsigned>(group + 1);
+    return ((sub + 1) << shift) - 1;
+}
+
+void LatencyHistogram::Record(uint64_t us) {
+    m_counts[BucketOf(us)].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(us, std::memory_order_relaxed);
+    uint64_t max = m_max.load(std::memory_order_relaxed);
+    while (us > max && !m_max.compare_exchange_weak(max, us, std::memory_order_relaxed)) {
+    }
+}
+
+// Not an atomic snapshot of the whole histogram: a Record racing with it may
+// show up in some fields and not others. Over a reporting interval that is
+// noise, and it keeps Record free of locks.
+void LatencyHistogram::TakeSnapshot(Snapshot& out) const {
+    for (size_t i = 0; i < kBucketCount; ++i) {
+        out.counts[i] = m_counts[i].load(std::memory_order_relaxed);
+    }
+    out.count = m_count.load(std::memory_order_relaxed);
+    out.sum = m_sum.load(std::memory_order_relaxed);
+    out.max = m_max.load(std::memory_order_relaxed);
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::Snapshot::Since(const Snapshot& earlier) const {
+    Snapshot delta;
+    size_t highest = 0;
+    for (size_t i = 0; i < kBucketCount; ++i) {
+        delta.counts[i] = counts[i] - earlier.counts[i];
+        if (delta.counts[i] != 0) {
+            highest = i;
+        }
+    }
+    delta.count = count - earlier.count;
+    delta.sum = sum - earlier.sum;
+    delta.max = delta.count == 0 ? 0 : BucketUpperBound(highest);
+    if (delta.max > max) {
+        delta.max = max;
+    }
+    return delta;
+}
+
+LatencySummary LatencyHistogram::Snapshot::Summarize() const {
+    LatencySummary summary;
+    uint64_t total = 0;
+    for (size_t i = 0; i < kBucketCount; ++i) {
+        total += counts[i];
+    }
+    summary.count = total;
+    if (total == 0) {
+        return summary;
+    }
+    summary.mean = static_cast<double>(sum) / static_cast<double>(count == 0 ? total : count);
+    summary.max = max;
+
+    // Nearest-rank percentiles, reported as the bucket's upper bound.
+    const uint64_t rank50 = (total * 50 + 99) / 100;
+    const uint64_t rank95 = (total * 95 + 99) / 100;
+    const uint64_t rank99 = (total * 99 + 99) / 100;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBucketCount && seen < rank99; ++i) {
+        if (counts[i] == 0) {
+            continue;
+        }
+        uint64_t before = seen;
+        seen += counts[i];
+        uint64_t bound = BucketUpperBound(i);
+        if (bound > max) {
+            bound = max;
+        }
+        if (before < rank50 && seen >= rank50) summary.p50 = bound;
+        if (before < rank95 && seen >= rank95) summary.p95 = bound;
+        if (seen >= rank99) summary.p99 = bound;
+    }
+    return summary;
+}
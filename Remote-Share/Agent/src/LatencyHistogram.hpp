@@ -0,0 +1,60 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Percentiles of one latency series, in microseconds.
+struct LatencySummary {
+    uint64_t count = 0;
+    uint64_t p50 = 0;
+    uint64_t p95 = 0;
+    uint64_t p99 = 0;
+    uint64_t max = 0;
+    double mean = 0.0;
+};
+
+// Log-linear histogram of microsecond values, in the style of HdrHistogram:
+// values below 64 us are counted exactly, above that every power of two is
+// split into 32 buckets, so any reported percentile is within about 3% of
+// the true value up to the 71-minute cap.
+//
+// Record is a few relaxed atomic adds and never allocates or locks, so it can
+// sit on the hot path of any thread. Readers take a Snapshot, and subtract an
+// earlier one to get the distribution of just the interval in between.
+class LatencyHistogram {
+public:
+    static const unsigned kSubBucketBits = 5;
+    static const size_t kSubBuckets = size_t(1) << kSubBucketBits;
+    static const size_t kExactLimit = kSubBuckets * 2;  // values below this are exact
+    static const unsigned kMaxValueBits = 32;
+    static const size_t kBucketCount = kExactLimit + (kMaxValueBits - kSubBucketBits - 1) * kSubBuckets;
+
+    struct Snapshot {
+        uint32_t counts[kBucketCount] = {};
+        uint64_t count = 0;
+        uint64_t sum = 0;
+        uint64_t max = 0;
+
+        // Counts since earlier. max cannot be subtracted, so it is the
+        // highest bucket seen in between.
+        Snapshot Since(const Snapshot& earlier) const;
+        LatencySummary Summarize() const;
+    };
+
+    LatencyHistogram() = default;
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    void Record(uint64_t us);
+    void TakeSnapshot(Snapshot& out) const;
+
+    static size_t BucketOf(uint64_t us);
+    // Largest value that falls in bucket.
+    static uint64_t BucketUpperBound(size_t bucket);
+
+private:
+    std::atomic<uint32_t> m_counts[kBucketCount] = {};
+    std::atomic<uint64_t> m_count{0};
+    std::atomic<uint64_t> m_sum{0};
+    std::atomic<uint64_t> m_max{0};
+};
@@ -0,0 +1,169 @@
+#include "Metrics.hpp"
+#include <chrono>
+#include <cstdio>
+#include <nlohmann/json.hpp>
+
+const char* StageName(Stage stage) {
+    switch (stage) {
+    case Stage::Capture: return "capture";
+    case Stage::Diff: return "diff";
+    case Stage::Encode: return "encode";
+    case Stage::Framing: return "framing";
+    case Stage::QueueWait: return "queueWait";
+    case Stage::Send: return "send";
+    case Stage::EndToEnd: return "endToEnd";
+    default: return "unknown";
+    }
+}
+
+double MetricsReport::Fps() const {
+    return intervalSec > 0.0 ? framesWritten / intervalSec : 0.0;
+}
+
+double MetricsReport::SendMbps() const {
+    return intervalSec > 0.0 ? bytesWritten * 8.0 / 1e6 / intervalSec : 0.0;
+}
+
+double MetricsReport::BytesPerFrame() const {
+    return framesWritten > 0 ? static_cast<double>(bytesWritten) / framesWritten : 0.0;
+}
+
+double MetricsReport::EncodeMpixPerSec() const {
+    return encodeBusyUs > 0 ? static_cast<double>(pixelsEncoded) / encodeBusyUs : 0.0;
+}
+
+std::string MetricsReport::ToJson() const {
+    nlohmann::json stagesJson = nlohmann::json::object();
+    for (size_t i = 0; i < kStageCount; ++i) {
+        const LatencySummary& s = stages[i];
+        stagesJson[StageName(static_cast<Stage>(i))] = {
+            {"count", s.count}, {"p50", s.p50}, {"p95", s.p95}, {"p99", s.p99}, {"max", s.max}
+        };
+    }
+    nlohmann::json message = {
+        {"type", "stats"},
+        {"intervalMs", static_cast<uint64_t>(intervalSec * 1000.0 + 0.5)},
+        {"unit", "us"},
+        {"stages", stagesJson},
+        {"fps", Fps()},
+        {"sendMbps", SendMbps()},
+        {"bytesWritten", bytesWritten},
+        {"bytesPerFrame", BytesPerFrame()},
+        {"encode", {
+            {"mpixPerSec", EncodeMpixPerSec()},
+            {"pixels", pixelsEncoded},
+            {"jpegBytes", jpegBytes}
+        }},
+        {"counters", {
+            {"framesCaptured", counters.framesCaptured},
+            {"framesEncoded", counters.framesEncoded},
+            {"framesSent", counters.framesSent},
+            {"capturesDeferred", counters.capturesDeferred},
+            {"encodeFailures", counters.encodeFailures},
+            {"chunksSent", counters.chunksSent}
+        }},
+        {"captureRate", counters.captureRate}
+    };
+    return message.dump();
+}
+
+std::string MetricsReport::ToText() const {
+    std::string text;
+    char line[160];
+    std::snprintf(line, sizeof(line), "%-10s %8s %9s %9s %9s %9s\n", "stage", "count", "p50 us", "p95 us",
+                  "p99 us", "max us");
+    text += line;
+    for (size_t i = 0; i < kStageCount; ++i) {
+        const LatencySummary& s = stages[i];
+        std::snprintf(line, sizeof(line), "%-10s %8llu %9llu %9llu %9llu %9llu\n", StageName(static_cast<Stage>(i)),
+                      static_cast<unsigned long long>(s.count), static_cast<unsigned long long>(s.p50),
+                      static_cast<unsigned long long>(s.p95), static_cast<unsigned long long>(s.p99),
+                      static_cast<unsigned long long>(s.max));
+        text += line;
+    }
+    std::snprintf(line, sizeof(line),
+                  "%.1f fps written (target %.1f), %.2f Mbit/s, %.1f KB/frame, encode %.1f Mpix/s busy\n", Fps(),
+                  counters.captureRate, SendMbps(), BytesPerFrame() / 1e3, EncodeMpixPerSec());
+    text += line;
+    std::snprintf(line, sizeof(line),
+                  "frames: %llu captured, %llu encoded, %llu sent, %llu deferred, %llu failed\n",
+                  static_cast<unsigned long long>(counters.framesCaptured),
+                  static_cast<unsigned long long>(counters.framesEncoded),
+                  static_cast<unsigned long long>(counters.framesSent),
+                  static_cast<unsigned long long>(counters.capturesDeferred),
+                  static_cast<unsigned long long>(counters.encodeFailures));
+    text += line;
+    return text;
+}
+
+Metrics::Metrics()
+    : m_startUs(NowUs()), m_lastReportUs(m_startUs) {
+}
+
+uint64_t Metrics::NowUs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+uint64_t Metrics::RecordSince(Stage stage, uint64_t startUs) {
+    uint64_t now = NowUs();
+    Record(stage, now > startUs ? now - startUs : 0);
+    return now;
+}
+
+void Metrics::AddEncoded(uint64_t pixels, uint64_t jpegBytes) {
+    m_pixelsEncoded.fetch_add(pixels, std::memory_order_relaxed);
+    m_jpegBytes.fetch_add(jpegBytes, std::memory_order_relaxed);
+}
+
+void Metrics::AddFrameWritten(uint64_t bytes) {
+    m_framesWritten.fetch_add(1, std::memory_order_relaxed);
+    m_bytesWritten.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void Metrics::TakeReport(const MetricsCounters& counters, MetricsReport& report) {
+    uint64_t now = NowUs();
+    report.intervalSec = (now - m_lastReportUs) / 1e6;
+    m_lastReportUs = now;
+
+    for (size_t i = 0; i < kStageCount; ++i) {
+        m_histograms[i].TakeSnapshot(m_current);
+        LatencyHistogram::Snapshot delta = m_current.Since(m_last[i]);
+        report.stages[i] = delta.Summarize();
+        if (static_cast<Stage>(i) == Stage::Encode) {
+            report.encodeBusyUs = delta.sum;
+        }
+        m_last[i] = m_current;
+    }
+
+    uint64_t pixels = m_pixelsEncoded.load(std::memory_order_relaxed);
+    uint64_t jpegBytes = m_jpegBytes.load(std::memory_order_relaxed);
+    uint64_t frames = m_framesWritten.load(std::memory_order_relaxed);
+    uint64_t bytes = m_bytesWritten.load(std::memory_order_relaxed);
+    report.pixelsEncoded = pixels - m_lastPixels;
+    report.jpegBytes = jpegBytes - m_lastJpegBytes;
+    report.framesWritten = frames - m_lastFrames;
+    report.bytesWritten = bytes - m_lastBytes;
+    m_lastPixels = pixels;
+    m_lastJpegBytes = jpegBytes;
+    m_lastFrames = frames;
+    m_lastBytes = bytes;
+
+    report.counters = counters;
+}
+
+void Metrics::TotalReport(const MetricsCounters& counters, MetricsReport& report) {
+    report.intervalSec = (NowUs() - m_startUs) / 1e6;
+    for (size_t i = 0; i < kStageCount; ++i) {
+        m_histograms[i].TakeSnapshot(m_current);
+        report.stages[i] = m_current.Summarize();
+        if (static_cast<Stage>(i) == Stage::Encode) {
+            report.encodeBusyUs = m_current.sum;
+        }
+    }
+    report.pixelsEncoded = m_pixelsEncoded.load(std::memory_order_relaxed);
+    report.jpegBytes = m_jpegBytes.load(std::memory_order_relaxed);
+    report.framesWritten = m_framesWritten.load(std::memory_order_relaxed);
+    report.bytesWritten = m_bytesWritten.load(std::memory_order_relaxed);
+    report.counters = counters;
+}
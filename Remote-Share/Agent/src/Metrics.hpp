@@ -0,0 +1,112 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "LatencyHistogram.hpp"
+
+// Where a frame's time goes, from grabbing the screen to the last byte leaving
+// the agent:
+//
+//   Capture    grab into a pooled frame (CaptureManager, X11FrameSource)
+//   Diff       tile compare against the previous frame
+//   Encode     JPEG of every rect, across the encoder pool
+//   Framing    building the message: headers and copies, or base64 + JSON
+//   QueueWait  encoded until the send scheduler takes it
+//   Send       taken until websocketpp has written all of it
+//   EndToEnd   capture timestamp until written
+//
+// Time on the relay and the viewer's network is not visible from here.
+enum class Stage : uint8_t {
+    Capture,
+    Diff,
+    Encode,
+    Framing,
+    QueueWait,
+    Send,
+    EndToEnd,
+    Count
+};
+
+const size_t kStageCount = static_cast<size_t>(Stage::Count);
+const char* StageName(Stage stage);
+
+// Counters owned by other components, copied in by whoever builds a report.
+struct MetricsCounters {
+    uint64_t framesCaptured = 0;
+    uint64_t framesEncoded = 0;
+    uint64_t framesSent = 0;
+    uint64_t capturesDeferred = 0;
+    uint64_t encodeFailures = 0;
+    uint64_t chunksSent = 0;
+    double captureRate = 0.0;  // current frame clock target
+};
+
+// One reporting interval.
+struct MetricsReport {
+    double intervalSec = 0.0;
+    LatencySummary stages[kStageCount];
+    uint64_t framesWritten = 0;  // frames fully written this interval
+    uint64_t bytesWritten = 0;
+    uint64_t pixelsEncoded = 0;
+    uint64_t jpegBytes = 0;
+    uint64_t encodeBusyUs = 0;
+    MetricsCounters counters;
+
+    double Fps() const;
+    double SendMbps() const;
+    // Bytes on the wire per frame written, headers included.
+    double BytesPerFrame() const;
+    // Encoder throughput while busy: pixels per second of Encode time.
+    double EncodeMpixPerSec() const;
+
+    // {"type":"stats",...} for the viewer and relay.
+    std::string ToJson() const;
+    // Multi-line table for logs and the --stats-file dump.
+    std::string ToText() const;
+};
+
+// Per-stage latency histograms plus the byte and pixel counts that go with
+// them. Recording is lock-free and cheap enough for every frame (two clock
+// reads and a few relaxed atomic adds per stage); at 60 fps the whole set
+// costs well under a millisecond per second.
+//
+// Any thread may record. Reports are taken by one thread at a time, each
+// covering the time since the previous one.
+class Metrics {
+public:
+    Metrics();
+    Metrics(const Metrics&) = delete;
+    Metrics& operator=(const Metrics&) = delete;
+
+    // Microseconds on steady_clock, the same clock as frame timestamps.
+    static uint64_t NowUs();
+
+    void Record(Stage stage, uint64_t us) { m_histograms[static_cast<size_t>(stage)].Record(us); }
+    // Records now - startUs; returns now for chaining into the next stage.
+    uint64_t RecordSince(Stage stage, uint64_t startUs);
+
+    void AddEncoded(uint64_t pixels, uint64_t jpegBytes);
+    void AddFrameWritten(uint64_t bytes);
+
+    void TakeReport(const MetricsCounters& counters, MetricsReport& report);
+    // Everything since construction; does not affect TakeReport.
+    void TotalReport(const MetricsCounters& counters, MetricsReport& report);
+
+private:
+    LatencyHistogram m_histograms[kStageCount];
+    std::atomic<uint64_t> m_pixelsEncoded{0};
+    std::atomic<uint64_t> m_jpegBytes{0};
+    std::atomic<uint64_t> m_framesWritten{0};
+    std::atomic<uint64_t> m_bytesWritten{0};
+
+    // State of the previous report; reporting thread only.
+    LatencyHistogram::Snapshot m_last[kStageCount];
+    LatencyHistogram::Snapshot m_current;
+    uint64_t m_startUs = 0;
+    uint64_t m_lastReportUs = 0;
+    uint64_t m_lastPixels = 0;
+    uint64_t m_lastJpegBytes = 0;
+    uint64_t m_lastFrames = 0;
+    uint64_t m_lastBytes = 0;
+};
@@ -0,0 +1,131 @@
+#include "ReplayFrameSource.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <vector>
+#include "FrameRecording.hpp"
+
+namespace {
+
+uint64_t NowUs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+} // namespace
+
+// Keeps the picture the recording has built up so far on a canvas; each grab
+// applies the frames that came due since the last one and copies the canvas
+// out. QueryGeometry picks the frame to show, so the session sizes its pool
+// for it before Grab draws it.
+class ReplaySurface : public CaptureSurface {
+public:
+    ReplaySurface(ReplayFrameSource::Speed speed, bool loop) : m_speed(speed), m_loop(loop) {}
+
+    RecordingReader& Reader() { return m_reader; }
+    bool Finished() const { return m_finished.load(); }
+    uint64_t FramesReplayed() const { return m_replayed.load(); }
+
+    bool QueryGeometry(int& width, int& height) override {
+        m_target = PickTarget();
+        const FrameRecording::FrameHeader& header = m_reader.Header(m_target);
+        width = header.width;
+        height = header.height;
+        return true;
+    }
+
+    bool Rebuild(int, int) override { return true; }
+
+    bool Grab(uint8_t* dst, int stride) override {
+        bool ok = true;
+        for (; m_next <= m_target; ++m_next) {
+            const FrameRecording::FrameHeader& header = m_reader.Header(m_next);
+            if (header.width != m_width || header.height != m_height || header.format != m_format) {
+                // The first frame of a new size covers all of it.
+                m_width = header.width;
+                m_height = header.height;
+                m_format = header.format;
+                m_stride = ((m_width * BytesPerPixel(m_format) + 3) / 4) * 4;
+                m_canvas.assign(static_cast<size_t>(m_stride) * m_height, 0);
+            }
+            ok = m_reader.Apply(m_next, m_canvas.data(), m_stride) && ok;
+            m_replayed.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (!ok || stride != m_stride) {
+            return false;
+        }
+        std::memcpy(dst, m_canvas.data(), m_canvas.size());
+        return true;
+    }
+
+    PixelFormat Format() const override { return m_reader.Header(m_target).format; }
+
+private:
+    // The last frame the next grab shows; m_next - 1 if nothing new is due.
+    size_t PickTarget() {
+        if (m_next == m_reader.FrameCount()) {
+            if (!m_loop) {
+                m_finished.store(true);
+                return m_next - 1;
+            }
+            m_next = 0;
+            m_startUs = 0;
+        }
+        if (m_speed == ReplayFrameSource::Speed::Max) {
+            return m_next;
+        }
+
+        uint64_t now = NowUs();
+        if (m_startUs == 0) {
+            m_startUs = now - m_reader.Header(m_next).timestampUs;
+        }
+        size_t target = m_next;
+        while (target + 1 < m_reader.FrameCount() && m_startUs + m_reader.Header(target + 1).timestampUs <= now) {
+            ++target;
+        }
+        if (target == m_next && m_next > 0 && m_startUs + m_reader.Header(m_next).timestampUs > now) {
+            return m_next - 1;
+        }
+        return target;
+    }
+
+    ReplayFrameSource::Speed m_speed;
+    bool m_loop;
+    RecordingReader m_reader;
+    size_t m_next = 0;    // first frame not yet applied to the canvas
+    size_t m_target = 0;
+    uint64_t m_startUs = 0;  // when the recording's time zero is replayed
+    std::atomic<bool> m_finished{false};
+    std::atomic<uint64_t> m_replayed{0};
+
+    int m_width = 0;
+    int m_height = 0;
+    int m_stride = 0;
+    PixelFormat m_format = PixelFormat::BGR24;
+    std::vector<uint8_t> m_canvas;
+};
+
+ReplayFrameSource::ReplayFrameSource(const std::string& path, Speed speed, bool loop, size_t poolSlots)
+    : m_surface(new ReplaySurface(speed, loop)),
+      m_session(std::unique_ptr<CaptureSurface>(m_surface), poolSlots) {
+    m_open = m_surface->Reader().Open(path);
+    if (m_open) {
+        m_width = m_surface->Reader().Header(0).width;
+        m_height = m_surface->Reader().Header(0).height;
+    }
+}
+
+bool ReplayFrameSource::Finished() const {
+    return m_surface->Finished();
+}
+
+uint64_t ReplayFrameSource::FramesReplayed() const {
+    return m_surface->FramesReplayed();
+}
+
+PooledFrame ReplayFrameSource::Capture() {
+    if (!m_open) {
+        return PooledFrame();
+    }
+    return m_session.Capture();
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include "CaptureSession.hpp"
+#include "FrameSource.hpp"
+
+class ReplaySurface;
+
+// Plays a recording (see FrameRecording.hpp) back into the pipeline, so
+// encoder and transport changes can be compared on identical input. Frames
+// are rebuilt on a canvas from each record's rects and handed out as whole
+// frames, the way a capture would, so the pipeline diffs them as usual.
+//
+// At recorded speed a capture shows whatever frame is due at that moment,
+// replaying the original timing however often the pipeline captures; at max
+// speed every capture shows the next frame, and the pipeline's clock sets the
+// pace.
+class ReplayFrameSource : public FrameSource {
+public:
+    enum class Speed {
+        Recorded,
+        Max
+    };
+
+    // Check IsOpen() afterwards. With loop the recording starts over at the
+    // end; without, the last frame stays on screen.
+    ReplayFrameSource(const std::string& path, Speed speed, bool loop, size_t poolSlots);
+
+    bool IsOpen() const { return m_open; }
+
+    // Size of the first frame.
+    int Width() const { return m_width; }
+    int Height() const { return m_height; }
+
+    // True once every frame has been shown; never with loop. Any thread.
+    bool Finished() const;
+    // Recorded frames shown so far, repeats included. Any thread.
+    uint64_t FramesReplayed() const;
+
+    PooledFrame Capture() override;
+
+private:
+    ReplaySurface* m_surface;  // owned by m_session
+    CaptureSession m_session;
+    bool m_open = false;
+    int m_width = 0;
+    int m_height = 0;
+};
@@ -0,0 +1,88 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+#include <utility>
+
+// Bounded lock-free queue for exactly one producer thread and one consumer
+// thread. Capacity must be a power of two. Elements are moved in and out, so
+// move-only types such as PooledFrame work. A popped slot is reset to T(), so
+// the ring does not keep anything alive after it has been handed on.
+template <typename T, size_t Capacity>
+class SpscRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "SpscRing capacity must be a power of two");
+
+public:
+    // Producer side. Returns false (leaving value untouched) if the ring is full.
+    bool TryPush(T& value) {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tailCache == Capacity) {
+            m_tailCache = m_tail.load(std::memory_order_acquire);
+            if (head - m_tailCache == Capacity) {
+                return false;
+            }
+        }
+        m_items[head & (Capacity - 1)] = std::move(value);
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Returns false if the ring is empty.
+    bool TryPop(T& out) {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail == m_headCache) {
+            m_headCache = m_head.load(std::memory_order_acquire);
+            if (tail == m_headCache) {
+                return false;
+            }
+        }
+        T& slot = m_items[tail & (Capacity - 1)];
+        out = std::move(slot);
+        slot = T();
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Seen from the producer this may overstate the size, and from the
+    // consumer it may understate it, since the other end can move at any time.
+    size_t Size() const {
+        return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire);
+    }
+
+    static constexpr size_t MaxSize() { return Capacity; }
+
+private:
+    // Producer and consumer indices live on separate cache lines so the two
+    // threads do not keep stealing the same line from each other. Each side
+    // also caches the other's index and only re-reads it when the ring looks
+    // full (or empty).
+    alignas(64) std::atomic<size_t> m_head{0};
+    size_t m_tailCache = 0;
+    alignas(64) std::atomic<size_t> m_tail{0};
+    size_t m_headCache = 0;
+    alignas(64) T m_items[Capacity];
+};
+
+// Waiting strategy for pipeline stages polling a ring: spin briefly, then
+// yield, then sleep, so an idle stage costs almost no CPU while a busy one
+// picks up work within microseconds.
+class Backoff {
+public:
+    void Pause() {
+        if (m_count < 64) {
+            ++m_count;
+        } else if (m_count < 128) {
+            ++m_count;
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    void Reset() { m_count = 0; }
+
+private:
+    int m_count = 0;
+};
@@ -0,0 +1,433 @@
+#include "SyntheticFrameSource.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+const int kBoxWidth = 256;
+const int kBoxHeight = 160;
+const int kBoxStep = 8;          // pixels per change
+const int kCellWidth = 8;        // text cell at 1080p; scaled up with the screen
+const int kCellHeight = 16;
+const int kTitleHeight = 24;
+const int kScrollStep = 4;       // rows per change, before scaling
+const uint64_t kMaxCatchUp = 64; // changes applied by one capture at most
+const uint64_t kSeed = 0x9e3779b97f4a7c15ull;
+
+// Fixed-seed generator, so every run draws the same content.
+struct XorShift {
+    explicit XorShift(uint64_t seed) : state(seed ? seed : kSeed) {}
+
+    uint64_t Next() {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+
+    int Below(int limit) { return static_cast<int>(Next() % static_cast<uint64_t>(limit)); }
+
+    uint64_t state;
+};
+
+struct Color {
+    uint8_t b, g, r;
+};
+
+const Color kPaper = {250, 250, 250};
+const Color kInk = {40, 40, 40};
+const Color kTitle = {140, 80, 30};
+
+// A BGR24 image somewhere: the desktop canvas or a scratch strip.
+struct Plane {
+    uint8_t* data;
+    int width;
+    int height;
+    int stride;
+
+    uint8_t* At(int x, int y) const { return data + static_cast<size_t>(y) * stride + static_cast<size_t>(x) * 3; }
+};
+
+void FillRect(const Plane& plane, int x, int y, int width, int height, Color color) {
+    int x1 = std::min(plane.width, x + width);
+    int y1 = std::min(plane.height, y + height);
+    x = std::max(0, x);
+    y = std::max(0, y);
+    for (int row = y; row < y1; ++row) {
+        uint8_t* out = plane.At(x, row);
+        for (int col = x; col < x1; ++col) {
+            *out++ = color.b;
+            *out++ = color.g;
+            *out++ = color.r;
+        }
+    }
+}
+
+// A made-up 5x7 glyph per character code: no font needed, and every code
+// looks different enough to give the encoder real edges.
+void DrawGlyph(const Plane& plane, int x, int y, int scale, unsigned code) {
+    FillRect(plane, x, y, kCellWidth * scale, kCellHeight * scale, kPaper);
+    if (code == ' ') {
+        return;
+    }
+    uint64_t bits = XorShift(kSeed ^ (code * 0x100000001b3ull)).Next();
+    for (int row = 0; row < 7; ++row) {
+        for (int col = 0; col < 5; ++col) {
+            if (bits >> (row * 5 + col) & 1) {
+                FillRect(plane, x + (1 + col) * scale, y + (4 + row) * scale, scale, scale, kInk);
+            }
+        }
+    }
+}
+
+// Words of random letters, lines of random length.
+class TextGenerator {
+public:
+    // The next character, '\n' at the end of a line.
+    unsigned Next(int columns) {
+        if (m_column >= std::min(columns, m_lineLength)) {
+            m_column = 0;
+            m_lineLength = columns / 3 + m_rng.Below(std::max(1, columns * 2 / 3));
+            return '\n';
+        }
+        ++m_column;
+        if (m_wordLeft == 0) {
+            m_wordLeft = 2 + m_rng.Below(8);
+            return ' ';
+        }
+        --m_wordLeft;
+        return 'a' + m_rng.Below(26);
+    }
+
+private:
+    XorShift m_rng{kSeed};
+    int m_column = 0;
+    int m_lineLength = 60;
+    int m_wordLeft = 0;
+};
+
+// Owns the desktop as a canvas that the workload changes step by step; every
+// grab copies it out (about what a GDI copy of the same size costs) and draws
+// the moving box on top for WindowDrag.
+class SyntheticSurface : public CaptureSurface {
+public:
+    explicit SyntheticSurface(const SyntheticOptions& options) : m_options(options) {}
+
+    bool QueryGeometry(int& width, int& height) override {
+        width = m_options.width;
+        height = m_options.height;
+        return true;
+    }
+
+    bool Rebuild(int width, int height) override {
+        m_width = width;
+        m_height = height;
+        m_stride = ((width * 3 + 3) / 4) * 4;
+        m_canvas.assign(static_cast<size_t>(m_stride) * height, 0);
+        m_scale = std::max(1, height / 1080);
+        m_steps = 0;
+        m_startUs = 0;
+        m_text = TextGenerator();
+        DrawDesktop();
+        return true;
+    }
+
+    bool Grab(uint8_t* dst, int stride) override {
+        if (stride != m_stride) {
+            return false;
+        }
+        Advance();
+        std::memcpy(dst, m_canvas.data(), m_canvas.size());
+        if (m_options.workload == SyntheticWorkload::WindowDrag) {
+            DrawBox(dst, stride);
+        }
+        return true;
+    }
+
+    PixelFormat Format() const override { return PixelFormat::BGR24; }
+
+private:
+    Plane Canvas() { return Plane{m_canvas.data(), m_width, m_height, m_stride}; }
+
+    void DrawDesktop() {
+        for (int y = 0; y < m_height; ++y) {
+            uint8_t* row = m_canvas.data() + static_cast<size_t>(y) * m_stride;
+            for (int x = 0; x < m_width; ++x) {
+                row[x * 3 + 0] = static_cast<uint8_t>(x * 255 / m_width);
+                row[x * 3 + 1] = static_cast<uint8_t>(y * 255 / m_height);
+                row[x * 3 + 2] = static_cast<uint8_t>(((x / 32) ^ (y / 32)) & 1 ? 160 : 96);
+            }
+        }
+
+        // Typing and Scrolling happen in a window covering the middle of the
+        // screen; Video plays in a 16:9 region a third of the screen wide.
+        int cellWidth = kCellWidth * m_scale;
+        int cellHeight = kCellHeight * m_scale;
+        m_window.x = m_width / 8;
+        m_window.y = m_height / 8 + kTitleHeight * m_scale;
+        m_columns = std::max(1, (m_width * 3 / 4) / cellWidth);
+        m_rows = std::max(1, (m_height * 3 / 4 - kTitleHeight * m_scale) / cellHeight);
+        m_window.width = std::min(m_columns * cellWidth, m_width - m_window.x);
+        m_window.height = std::min(m_rows * cellHeight, m_height - m_window.y);
+        m_video.width = std::max(16, m_width / 3);
+        m_video.height = std::min(m_height, m_video.width * 9 / 16);
+        m_video.x = (m_width - m_video.width) / 2;
+        m_video.y = (m_height - m_video.height) / 2;
+
+        Plane canvas = Canvas();
+        if (m_options.workload == SyntheticWorkload::Typing || m_options.workload == SyntheticWorkload::Scrolling) {
+            FillRect(canvas, m_window.x, m_window.y - kTitleHeight * m_scale, m_window.width,
+                     kTitleHeight * m_scale, kTitle);
+            FillRect(canvas, m_window.x, m_window.y, m_window.width, m_window.height, kPaper);
+            m_cursorX = 0;
+            m_cursorY = 0;
+        }
+        if (m_options.workload == SyntheticWorkload::Scrolling) {
+            // Start with a full page, then keep a line ready below it.
+            for (int row = 0; row < m_rows; ++row) {
+                DrawLine(canvas, m_window.x, m_window.y + row * cellHeight);
+            }
+            m_strip.assign(static_cast<size_t>(m_window.width) * 3 * cellHeight, 0);
+            Plane strip = Strip();
+            DrawLine(strip, 0, 0);
+            m_stripRow = 0;
+        }
+    }
+
+    Plane Strip() {
+        return Plane{m_strip.data(), m_window.width, kCellHeight * m_scale, m_window.width * 3};
+    }
+
+    // One line of text at (x, y), a full window wide.
+    void DrawLine(const Plane& plane, int x, int y) {
+        FillRect(plane, x, y, m_window.width, kCellHeight * m_scale, kPaper);
+        for (int column = 0; column < m_columns; ++column) {
+            unsigned code = m_text.Next(m_columns);
+            if (code == '\n') {
+                return;
+            }
+            DrawGlyph(plane, x + column * kCellWidth * m_scale, y, m_scale, code);
+        }
+    }
+
+    // Applies the changes due by now: one per grab, or as many as the change
+    // rate asks for since the first grab.
+    void Advance() {
+        uint64_t due = m_steps + 1;
+        if (m_options.changesPerSec > 0.0) {
+            uint64_t now = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+            if (m_startUs == 0) {
+                m_startUs = now;
+            }
+            due = static_cast<uint64_t>((now - m_startUs) * m_options.changesPerSec / 1e6) + 1;
+        }
+        due = std::min(due, m_steps + kMaxCatchUp);
+        if (due <= m_steps) {
+            return;
+        }
+
+        Plane canvas = Canvas();
+        switch (m_options.workload) {
+        case SyntheticWorkload::Typing:
+            for (; m_steps < due; ++m_steps) {
+                TypeOne(canvas);
+            }
+            break;
+        case SyntheticWorkload::Scrolling:
+            for (; m_steps < due; ++m_steps) {
+                ScrollOne(canvas);
+            }
+            break;
+        case SyntheticWorkload::Video:
+            // Only the latest picture is ever seen.
+            m_steps = due;
+            DrawVideo(canvas);
+            break;
+        case SyntheticWorkload::Noise:
+            m_steps = due;
+            DrawNoise();
+            break;
+        case SyntheticWorkload::Idle:
+        case SyntheticWorkload::WindowDrag:
+            m_steps = due;
+            break;
+        }
+    }
+
+    void TypeOne(const Plane& canvas) {
+        int cellWidth = kCellWidth * m_scale;
+        int cellHeight = kCellHeight * m_scale;
+        unsigned code = m_text.Next(m_columns);
+        // Erase the caret, draw the character, move the caret on.
+        FillRect(canvas, m_window.x + m_cursorX * cellWidth, m_window.y + m_cursorY * cellHeight, m_scale,
+                 cellHeight, kPaper);
+        if (code == '\n' || m_cursorX >= m_columns) {
+            m_cursorX = 0;
+            if (++m_cursorY == m_rows) {
+                // Like a terminal: everything moves up a line.
+                m_cursorY = m_rows - 1;
+                ScrollWindow(canvas, cellHeight);
+                FillRect(canvas, m_window.x, m_window.y + m_window.height - cellHeight, m_window.width, cellHeight,
+                         kPaper);
+            }
+        }
+        if (code != '\n') {
+            DrawGlyph(canvas, m_window.x + m_cursorX * cellWidth, m_window.y + m_cursorY * cellHeight, m_scale, code);
+            ++m_cursorX;
+        }
+        if (m_cursorX < m_columns) {
+            FillRect(canvas, m_window.x + m_cursorX * cellWidth, m_window.y + m_cursorY * cellHeight, m_scale,
+                     cellHeight, kInk);
+        }
+    }
+
+    void ScrollOne(const Plane& canvas) {
+        int step = std::min(kScrollStep * m_scale, m_window.height);
+        ScrollWindow(canvas, step);
+        // The rows that came into view are the next rows of the ready line.
+        Plane strip = Strip();
+        size_t rowBytes = static_cast<size_t>(m_window.width) * 3;
+        for (int row = m_window.height - step; row < m_window.height; ++row) {
+            std::memcpy(canvas.At(m_window.x, m_window.y + row), strip.At(0, m_stripRow), rowBytes);
+            if (++m_stripRow == strip.height) {
+                DrawLine(strip, 0, 0);
+                m_stripRow = 0;
+            }
+        }
+    }
+
+    // Moves the window's contents up by rows, leaving the bottom as it was.
+    void ScrollWindow(const Plane& canvas, int rows) {
+        size_t rowBytes = static_cast<size_t>(m_window.width) * 3;
+        for (int row = 0; row + rows < m_window.height; ++row) {
+            std::memmove(canvas.At(m_window.x, m_window.y + row), canvas.At(m_window.x, m_window.y + row + rows),
+                         rowBytes);
+        }
+    }
+
+    // Moving colour bands with a little grain: every pixel changes, but
+    // smoothly enough that JPEG does about as well as on real video.
+    void DrawVideo(const Plane& canvas) {
+        uint32_t t = static_cast<uint32_t>(m_steps);
+        XorShift grain(kSeed ^ t);
+        if (m_videoU.size() != static_cast<size_t>(m_video.width)) {
+            m_videoU.resize(m_video.width);
+            for (int x = 0; x < m_video.width; ++x) {
+                m_videoU[x] = static_cast<uint32_t>(x * 256 / m_video.width);
+            }
+        }
+        for (int y = 0; y < m_video.height; ++y) {
+            uint8_t* out = canvas.At(m_video.x, m_video.y + y);
+            uint64_t noise = grain.Next();
+            uint32_t v = static_cast<uint32_t>(y * 256 / m_video.height);
+            for (int x = 0; x < m_video.width; ++x) {
+                uint32_t u = m_videoU[x];
+                uint8_t n = static_cast<uint8_t>((noise >> (x & 63)) & 7);
+                out[0] = static_cast<uint8_t>(((u + t * 3) ^ (v - t)) + n);
+                out[1] = static_cast<uint8_t>((u * v >> 7) + t * 5 + n);
+                out[2] = static_cast<uint8_t>(((u - t * 2) * (v + t) >> 6) + n);
+                out += 3;
+            }
+        }
+    }
+
+    void DrawNoise() {
+        XorShift rng(kSeed ^ m_steps);
+        for (int y = 0; y < m_height; ++y) {
+            uint8_t* out = m_canvas.data() + static_cast<size_t>(y) * m_stride;
+            size_t bytes = static_cast<size_t>(m_width) * 3;
+            size_t i = 0;
+            for (; i + 8 <= bytes; i += 8) {
+                uint64_t value = rng.Next();
+                std::memcpy(out + i, &value, 8);
+            }
+            for (uint64_t value = rng.Next(); i < bytes; ++i, value >>= 8) {
+                out[i] = static_cast<uint8_t>(value);
+            }
+        }
+    }
+
+    // Bounces between the left and right edges, one row band further down on
+    // every pass.
+    void DrawBox(uint8_t* dst, int stride) const {
+        int boxWidth = std::min(kBoxWidth * m_scale, m_width);
+        int boxHeight = std::min(kBoxHeight * m_scale, m_height);
+        int travel = std::max(1, m_width - boxWidth);
+        uint64_t position = m_steps * kBoxStep * m_scale;
+        uint64_t pass = position / travel;
+        int x = static_cast<int>(position % travel);
+        if (pass & 1) {
+            x = travel - x;
+        }
+        int bands = std::max(1, m_height / boxHeight);
+        int y = static_cast<int>(pass % bands) * boxHeight;
+
+        uint8_t shade = static_cast<uint8_t>(m_steps * 3);
+        for (int row = 0; row < boxHeight; ++row) {
+            uint8_t* out = dst + static_cast<size_t>(y + row) * stride + static_cast<size_t>(x) * 3;
+            for (int col = 0; col < boxWidth; ++col) {
+                out[col * 3 + 0] = static_cast<uint8_t>(shade + col);
+                out[col * 3 + 1] = static_cast<uint8_t>(255 - row);
+                out[col * 3 + 2] = shade;
+            }
+        }
+    }
+
+    SyntheticOptions m_options;
+    int m_width = 0;
+    int m_height = 0;
+    int m_stride = 0;
+    int m_scale = 1;
+    std::vector<uint8_t> m_canvas;
+    uint64_t m_steps = 0;    // changes applied so far
+    uint64_t m_startUs = 0;  // first grab, with a change rate
+
+    TextGenerator m_text;
+    FrameRect m_window;      // text area of the Typing/Scrolling window
+    int m_columns = 0;
+    int m_rows = 0;
+    int m_cursorX = 0;
+    int m_cursorY = 0;
+    std::vector<uint8_t> m_strip;  // Scrolling: the next line, rows not yet shown
+    int m_stripRow = 0;
+    FrameRect m_video;
+    std::vector<uint32_t> m_videoU;  // Video: column to pattern coordinate
+};
+
+} // namespace
+
+const char* SyntheticWorkloadName(SyntheticWorkload workload) {
+    switch (workload) {
+    case SyntheticWorkload::Idle: return "idle";
+    case SyntheticWorkload::Typing: return "typing";
+    case SyntheticWorkload::Scrolling: return "scrolling";
+    case SyntheticWorkload::WindowDrag: return "drag";
+    case SyntheticWorkload::Video: return "video";
+    case SyntheticWorkload::Noise: return "noise";
+    }
+    return "unknown";
+}
+
+bool ParseSyntheticWorkload(const std::string& name, SyntheticWorkload& workload) {
+    const SyntheticWorkload all[] = {SyntheticWorkload::Idle, SyntheticWorkload::Typing,
+                                     SyntheticWorkload::Scrolling, SyntheticWorkload::WindowDrag,
+                                     SyntheticWorkload::Video, SyntheticWorkload::Noise};
+    for (SyntheticWorkload candidate : all) {
+        if (name == SyntheticWorkloadName(candidate)) {
+            workload = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+SyntheticFrameSource::SyntheticFrameSource(const SyntheticOptions& options, size_t poolSlots)
+    : m_session(std::unique_ptr<CaptureSurface>(new SyntheticSurface(options)), poolSlots) {
+}
+
+PooledFrame SyntheticFrameSource::Capture() {
+    return m_session.Capture();
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include "CaptureSession.hpp"
+#include "FrameSource.hpp"
+
+// What the synthetic screen shows. Each is one kind of change the pipeline has
+// to cope with, from nothing at all to nothing the encoder can compress.
+enum class SyntheticWorkload {
+    Idle,        // a static desktop
+    Typing,      // one character cell per change, plus the caret
+    Scrolling,   // a text page scrolling a few rows per change
+    WindowDrag,  // a window-sized box sliding across the desktop
+    Video,       // a 16:9 region redrawn in full every change
+    Noise        // random pixels over the whole screen
+};
+
+const char* SyntheticWorkloadName(SyntheticWorkload workload);
+bool ParseSyntheticWorkload(const std::string& name, SyntheticWorkload& workload);
+
+struct SyntheticOptions {
+    int width = 1920;
+    int height = 1080;
+    SyntheticWorkload workload = SyntheticWorkload::WindowDrag;
+    // Content changes per second, independent of the capture rate. 0 changes
+    // once per capture, so frame N always looks the same and runs are
+    // comparable frame by frame.
+    double changesPerSec = 0.0;
+};
+
+// Frames drawn in memory instead of captured, for running the agent without a
+// display (Linux CI, benchmarks, soak tests) at any resolution up to what the
+// frame protocol carries (65535 a side, so 8K fits). Content is procedural and
+// seeded, so every run of a workload draws the same pixels.
+class SyntheticFrameSource : public FrameSource {
+public:
+    SyntheticFrameSource(const SyntheticOptions& options, size_t poolSlots);
+
+    PooledFrame Capture() override;
+
+private:
+    CaptureSession m_session;
+};
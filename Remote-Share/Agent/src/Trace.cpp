@@ -0,0 +1,202 @@
+#include "Trace.hpp"
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Trace {
+
+namespace detail {
+std::atomic<bool> g_enabled{false};
+}
+
+namespace {
+
+const uint64_t kInstant = ~uint64_t(0);  // dur of an instant event
+
+// Fields are atomics only so a dump may read a slot the owner is rewriting;
+// all accesses are relaxed and ordered by the ring's head.
+struct Event {
+    std::atomic<const char*> name{nullptr};
+    std::atomic<const char*> argName{nullptr};
+    std::atomic<uint64_t> ts{0};
+    std::atomic<uint64_t> dur{0};
+    std::atomic<uint64_t> arg{0};
+};
+
+struct EventCopy {
+    const char* name;
+    const char* argName;
+    uint64_t ts;
+    uint64_t dur;
+    uint64_t arg;
+};
+
+// One writer (the owning thread), any number of readers under g_mutex.
+struct ThreadBuffer {
+    ThreadBuffer(size_t capacity, uint32_t tid)
+        : events(new Event[capacity]), mask(capacity - 1), tid(tid) {
+    }
+
+    std::unique_ptr<Event[]> events;
+    size_t mask;
+    uint32_t tid;
+    std::atomic<uint64_t> head{0};  // events ever written
+    std::atomic<const char*> name{nullptr};
+};
+
+std::mutex g_mutex;
+std::vector<std::unique_ptr<ThreadBuffer>> g_buffers;
+size_t g_eventsPerThread = 0;
+
+thread_local ThreadBuffer* t_buffer = nullptr;
+thread_local const char* t_name = nullptr;
+
+ThreadBuffer* CurrentBuffer() {
+    if (t_buffer == nullptr) {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        g_buffers.emplace_back(new ThreadBuffer(g_eventsPerThread, static_cast<uint32_t>(g_buffers.size() + 1)));
+        t_buffer = g_buffers.back().get();
+        t_buffer->name.store(t_name, std::memory_order_relaxed);
+    }
+    return t_buffer;
+}
+
+void Push(const char* name, uint64_t ts, uint64_t dur, const char* argName, uint64_t arg) {
+    ThreadBuffer* buffer = CurrentBuffer();
+    uint64_t head = buffer->head.load(std::memory_order_relaxed);
+    Event& event = buffer->events[head & buffer->mask];
+    event.name.store(name, std::memory_order_relaxed);
+    event.argName.store(argName, std::memory_order_relaxed);
+    event.ts.store(ts, std::memory_order_relaxed);
+    event.dur.store(dur, std::memory_order_relaxed);
+    event.arg.store(arg, std::memory_order_relaxed);
+    buffer->head.store(head + 1, std::memory_order_release);
+}
+
+// The events still in buffer, oldest first. Slots the owner may have
+// rewritten while they were copied are left out.
+void CopyEvents(const ThreadBuffer& buffer, std::vector<EventCopy>& out) {
+    const uint64_t capacity = buffer.mask + 1;
+    uint64_t end = buffer.head.load(std::memory_order_acquire);
+    uint64_t begin = end > capacity ? end - capacity : 0;
+    out.clear();
+    for (uint64_t i = begin; i < end; ++i) {
+        const Event& event = buffer.events[i & buffer.mask];
+        EventCopy copy;
+        copy.name = event.name.load(std::memory_order_relaxed);
+        copy.argName = event.argName.load(std::memory_order_relaxed);
+        copy.ts = event.ts.load(std::memory_order_relaxed);
+        copy.dur = event.dur.load(std::memory_order_relaxed);
+        copy.arg = event.arg.load(std::memory_order_relaxed);
+        out.push_back(copy);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t headNow = buffer.head.load(std::memory_order_relaxed);
+    // The write of index headNow may be in progress, so everything up to
+    // headNow - capacity could have been overwritten.
+    uint64_t firstValid = headNow >= capacity ? headNow - capacity + 1 : 0;
+    if (firstValid > begin) {
+        size_t torn = static_cast<size_t>(firstValid - begin);
+        out.erase(out.begin(), out.begin() + (torn < out.size() ? torn : out.size()));
+    }
+}
+
+} // namespace
+
+void Enable(size_t eventsPerThread) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (detail::g_enabled.load()) {
+        return;
+    }
+    // Round up to a power of two so a slot is a mask away.
+    size_t capacity = 64;
+    while (capacity < eventsPerThread) {
+        capacity <<= 1;
+    }
+    g_eventsPerThread = capacity;
+    detail::g_enabled.store(true);
+}
+
+bool IsEnabled() {
+    return detail::g_enabled.load(std::memory_order_relaxed);
+}
+
+void SetThreadName(const char* name) {
+    t_name = name;
+    if (t_buffer != nullptr) {
+        t_buffer->name.store(name, std::memory_order_relaxed);
+    }
+}
+
+void Complete(const char* name, uint64_t startUs, uint64_t endUs, const char* argName, uint64_t arg) {
+    if (!IsEnabled()) {
+        return;
+    }
+    Push(name, startUs, endUs > startUs ? endUs - startUs : 0, argName, arg);
+}
+
+void Instant(const char* name, const char* argName, uint64_t arg) {
+    if (!IsEnabled()) {
+        return;
+    }
+    Push(name, NowUs(), kInstant, argName, arg);
+}
+
+uint64_t NowUs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Names are string literals from this program, so they are written without
+// JSON escaping.
+bool Dump(const std::string& path) {
+    if (!IsEnabled()) {
+        return false;
+    }
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(g_mutex);
+    std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", file);
+    std::fputs("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,"
+               "\"args\":{\"name\":\"Remote-Share agent\"}}", file);
+    std::vector<EventCopy> events;
+    events.reserve(g_eventsPerThread);
+    size_t written = 0;
+    for (const std::unique_ptr<ThreadBuffer>& buffer : g_buffers) {
+        const char* threadName = buffer->name.load(std::memory_order_relaxed);
+        if (threadName) {
+            std::fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+                         "\"args\":{\"name\":\"%s\"}}", buffer->tid, threadName);
+        }
+        CopyEvents(*buffer, events);
+        for (const EventCopy& event : events) {
+            std::fprintf(file, ",\n{\"name\":\"%s\",\"pid\":1,\"tid\":%u,\"ts\":%llu", event.name, buffer->tid,
+                         static_cast<unsigned long long>(event.ts));
+            if (event.dur == kInstant) {
+                std::fputs(",\"ph\":\"i\",\"s\":\"t\"", file);
+            } else {
+                std::fprintf(file, ",\"ph\":\"X\",\"dur\":%llu", static_cast<unsigned long long>(event.dur));
+            }
+            if (event.argName && event.arg != kNoArg) {
+                std::fprintf(file, ",\"args\":{\"%s\":%llu}", event.argName,
+                             static_cast<unsigned long long>(event.arg));
+            }
+            std::fputc('}', file);
+        }
+        written += events.size();
+    }
+    std::fputs("\n]}\n", file);
+    bool ok = std::ferror(file) == 0;
+    ok = std::fclose(file) == 0 && ok;
+    std::cerr << "Trace: wrote " << written << " events from " << g_buffers.size() << " threads to "
+              << path << std::endl;
+    return ok;
+}
+
+} // namespace Trace
@@ -0,0 +1,72 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Opt-in per-frame tracing, written out as Chrome trace-event JSON (open it in
+// chrome://tracing or ui.perfetto.dev).
+//
+// Each thread records into its own fixed-size ring, so recording takes no
+// locks and never allocates after the thread's first event; once a ring is
+// full the oldest events are overwritten. A dump can run at any time from any
+// thread and writes the most recent events of every thread.
+//
+// When tracing is off a TraceScope costs one relaxed load.
+namespace Trace {
+
+const uint64_t kNoArg = ~uint64_t(0);
+
+// Events kept per thread once enabled.
+const size_t kDefaultEventsPerThread = size_t(1) << 16;
+
+void Enable(size_t eventsPerThread = kDefaultEventsPerThread);
+bool IsEnabled();
+
+// Names the calling thread in the trace. The name must outlive the process
+// (a string literal); threads without one show up by number.
+void SetThreadName(const char* name);
+
+// A finished span: name and argName must be string literals. argName labels
+// arg in the trace's "args", and is ignored when arg is kNoArg.
+void Complete(const char* name, uint64_t startUs, uint64_t endUs, const char* argName = nullptr,
+              uint64_t arg = kNoArg);
+// A point in time, for things without a duration (a frame dropped, say).
+void Instant(const char* name, const char* argName = nullptr, uint64_t arg = kNoArg);
+
+uint64_t NowUs();
+
+// Writes every thread's recent events to path, replacing the file. Returns
+// false if tracing is off or the file cannot be written.
+bool Dump(const std::string& path);
+
+namespace detail {
+extern std::atomic<bool> g_enabled;
+}
+
+} // namespace Trace
+
+// Records one complete event covering the enclosing scope.
+class TraceScope {
+public:
+    explicit TraceScope(const char* name, const char* argName = nullptr, uint64_t arg = Trace::kNoArg)
+        : m_name(name), m_argName(argName), m_arg(arg),
+          m_startUs(Trace::detail::g_enabled.load(std::memory_order_relaxed) ? Trace::NowUs() : 0) {
+    }
+    ~TraceScope() {
+        if (m_startUs != 0) {
+            Trace::Complete(m_name, m_startUs, Trace::NowUs(), m_argName, m_arg);
+        }
+    }
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+    // For args only known once the work is done, e.g. bytes produced.
+    void SetArg(uint64_t arg) { m_arg = arg; }
+
+private:
+    const char* m_name;
+    const char* m_argName;
+    uint64_t m_arg;
+    uint64_t m_startUs;
+};
@@ -0,0 +1,50 @@
+#include "ViewerMessage.hpp"
+#include "InputProtocol.hpp"
+#include <iostream>
+#include <nlohmann/json.hpp>
+
+ViewerCommand ParseViewerMessage(const std::string& message, InputEvent& event) {
+    // Binary input records are the common case at pointer rates; decode them
+    // without going through JSON.
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(message.data());
+    if (InputProtocol::IsInputRecord(bytes, message.size())) {
+        return InputProtocol::ParseRecord(bytes, message.size(), event) ? ViewerCommand::Input : ViewerCommand::None;
+    }
+
+    try {
+        auto json_msg = nlohmann::json::parse(message);
+        std::string type = json_msg.value("type", "");
+
+        if (type == "input") {
+            if (!InputEvent::ParseType(json_msg.value("inputType", ""), event.type)) {
+                return ViewerCommand::None;
+            }
+            if (event.IsKeyboard()) {
+                event.SetKey(json_msg.value("key", ""));
+                event.SetCode(json_msg.value("code", ""));
+                event.ctrlKey = json_msg.value("ctrlKey", false);
+                event.shiftKey = json_msg.value("shiftKey", false);
+                event.altKey = json_msg.value("altKey", false);
+                event.metaKey = json_msg.value("metaKey", false);
+            } else {
+                event.x = json_msg.value("x", 0);
+                event.y = json_msg.value("y", 0);
+                event.button = json_msg.value("button", -1);
+                event.deltaY = json_msg.value("deltaY", 0);
+            }
+            return ViewerCommand::Input;
+        }
+        if (type == "keyframe_request" || type == "viewer_ready") {
+            return ViewerCommand::Keyframe;
+        }
+        if (type == "close_connection") {
+            return ViewerCommand::Close;
+        }
+        if (type == "toggle_fullscreen") {
+            return ViewerCommand::ToggleFullscreen;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error handling message: " << e.what() << std::endl;
+    }
+    return ViewerCommand::None;
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include <string>
+#include "InputEvent.hpp"
+
+// What a message from a viewer (through the relay) asks the agent to do.
+enum class ViewerCommand {
+    None,              // not for the agent, or malformed
+    Input,             // inject the parsed event
+    Keyframe,          // a viewer joined or lost track of the frame sequence
+    Close,
+    ToggleFullscreen
+};
+
+// Decodes one relay message. Binary input records (InputProtocol.hpp) are
+// decoded in place; anything else is parsed as JSON. For Input, event holds
+// the parsed event.
+ViewerCommand ParseViewerMessage(const std::string& message, InputEvent& event);
@@ -1,8 +1,19 @@
 #include "WebSocketClient.hpp"
+#include "FrameProtocol.hpp"
+#include "Metrics.hpp"
+#include "Trace.hpp"
+#include <algorithm>
 #include <iostream>
 
+namespace {
+// Largest piece of frame data queued at once. A control message waits for at
+// most one of these, about 5 ms at 100 Mbit/s.
+const size_t kDefaultFragmentSize = 64 * 1024;
+const size_t kMinFragmentSize = 4 * 1024;
+}
+
 WebSocketClient::WebSocketClient(const std::string& uri)
-    : m_uri(uri), m_connected(false) {
+    : m_uri(uri), m_connected(false), m_fragmentSize(kDefaultFragmentSize) {
     m_client.init_asio();
 
     // Suppress verbose access log channels, keep error channels
@@ -69,6 +80,11 @@ void WebSocketClient::connect() {
     con->append_header("Sec-WebSocket-Protocol", "remote-share");
     con->append_header("Origin", "http://localhost:8080");
     con->add_subprotocol("remote-share");
+    con->set_drain_handler(websocketpp::lib::bind(
+        &WebSocketClient::onDrain,
+        this,
+        websocketpp::lib::placeholders::_1
+    ));
 
     // Connect the connection
     m_hdl = con->get_handle();
@@ -77,6 +93,7 @@ void WebSocketClient::connect() {
     // Start the ASIO io_service in a separate thread if not already running
     if (!m_thread.joinable()) {
         m_thread = websocketpp::lib::thread([&]() {
+            Trace::SetThreadName("websocket");
             try {
                 m_client.run();
                 std::cerr << "WebSocket client run loop ended. Attempting to reconnect..." << std::endl;
@@ -106,6 +123,165 @@ void WebSocketClient::send(const std::string& message_payload) {
     }
 }
 
+client::message_ptr WebSocketClient::createMessage(websocketpp::frame::opcode::value op, size_t sizeHint) {
+    if (!m_connected.load() || m_hdl.expired()) {
+        return client::message_ptr();
+    }
+    websocketpp::lib::error_code ec;
+    client::connection_ptr con = m_client.get_con_from_hdl(m_hdl, ec);
+    if (ec || !con) {
+        return client::message_ptr();
+    }
+    return con->get_message(op, sizeHint);
+}
+
+bool WebSocketClient::send(client::message_ptr message) {
+    if (!message || !m_connected.load() || m_hdl.expired()) {
+        return false;
+    }
+    websocketpp::lib::error_code ec;
+    m_client.send(m_hdl, message, ec);
+    if (ec) {
+        std::cerr << "Error sending message: " << ec.message() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool WebSocketClient::sendFrame(client::message_ptr frame, const FrameTiming& timing) {
+    if (!frame || !m_connected.load() || m_hdl.expired()) {
+        return false;
+    }
+    bool schedule = false;
+    {
+        std::lock_guard<std::mutex> lock(m_frameMutex);
+        if (m_pendingFrame) {
+            return false;
+        }
+        m_pendingFrame = frame;
+        m_pendingTiming = timing;
+        ++m_sendStats.framesQueued;
+        if (!m_pumpScheduled) {
+            m_pumpScheduled = true;
+            schedule = true;
+        }
+    }
+    if (schedule) {
+        m_client.get_io_service().post(websocketpp::lib::bind(&WebSocketClient::pumpFrames, this));
+    }
+    return true;
+}
+
+bool WebSocketClient::hasPendingFrame() const {
+    std::lock_guard<std::mutex> lock(m_frameMutex);
+    return static_cast<bool>(m_pendingFrame);
+}
+
+void WebSocketClient::setFragmentSize(size_t bytes) {
+    std::lock_guard<std::mutex> lock(m_frameMutex);
+    m_fragmentSize = std::max(bytes, kMinFragmentSize);
+}
+
+SendStats WebSocketClient::getSendStats() const {
+    std::lock_guard<std::mutex> lock(m_frameMutex);
+    return m_sendStats;
+}
+
+void WebSocketClient::setOnFrameWrittenHandler(std::function<void(const FrameTiming&)> handler) {
+    m_onFrameWrittenHandler = handler;
+}
+
+size_t WebSocketClient::bufferedAmount() {
+    websocketpp::lib::error_code ec;
+    client::connection_ptr con = m_client.get_con_from_hdl(m_hdl, ec);
+    if (ec || !con) {
+        return 0;
+    }
+    return con->get_buffered_amount();
+}
+
+// Runs on the ASIO thread when a frame arrives in the slot and whenever the
+// connection has written everything queued. Queues the next fragment of frame
+// data unless the previous one is still waiting or being written.
+void WebSocketClient::pumpFrames() {
+    TraceScope scope("ws pump", "bytes");
+    client::message_ptr whole;
+    size_t offset = 0;
+    size_t size = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_frameMutex);
+        m_pumpScheduled = false;
+        if (!m_connected.load()) {
+            m_pendingFrame.reset();
+            m_activeFrame.reset();
+            return;
+        }
+        if (m_awaitingDrain) {
+            return;
+        }
+        if (!m_activeFrame) {
+            if (!m_pendingFrame) {
+                return;
+            }
+            m_activeFrame.swap(m_pendingFrame);
+            m_activeOffset = 0;
+            m_activeTiming = m_pendingTiming;
+            m_activeTiming.takenUs = Metrics::NowUs();
+            m_activeTiming.bytes = m_activeFrame->get_payload().size();
+            ++m_streamId;
+            ++m_sendStats.framesSent;
+        }
+        size_t buffered = bufferedAmount();
+        if (buffered > m_sendStats.peakBufferedBytes) {
+            m_sendStats.peakBufferedBytes = buffered;
+        }
+
+        // Text frames go whole: the JSON viewers do not know about chunks.
+        size_t total = m_activeFrame->get_payload().size();
+        if (m_activeFrame->get_opcode() != websocketpp::frame::opcode::binary ||
+            (m_activeOffset == 0 && total <= m_fragmentSize)) {
+            whole.swap(m_activeFrame);
+            m_lastFragmentQueued = true;
+        } else {
+            offset = m_activeOffset;
+            size = std::min(m_fragmentSize, total - offset);
+            m_activeOffset += size;
+            m_lastFragmentQueued = m_activeOffset == total;
+            ++m_sendStats.chunksSent;
+        }
+        m_awaitingDrain = true;
+    }
+
+    scope.SetArg(whole ? whole->get_payload().size() : size);
+    client::message_ptr msg = whole;
+    if (!msg) {
+        const std::string& payload = m_activeFrame->get_payload();
+        msg = createMessage(websocketpp::frame::opcode::binary, FrameProtocol::kChunkHeaderSize + size);
+        if (msg) {
+            FrameProtocol::ChunkHeader header;
+            header.streamId = m_streamId;
+            header.offset = static_cast<uint32_t>(offset);
+            header.totalSize = static_cast<uint32_t>(payload.size());
+            uint8_t headerBytes[FrameProtocol::kChunkHeaderSize];
+            FrameProtocol::WriteChunkHeader(header, headerBytes);
+            msg->append_payload(headerBytes, sizeof(headerBytes));
+            msg->append_payload(payload.data() + offset, size);
+        }
+        if (offset + size == payload.size()) {
+            std::lock_guard<std::mutex> lock(m_frameMutex);
+            m_activeFrame.reset();
+        }
+    }
+
+    if (!send(msg)) {
+        // Nothing was queued, so no drain will follow; give up on this frame.
+        std::lock_guard<std::mutex> lock(m_frameMutex);
+        m_activeFrame.reset();
+        m_awaitingDrain = false;
+        m_lastFragmentQueued = false;
+    }
+}
+
 bool WebSocketClient::isConnected() const {
     // A robust check: atomic flag and handle validity
     return m_connected.load() && !m_hdl.expired();
@@ -128,6 +304,13 @@ void WebSocketClient::onOpen(websocketpp::connection_hdl hdl) {
     // std::cout << "WebSocket Connected!" << std::endl; // Already handled by onOpenHandler callback
     m_hdl = hdl; // Store the connection handle
     m_connected.store(true); // Atomically set connected state
+    {
+        std::lock_guard<std::mutex> lock(m_frameMutex);
+        m_pumpScheduled = false;
+        m_activeFrame.reset();
+        m_awaitingDrain = false;
+        m_lastFragmentQueued = false;
+    }
 
     if (m_onOpenHandler) {
         m_onOpenHandler(); // Call the user-defined callback
@@ -137,6 +320,14 @@ void WebSocketClient::onOpen(websocketpp::connection_hdl hdl) {
 void WebSocketClient::onClose(websocketpp::connection_hdl hdl) {
     // std::cout << "WebSocket Disconnected." << std::endl; // Already handled by onCloseHandler callback
     m_connected.store(false); // Atomically set disconnected state
+    {
+        // A frame meant for the old connection is useless after a reconnect
+        std::lock_guard<std::mutex> lock(m_frameMutex);
+        m_pendingFrame.reset();
+        m_activeFrame.reset();
+        m_awaitingDrain = false;
+        m_lastFragmentQueued = false;
+    }
 
     if (m_onCloseHandler) {
         m_onCloseHandler(); // Call the user-defined callback
@@ -144,11 +335,32 @@ void WebSocketClient::onClose(websocketpp::connection_hdl hdl) {
 }
 
 void WebSocketClient::onMessage(websocketpp::connection_hdl hdl, client::message_ptr msg) {
+    TraceScope scope("ws message", "bytes", msg->get_payload().size());
     if (m_onMessageHandler) {
         m_onMessageHandler(msg->get_payload()); // Call the user-defined callback with message payload
     }
 }
 
+void WebSocketClient::onDrain(websocketpp::connection_hdl hdl) {
+    TraceScope scope("ws drain");
+    bool frameWritten = false;
+    FrameTiming timing;
+    {
+        std::lock_guard<std::mutex> lock(m_frameMutex);
+        m_awaitingDrain = false;
+        if (m_lastFragmentQueued) {
+            m_lastFragmentQueued = false;
+            frameWritten = true;
+            timing = m_activeTiming;
+        }
+    }
+    if (frameWritten && m_onFrameWrittenHandler) {
+        timing.writtenUs = Metrics::NowUs();
+        m_onFrameWrittenHandler(timing);
+    }
+    pumpFrames();
+}
+
 void WebSocketClient::onFail(websocketpp::connection_hdl hdl) {
     m_connected = false;
     std::cerr << "WebSocket connection failed" << std::endl;
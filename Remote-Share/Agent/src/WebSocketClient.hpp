@@ -4,21 +4,81 @@
 #include <functional> 
 #include <thread>     
 #include <atomic>     
-#define ASIO_STANDALONE 
+#include <mutex>
+// CMake defines ASIO_STANDALONE when standalone asio is installed (MinGW);
+// otherwise websocketpp uses Boost.Asio.
+#ifdef ASIO_STANDALONE
 #include <asio.hpp>
+#endif
 #include <websocketpp/config/asio_no_tls_client.hpp> 
 #include <websocketpp/config/asio_client.hpp>
 #include <websocketpp/client.hpp>
+#include <websocketpp/message_buffer/pool.hpp>
 #include <websocketpp/common/thread.hpp> 
 #include <websocketpp/common/memory.hpp> 
 #include <nlohmann/json.hpp>
-typedef websocketpp::client<websocketpp::config::asio_client> client;
+// asio_client with pooled message buffers. Released messages keep their
+// payload capacity and are handed out again, so steady-state sending does not
+// allocate.
+struct PooledClientConfig : public websocketpp::config::asio_client {
+    typedef PooledClientConfig type;
+    typedef websocketpp::config::asio_client base;
+
+    typedef websocketpp::message_buffer::message<
+        websocketpp::message_buffer::pool::con_msg_manager> message_type;
+    typedef websocketpp::message_buffer::pool::con_msg_manager<message_type>
+        con_msg_manager_type;
+    typedef websocketpp::message_buffer::pool::endpoint_msg_manager<con_msg_manager_type>
+        endpoint_msg_manager_type;
+};
+
+typedef websocketpp::client<PooledClientConfig> client;
+
+// Counters for the frame send scheduler (see sendFrame).
+struct SendStats {
+    uint64_t framesQueued = 0;
+    uint64_t framesSent = 0;
+    uint64_t chunksSent = 0;       // frame chunk messages (see FrameProtocol.hpp)
+    size_t peakBufferedBytes = 0;  // most bytes seen waiting in websocketpp
+};
+
+// Timestamps (Metrics::NowUs clock) that follow a frame through the send
+// scheduler and come back in the frame-written handler.
+struct FrameTiming {
+    uint64_t captureUs = 0;  // set by the caller
+    uint64_t encodedUs = 0;  // set by the caller
+    uint64_t takenUs = 0;    // scheduler started writing it
+    uint64_t writtenUs = 0;  // websocketpp wrote the last byte
+    size_t bytes = 0;
+};
+
 class WebSocketClient {
 public:
     WebSocketClient(const std::string& uri);
     ~WebSocketClient();
     void connect();
     void send(const std::string& message_payload);
+    // Starts a message for the caller to fill via append_payload() or
+    // get_raw_payload(), so large payloads are copied into it exactly once.
+    // Returns nullptr if not connected.
+    client::message_ptr createMessage(websocketpp::frame::opcode::value op, size_t sizeHint);
+    bool send(client::message_ptr message);
+    // Messages are sent in two priority lanes. Control messages (send()) go
+    // straight to websocketpp. Frames wait in a single slot and are written
+    // one fragment at a time: a binary frame larger than the fragment size
+    // goes out as FrameChunk messages, and the next chunk is only queued once
+    // the connection has written everything before it. A control message
+    // therefore waits for at most one fragment. Text (JSON) frames are not
+    // chunked, since those viewers do not reassemble, so with --text-frames a
+    // control message can wait behind a whole frame. A frame is never replaced
+    // or dropped: while one is still waiting in the slot, sendFrame returns
+    // false and the caller keeps its frame until hasPendingFrame() clears.
+    bool sendFrame(client::message_ptr frame, const FrameTiming& timing = FrameTiming());
+    bool hasPendingFrame() const;
+    void setFragmentSize(size_t bytes);
+    SendStats getSendStats() const;
+    // Called on the ASIO thread once a frame has been written out in full.
+    void setOnFrameWrittenHandler(std::function<void(const FrameTiming&)> handler);
     bool isConnected() const;
     void setOnOpenHandler(std::function<void()> handler);
     void setOnCloseHandler(std::function<void()> handler);
@@ -33,7 +93,25 @@ private:
     void onClose(websocketpp::connection_hdl hdl);
     void onMessage(websocketpp::connection_hdl hdl, client::message_ptr msg);
     void onFail(websocketpp::connection_hdl hdl);
+    void onDrain(websocketpp::connection_hdl hdl);
+    void pumpFrames();
+    size_t bufferedAmount();
     std::function<void()> m_onOpenHandler;
     std::function<void()> m_onCloseHandler;
     std::function<void(const std::string&)> m_onMessageHandler;
+    std::function<void(const FrameTiming&)> m_onFrameWrittenHandler;
+
+    mutable std::mutex m_frameMutex;
+    client::message_ptr m_pendingFrame;
+    FrameTiming m_pendingTiming;
+    bool m_pumpScheduled = false;
+    // Frame being written chunk by chunk; only touched on the ASIO thread.
+    client::message_ptr m_activeFrame;
+    size_t m_activeOffset = 0;
+    FrameTiming m_activeTiming;
+    uint32_t m_streamId = 0;
+    bool m_awaitingDrain = false;  // a fragment is queued or being written
+    bool m_lastFragmentQueued = false;  // the drain will finish m_activeTiming's frame
+    size_t m_fragmentSize;
+    SendStats m_sendStats;
 };
\ No newline at end of file
@@ -0,0 +1,532 @@
+#include "X11FrameSource.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+// After our own headers: Xlib defines None, Status, Bool and friends as macros.
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/XShm.h>
+#ifdef REMOTE_SHARE_HAVE_XDAMAGE
+#include <X11/extensions/Xdamage.h>
+#include <X11/extensions/Xfixes.h>
+#endif
+
+namespace {
+
+// Past this share of the frame, damage is read back as one full frame (which
+// also makes it a keyframe).
+const double kFullReadRatio = 0.5;
+
+// Xlib reports protocol errors through one process-wide handler, and the
+// default one exits. Some are expected here (a window destroyed between the
+// geometry query and the grab), so they are counted instead and whichever
+// call saw the count move fails.
+std::atomic<unsigned long> g_xErrors{0};
+
+int OnXError(Display*, XErrorEvent*) {
+    g_xErrors.fetch_add(1, std::memory_order_relaxed);
+    return 0;
+}
+
+// One pool buffer. The image is only a header describing the current geometry;
+// its pixels are the segment.
+struct Segment {
+    XShmSegmentInfo info = {};
+    size_t bytes = 0;
+    XImage* image = nullptr;
+};
+
+void DestroyImage(Segment& segment) {
+    if (segment.image) {
+        segment.image->data = nullptr;  // the segment is not XDestroyImage's to free
+        XDestroyImage(segment.image);
+        segment.image = nullptr;
+    }
+}
+
+// The part of the target that can be read back: XShmGetImage fails unless the
+// whole rectangle is on screen.
+struct CaptureArea {
+    Window drawable = 0;
+    Visual* visual = nullptr;
+    int depth = 0;
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+
+    bool SameGeometry(const CaptureArea& other) const {
+        return x == other.x && y == other.y && width == other.width && height == other.height;
+    }
+};
+
+} // namespace
+
+struct X11FrameSource::Impl : public FrameAllocator {
+    ~Impl() override {
+        pool.reset();  // frees the segments while the display is still open
+#ifdef REMOTE_SHARE_HAVE_XDAMAGE
+        if (damage) {
+            XDamageDestroy(display, damage);
+        }
+        if (parts) {
+            XFixesDestroyRegion(display, parts);
+        }
+#endif
+        if (display) {
+            XCloseDisplay(display);
+        }
+        for (int fd : wakePipe) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+    }
+
+    uint8_t* Allocate(size_t bytes) override;
+    void Free(uint8_t* data, size_t bytes) override;
+
+    Segment* Find(const uint8_t* data);
+    bool Locate(unsigned long target, CaptureArea& area);
+    bool CheckVisual(const CaptureArea& area);
+    bool ReadRows(XImage* image, const CaptureArea& area, int top, int rows);
+
+    void Track(Window drawable);
+    void ProcessEvents();
+    bool TakeDamage(const CaptureArea& area, std::vector<FrameRect>& dirty);
+
+    Display* display = nullptr;
+    std::vector<int> bitsPerPixel;  // by depth, from the server's pixmap formats
+    std::vector<std::unique_ptr<Segment>> segments;
+    std::unique_ptr<FramePool> pool;
+
+    // Last visual checked, so an unsupported one is logged once.
+    Visual* visual = nullptr;
+    int depth = 0;
+    bool visualOk = false;
+
+    // Damage tracking. Capture thread only, except fullRequested and the wake
+    // pipe.
+    bool damageEnabled = false;
+#ifdef REMOTE_SHARE_HAVE_XDAMAGE
+    int damageEventBase = 0;
+    Damage damage = 0;
+    XserverRegion parts = 0;
+#endif
+    Window damageDrawable = 0;
+    CaptureArea lastArea;  // what the previous frame covered
+    bool damagePending = false;
+    std::atomic<bool> fullRequested{true};
+    int wakePipe[2] = {-1, -1};
+    std::vector<std::pair<int, int>> bands;  // row ranges to read back, reused
+};
+
+uint8_t* X11FrameSource::Impl::Allocate(size_t bytes) {
+    std::unique_ptr<Segment> segment(new Segment());
+    segment->bytes = bytes;
+    segment->info.shmid = shmget(IPC_PRIVATE, bytes, IPC_CREAT | 0600);
+    if (segment->info.shmid < 0) {
+        std::cerr << "shmget of " << bytes << " bytes failed" << std::endl;
+        return nullptr;
+    }
+    segment->info.shmaddr = static_cast<char*>(shmat(segment->info.shmid, nullptr, 0));
+    if (segment->info.shmaddr == reinterpret_cast<char*>(-1)) {
+        std::cerr << "shmat failed" << std::endl;
+        shmctl(segment->info.shmid, IPC_RMID, nullptr);
+        return nullptr;
+    }
+    segment->info.readOnly = False;
+
+    unsigned long errors = g_xErrors.load();
+    bool attached = XShmAttach(display, &segment->info) != 0;
+    XSync(display, False);
+    // Once the server holds it, the segment can be marked for removal: it then
+    // goes away with the last detach, even if the agent dies first.
+    shmctl(segment->info.shmid, IPC_RMID, nullptr);
+    if (!attached || g_xErrors.load() != errors) {
+        std::cerr << "XShmAttach failed; is the display remote?" << std::endl;
+        shmdt(segment->info.shmaddr);
+        return nullptr;
+    }
+
+    uint8_t* data = reinterpret_cast<uint8_t*>(segment->info.shmaddr);
+    segments.push_back(std::move(segment));
+    return data;
+}
+
+void X11FrameSource::Impl::Free(uint8_t* data, size_t) {
+    for (size_t i = 0; i < segments.size(); ++i) {
+        Segment& segment = *segments[i];
+        if (reinterpret_cast<uint8_t*>(segment.info.shmaddr) == data) {
+            DestroyImage(segment);
+            XShmDetach(display, &segment.info);
+            XSync(display, False);
+            shmdt(segment.info.shmaddr);
+            segments.erase(segments.begin() + i);
+            return;
+        }
+    }
+}
+
+Segment* X11FrameSource::Impl::Find(const uint8_t* data) {
+    for (const std::unique_ptr<Segment>& segment : segments) {
+        if (reinterpret_cast<const uint8_t*>(segment->info.shmaddr) == data) {
+            return segment.get();
+        }
+    }
+    return nullptr;
+}
+
+bool X11FrameSource::Impl::Locate(unsigned long target, CaptureArea& area) {
+    Window root = DefaultRootWindow(display);
+    Window drawable = target == kRootWindow ? root : static_cast<Window>(target);
+    XWindowAttributes attributes;
+    unsigned long errors = g_xErrors.load();
+    if (!XGetWindowAttributes(display, drawable, &attributes) || g_xErrors.load() != errors ||
+        attributes.map_state != IsViewable) {
+        return false;
+    }
+
+    area.drawable = drawable;
+    area.visual = attributes.visual;
+    area.depth = attributes.depth;
+    area.x = 0;
+    area.y = 0;
+    area.width = attributes.width;
+    area.height = attributes.height;
+    if (drawable == root) {
+        return area.width > 0 && area.height > 0;
+    }
+
+    int rootX = 0, rootY = 0;
+    Window child;
+    if (!XTranslateCoordinates(display, drawable, attributes.root, 0, 0, &rootX, &rootY, &child)) {
+        return false;
+    }
+    int left = std::max(0, -rootX);
+    int top = std::max(0, -rootY);
+    int right = std::min(attributes.width, WidthOfScreen(attributes.screen) - rootX);
+    int bottom = std::min(attributes.height, HeightOfScreen(attributes.screen) - rootY);
+    if (right <= left || bottom <= top) {
+        return false;
+    }
+    area.x = left;
+    area.y = top;
+    area.width = right - left;
+    area.height = bottom - top;
+    return true;
+}
+
+bool X11FrameSource::Impl::CheckVisual(const CaptureArea& area) {
+    if (area.visual == visual && area.depth == depth) {
+        return visualOk;
+    }
+    visual = area.visual;
+    depth = area.depth;
+    // BGRX in memory: 32 bits per pixel, 8-bit channels, least significant
+    // byte first.
+    visualOk = visual->c_class == TrueColor && visual->red_mask == 0xff0000 && visual->green_mask == 0xff00 &&
+               visual->blue_mask == 0xff && depth < static_cast<int>(bitsPerPixel.size()) &&
+               bitsPerPixel[depth] == 32 && ImageByteOrder(display) == LSBFirst;
+    if (!visualOk) {
+        std::cerr << "X11 capture needs a 32 bpp BGRX visual; target has depth " << depth << std::endl;
+    }
+    return visualOk;
+}
+
+// XShmGetImage fills the whole image, starting at its data pointer (sent as an
+// offset into the segment). A full-width header pointed at row top and cut
+// short reads just those rows, in place at the frame's stride.
+bool X11FrameSource::Impl::ReadRows(XImage* image, const CaptureArea& area, int top, int rows) {
+    char* data = image->data;
+    int height = image->height;
+    image->data = data + static_cast<size_t>(top) * image->bytes_per_line;
+    image->height = rows;
+    unsigned long errors = g_xErrors.load();
+    bool ok = XShmGetImage(display, area.drawable, image, area.x, area.y + top, AllPlanes) &&
+              g_xErrors.load() == errors;
+    image->data = data;
+    image->height = height;
+    return ok;
+}
+
+void X11FrameSource::Impl::Track(Window drawable) {
+#ifdef REMOTE_SHARE_HAVE_XDAMAGE
+    if (damage) {
+        XDamageDestroy(display, damage);
+    }
+    // One event each time the damage goes from empty to not; the rectangles
+    // themselves are fetched at capture time.
+    damage = XDamageCreate(display, drawable, XDamageReportNonEmpty);
+#endif
+    damageDrawable = drawable;
+}
+
+void X11FrameSource::Impl::ProcessEvents() {
+    while (XPending(display) > 0) {
+        XEvent event;
+        XNextEvent(display, &event);
+#ifdef REMOTE_SHARE_HAVE_XDAMAGE
+        if (event.type == damageEventBase + XDamageNotify) {
+            damagePending = true;
+        }
+#endif
+    }
+}
+
+// Moves the damage accumulated on the server into dirty, in frame
+// coordinates. Returns false if so much is damaged that reading the whole
+// frame is better.
+bool X11FrameSource::Impl::TakeDamage(const CaptureArea& area, std::vector<FrameRect>& dirty) {
+    dirty.clear();
+    damagePending = false;
+#ifdef REMOTE_SHARE_HAVE_XDAMAGE
+    XDamageSubtract(display, damage, None, parts);
+    int count = 0;
+    XRectangle* rects = XFixesFetchRegion(display, parts, &count);
+    uint64_t pixels = 0;
+    for (int i = 0; i < count; ++i) {
+        int left = std::max(0, rects[i].x - area.x);
+        int top = std::max(0, rects[i].y - area.y);
+        int right = std::min(area.width, rects[i].x + rects[i].width - area.x);
+        int bottom = std::min(area.height, rects[i].y + rects[i].height - area.y);
+        if (right <= left || bottom <= top) {
+            continue;
+        }
+        FrameRect rect;
+        rect.x = left;
+        rect.y = top;
+        rect.width = right - left;
+        rect.height = bottom - top;
+        dirty.push_back(rect);
+        pixels += static_cast<uint64_t>(rect.width) * static_cast<uint64_t>(rect.height);
+    }
+    if (rects) {
+        XFree(rects);
+    }
+    return pixels <= static_cast<uint64_t>(area.width) * static_cast<uint64_t>(area.height) * kFullReadRatio;
+#else
+    (void)area;
+    return false;
+#endif
+}
+
+X11FrameSource::X11FrameSource(const char* display, size_t poolSlots, bool damage)
+    : m_impl(new Impl()) {
+    XSetErrorHandler(OnXError);
+    m_impl->display = XOpenDisplay(display);
+    if (!m_impl->display) {
+        std::cerr << "Cannot open X display " << (display ? display : "$DISPLAY") << std::endl;
+        return;
+    }
+    if (!XShmQueryExtension(m_impl->display)) {
+        std::cerr << "X server has no MIT-SHM extension" << std::endl;
+        XCloseDisplay(m_impl->display);
+        m_impl->display = nullptr;
+        return;
+    }
+    int formatCount = 0;
+    XPixmapFormatValues* formats = XListPixmapFormats(m_impl->display, &formatCount);
+    for (int i = 0; i < formatCount; ++i) {
+        if (formats[i].depth >= static_cast<int>(m_impl->bitsPerPixel.size())) {
+            m_impl->bitsPerPixel.resize(formats[i].depth + 1, 0);
+        }
+        m_impl->bitsPerPixel[formats[i].depth] = formats[i].bits_per_pixel;
+    }
+    if (formats) {
+        XFree(formats);
+    }
+    m_impl->pool.reset(new FramePool(poolSlots, m_impl.get()));
+
+    if (!damage) {
+        return;
+    }
+#ifdef REMOTE_SHARE_HAVE_XDAMAGE
+    int damageError = 0, fixesEvent = 0, fixesError = 0;
+    int major = 1, minor = 1;
+    if (!XDamageQueryExtension(m_impl->display, &m_impl->damageEventBase, &damageError) ||
+        !XDamageQueryVersion(m_impl->display, &major, &minor) ||
+        !XFixesQueryExtension(m_impl->display, &fixesEvent, &fixesError)) {
+        std::cerr << "X server has no DAMAGE extension; polling the screen instead" << std::endl;
+        return;
+    }
+    major = 2;
+    minor = 0;
+    XFixesQueryVersion(m_impl->display, &major, &minor);
+    if (pipe(m_impl->wakePipe) != 0) {
+        std::cerr << "Cannot create a wake pipe; polling the screen instead" << std::endl;
+        return;
+    }
+    fcntl(m_impl->wakePipe[0], F_SETFL, O_NONBLOCK);
+    fcntl(m_impl->wakePipe[1], F_SETFL, O_NONBLOCK);
+    m_impl->parts = XFixesCreateRegion(m_impl->display, nullptr, 0);
+    m_impl->damageEnabled = true;
+#else
+    std::cerr << "Built without XDamage; polling the screen instead" << std::endl;
+#endif
+}
+
+X11FrameSource::~X11FrameSource() = default;
+
+bool X11FrameSource::IsOpen() const {
+    return m_impl->display != nullptr;
+}
+
+bool X11FrameSource::QuerySize(int& width, int& height) {
+    CaptureArea area;
+    if (!m_impl->display || !m_impl->Locate(m_target.load(), area)) {
+        return false;
+    }
+    width = area.width;
+    height = area.height;
+    return true;
+}
+
+PooledFrame X11FrameSource::Capture() {
+    Impl& impl = *m_impl;
+    CaptureArea area;
+    if (!impl.display || !impl.Locate(m_target.load(), area) || !impl.CheckVisual(area)) {
+        return PooledFrame();
+    }
+
+    int stride = area.width * 4;
+    impl.pool->Configure(area.width, area.height, stride, PixelFormat::BGRX32);
+    PooledFrame frame = impl.pool->Acquire();
+    if (!frame) {
+        return frame;
+    }
+    Segment* segment = impl.Find(frame.Data());
+    if (!segment) {
+        frame.Release();
+        return frame;
+    }
+
+    // Image headers are made once per segment and geometry; steady capture
+    // only issues the request.
+    XImage* image = segment->image;
+    if (!image || image->width != area.width || image->height != area.height || image->depth != area.depth) {
+        DestroyImage(*segment);
+        image = XShmCreateImage(impl.display, area.visual, area.depth, ZPixmap, segment->info.shmaddr,
+                                &segment->info, area.width, area.height);
+        if (!image || image->bytes_per_line != stride) {
+            std::cerr << "XShmCreateImage failed for " << area.width << "x" << area.height << std::endl;
+            segment->image = image;
+            DestroyImage(*segment);
+            frame.Release();
+            return frame;
+        }
+        segment->image = image;
+    }
+
+    bool ok;
+    if (!impl.damageEnabled) {
+        ok = impl.ReadRows(image, area, 0, area.height);
+    } else {
+        // A new target or geometry has no damage history to go on.
+        bool full = impl.fullRequested.exchange(false) || !area.SameGeometry(impl.lastArea);
+        if (area.drawable != impl.damageDrawable) {
+            impl.Track(area.drawable);
+            full = true;
+        }
+        impl.lastArea = area;
+        // Taken before the readback, so anything drawn meanwhile is reported
+        // again next time.
+        std::vector<FrameRect>& dirty = frame.DirtyRects();
+        if (!impl.TakeDamage(area, dirty) || full) {
+            dirty.clear();
+            FrameRect all;
+            all.width = area.width;
+            all.height = area.height;
+            dirty.push_back(all);
+        }
+
+        // Whole rows covering the damage, merged where they touch.
+        impl.bands.clear();
+        for (const FrameRect& rect : dirty) {
+            impl.bands.push_back(std::make_pair(rect.y, rect.y + rect.height));
+        }
+        std::sort(impl.bands.begin(), impl.bands.end());
+        ok = true;
+        for (size_t i = 0; ok && i < impl.bands.size();) {
+            int top = impl.bands[i].first;
+            int bottom = impl.bands[i].second;
+            for (++i; i < impl.bands.size() && impl.bands[i].first <= bottom; ++i) {
+                bottom = std::max(bottom, impl.bands[i].second);
+            }
+            ok = impl.ReadRows(image, area, top, bottom - top);
+        }
+        if (!ok) {
+            // The damage is gone from the server; only a full frame makes up
+            // for it.
+            impl.fullRequested.store(true);
+        }
+    }
+    if (!ok) {
+        // Usually the window was unmapped or moved since Locate; try again
+        // next frame.
+        frame.Release();
+        return frame;
+    }
+    frame.SetTimestampUs(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count()));
+    return frame;
+}
+
+bool X11FrameSource::ReportsDamage() const {
+    return m_impl->damageEnabled;
+}
+
+bool X11FrameSource::WaitForDamage(std::chrono::milliseconds timeout) {
+    Impl& impl = *m_impl;
+    if (!impl.damageEnabled) {
+        return FrameSource::WaitForDamage(timeout);
+    }
+    impl.ProcessEvents();
+    if (!impl.damagePending && !impl.fullRequested.load()) {
+        pollfd fds[2] = {};
+        fds[0].fd = ConnectionNumber(impl.display);
+        fds[0].events = POLLIN;
+        fds[1].fd = impl.wakePipe[0];
+        fds[1].events = POLLIN;
+        poll(fds, 2, static_cast<int>(timeout.count()));
+        char drain[64];
+        while (read(impl.wakePipe[0], drain, sizeof(drain)) > 0) {
+        }
+        impl.ProcessEvents();
+    }
+    return impl.damagePending || impl.fullRequested.load();
+}
+
+void X11FrameSource::DamageAll() {
+    m_impl->fullRequested.store(true);
+    Wake();
+}
+
+void X11FrameSource::Wake() {
+    if (m_impl->wakePipe[1] >= 0) {
+        char byte = 0;
+        (void)!write(m_impl->wakePipe[1], &byte, 1);
+    }
+}
+
+bool ParseX11Window(const std::string& text, unsigned long& window) {
+    if (text.empty()) {
+        return false;
+    }
+    char* end = nullptr;
+    unsigned long value = std::strtoul(text.c_str(), &end, 0);
+    if (end == text.c_str() || *end != '\0' || value == 0) {
+        return false;
+    }
+    window = value;
+    return true;
+}
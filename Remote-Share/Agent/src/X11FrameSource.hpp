@@ -0,0 +1,64 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <string>
+#include "FrameSource.hpp"
+
+// Captures an X11 screen, or one window on it, with the MIT-SHM extension.
+// Every pooled frame buffer is a shared memory segment attached to the X
+// server, so XShmGetImage writes the pixels straight into the buffer the
+// pipeline encodes from: no copy, and no allocation once the pool has grown to
+// the screen size. Frames are BGRX32.
+//
+// Needs a TrueColor visual with 32 bits per pixel (what Xorg and Xvfb use at
+// depth 24) and a local display, since the segments are shared with the
+// server. Works without a GPU, e.g. under Xvfb.
+//
+// With damage on (and the agent built with XDamage) the source subscribes to
+// the server's damage reports for the target: the capture thread sleeps until
+// something is drawn, only the rows holding damage are read back, and the
+// damaged rectangles become the frame's dirty list, so nothing is diffed.
+//
+// X headers stay out of this one: their macros (None, Status, ...) collide
+// with names used elsewhere in the agent.
+class X11FrameSource : public FrameSource {
+public:
+    // Captures the root window.
+    static const unsigned long kRootWindow = 0;
+
+    // Opens display (nullptr for $DISPLAY). Check IsOpen() afterwards. A
+    // damage request falls back to polling, with a warning, where XDamage is
+    // not available.
+    X11FrameSource(const char* display, size_t poolSlots, bool damage = false);
+    ~X11FrameSource() override;
+    X11FrameSource(const X11FrameSource&) = delete;
+    X11FrameSource& operator=(const X11FrameSource&) = delete;
+
+    // False if the display could not be opened or cannot be captured with
+    // MIT-SHM; the reason has been logged.
+    bool IsOpen() const;
+
+    // Switches to another window, or back to the root with kRootWindow. Any
+    // thread; takes effect on the next capture. A window is captured as far
+    // as it is on screen, so frames shrink while it is partly off the edge.
+    void SetTarget(unsigned long window) { m_target.store(window); }
+    unsigned long Target() const { return m_target.load(); }
+
+    // Current size of the target, as the next frame will have it.
+    bool QuerySize(int& width, int& height);
+
+    PooledFrame Capture() override;
+
+    bool ReportsDamage() const override;
+    bool WaitForDamage(std::chrono::milliseconds timeout) override;
+    void DamageAll() override;
+    void Wake() override;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> m_impl;
+    std::atomic<unsigned long> m_target{kRootWindow};
+};
+
+// Parses a window id as printed by xwininfo or xdotool (0x1c00007 or decimal).
+bool ParseX11Window(const std::string& text, unsigned long& window);
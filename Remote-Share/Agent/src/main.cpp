@@ -3,16 +3,25 @@
 #include "ImageProcessor.hpp"
 #include "WindowEnumerator.hpp"
 #include "InputInjector.hpp"
+#include "InputThread.hpp"
+#include "ViewerMessage.hpp"
+#include "FramePipeline.hpp"
+#include "Metrics.hpp"
+#include "Trace.hpp"
 
 // Windows version definitions are now set in CMakeLists.txt
 #define WIN32_LEAN_AND_MEAN     // Exclude rarely-used stuff from Windows headers
 
 #include <iostream>
+#include <fstream>
+#include <cstdlib>
 #include <string>
 #include <limits>
 #include <chrono>
 #include <thread>
 #include <vector>
+#include <atomic>
+#include <mutex>
 #include <Windows.h>
 #include <shellscalingapi.h>  // For DPI-related functions
 #include <nlohmann/json.hpp>
@@ -23,6 +32,47 @@
 const std::string DEFAULT_SESSION_ID = "def_pas";
 const std::string DEFAULT_SERVER_HOST = "localhost";
 const std::string SERVER_PORT = "8080";
+const int JPEG_QUALITY = 80;
+
+// Where --trace writes; empty when tracing is off.
+std::string g_tracePath;
+
+// Set while --record is writing; the pipeline is the recorder's only writer.
+FramePipeline* g_pipeline = nullptr;
+FrameRecorder* g_recorder = nullptr;
+
+// Every way out of the agent goes through here. The capture thread is
+// stopped first so the recording ends on a whole frame, then it is flushed
+// and closed. Safe from any thread; later callers wait for the first.
+void FinishRecording() {
+    static std::once_flag once;
+    std::call_once(once, []() {
+        if (!g_recorder || !g_recorder->IsOpen()) {
+            return;
+        }
+        g_pipeline->Stop();
+        g_recorder->Close();
+        std::cout << "Recorded " << g_recorder->FramesWritten() << " frames" << std::endl;
+    });
+}
+
+// Ctrl+Break writes the trace so far and carries on; Ctrl+C and closing the
+// console write it, and finish the recording, on the way out.
+BOOL WINAPI OnConsoleControl(DWORD type) {
+    switch (type) {
+    case CTRL_BREAK_EVENT:
+        Trace::Dump(g_tracePath);
+        return TRUE;
+    case CTRL_C_EVENT:
+    case CTRL_CLOSE_EVENT:
+    case CTRL_SHUTDOWN_EVENT:
+        FinishRecording();
+        Trace::Dump(g_tracePath);
+        return FALSE;
+    default:
+        return FALSE;
+    }
+}
 
 int main(int argc, char* argv[]) {
     // Set process DPI awareness for correct scaling behavior
@@ -36,12 +86,44 @@ int main(int argc, char* argv[]) {
     }
 
     std::string server_host;
-    CaptureManager captureManager;
     HWND selected_hwnd = NULL;
     std::vector<WindowInfo> availableWindows;
 
-    if (argc > 1) {
-        server_host = argv[1];
+    // JSON + base64 frames are kept for older viewers and for debugging.
+    bool text_frames = false;
+    // --encode-threads N caps how many cores JPEG encoding may use.
+    size_t encode_threads = 0;
+    // --stats-file PATH appends a latency table every 10 seconds.
+    std::string stats_file;
+    // --trace PATH records every stage of every frame for chrome://tracing.
+    // --record PATH writes every frame sent to a recording that the headless
+    // agent can replay (--source replay:PATH).
+    std::string record_path;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--text-frames") {
+            text_frames = true;
+        } else if (arg == "--encode-threads" && i + 1 < argc) {
+            int threads = std::atoi(argv[++i]);
+            encode_threads = threads > 0 ? static_cast<size_t>(threads) : 0;
+        } else if (arg == "--stats-file" && i + 1 < argc) {
+            stats_file = argv[++i];
+        } else if (arg == "--trace" && i + 1 < argc) {
+            g_tracePath = argv[++i];
+        } else if (arg == "--record" && i + 1 < argc) {
+            record_path = argv[++i];
+        } else if (server_host.empty()) {
+            server_host = arg;
+        }
+    }
+
+    if (!g_tracePath.empty()) {
+        Trace::Enable();
+        Trace::SetThreadName("main");
+        std::cout << "Tracing to " << g_tracePath << " (Ctrl+Break writes it now, Ctrl+C on exit)" << std::endl;
+    }
+
+    if (!server_host.empty()) {
         std::cout << "Using server host from command line: " << server_host << std::endl;
     } else {
         std::string user_input_host;
@@ -72,7 +154,28 @@ int main(int argc, char* argv[]) {
     std::cout << "Attempting to connect to WebSocket server at: " << server_url << std::endl;
 
     WebSocketClient ws_client(server_url);
-    InputInjector input_injector;
+    CaptureManager capture(FramePipeline::kPoolSlots);
+    InputInjector injector;
+    InputThread input_thread(injector);
+    Metrics metrics;
+
+    PipelineOptions pipeline_options;
+    pipeline_options.jpegQuality = JPEG_QUALITY;
+    pipeline_options.textFrames = text_frames;
+    pipeline_options.encodeThreads = encode_threads;
+    FrameRecorder recorder;
+    if (!record_path.empty() && recorder.Open(record_path, true)) {
+        std::cout << "Recording frames to " << record_path << std::endl;
+    }
+    FramePipeline pipeline(capture, ws_client, metrics, pipeline_options);
+    if (recorder.IsOpen()) {
+        pipeline.SetRecorder(&recorder);
+        g_pipeline = &pipeline;
+        g_recorder = &recorder;
+    }
+    if (!g_tracePath.empty() || recorder.IsOpen()) {
+        SetConsoleCtrlHandler(OnConsoleControl, TRUE);
+    }
 
     ws_client.setOnOpenHandler([]() {
         std::cout << "WebSocket connected to server." << std::endl;
@@ -82,45 +185,39 @@ int main(int argc, char* argv[]) {
         std::cerr << "WebSocket disconnected from server. Attempting reconnect..." << std::endl;
     });
 
-    ws_client.setOnMessageHandler([&input_injector, &selected_hwnd](const std::string& message) {
-        try {
-            auto json_msg = nlohmann::json::parse(message);
-            std::string type = json_msg.value("type", "");
-
-            if (type == "input") {
-                std::string inputType = json_msg.value("inputType", "");
-                if (inputType.rfind("mouse", 0) == 0 || inputType == "click" ||
-                    inputType == "contextmenu" || inputType == "wheel") {
-                    int x = json_msg.value("x", 0);
-                    int y = json_msg.value("y", 0);
-                    int button = json_msg.value("button", -1);
-                    int deltaY = json_msg.value("deltaY", 0);
-                    input_injector.InjectMouseInput(inputType, x, y, button, deltaY);
-                }
-                else if (inputType.rfind("key", 0) == 0) {
-                    std::string key = json_msg.value("key", "");
-                    std::string code = json_msg.value("code", "");
-                    bool ctrlKey = json_msg.value("ctrlKey", false);
-                    bool shiftKey = json_msg.value("shiftKey", false);
-                    bool altKey = json_msg.value("altKey", false);
-                    bool metaKey = json_msg.value("metaKey", false);
-                    input_injector.InjectKeyboardInput(inputType, key, code,
-                                                     ctrlKey, shiftKey, altKey, metaKey);
-                }
-            }
-            else if (type == "close_connection") {
-                std::cout << "Received close connection command from viewer." << std::endl;
-                exit(0);
-            }
-            else if (type == "toggle_fullscreen") {
-                std::cout << "Toggling fullscreen mode." << std::endl;
-                selected_hwnd = NULL;
-            }
-        } catch (const std::exception& e) {
-            std::cerr << "Error handling message: " << e.what() << std::endl;
+    // The last stages of a frame end on the client's thread, once
+    // websocketpp has written its final byte.
+    ws_client.setOnFrameWrittenHandler([&pipeline](const FrameTiming& timing) {
+        pipeline.OnFrameWritten(timing);
+    });
+
+    ws_client.setOnMessageHandler([&input_thread, &pipeline, &capture](const std::string& message) {
+        InputEvent event;
+        switch (ParseViewerMessage(message, event)) {
+        case ViewerCommand::Input:
+            // Injection happens on the input thread; this one goes straight
+            // back to reading the socket.
+            pipeline.NotifyActivity();
+            input_thread.Post(event);
+            break;
+        case ViewerCommand::Keyframe:
+            pipeline.RequestKeyframe();
+            break;
+        case ViewerCommand::Close:
+            std::cout << "Received close connection command from viewer." << std::endl;
+            FinishRecording();
+            exit(0);
+        case ViewerCommand::ToggleFullscreen:
+            std::cout << "Toggling fullscreen mode." << std::endl;
+            capture.SetTarget(NULL);
+            break;
+        case ViewerCommand::None:
+            break;
         }
     });
 
+    input_thread.Start();
+
     try {
         ws_client.connect();
     } catch (const std::exception& e) {
@@ -202,34 +299,65 @@ int main(int argc, char* argv[]) {
                   << " (scaleX: " << scaleX << ", scaleY: " << scaleY << ")" << std::endl;
     }
 
-    while (true) {
-        if (ws_client.isConnected()) {
-            int currentWidth = 0, currentHeight = 0;
-            std::vector<uint8_t> pixel_data = (selected_hwnd == NULL) ?
-                captureManager.CaptureFullScreen(currentWidth, currentHeight) :
-                captureManager.CaptureWindow(selected_hwnd, currentWidth, currentHeight);
-
-            if (!pixel_data.empty() && currentWidth > 0 && currentHeight > 0) {
-                std::vector<uint8_t> jpeg_data = ImageProcessor::CompressToJpeg(
-                    pixel_data, currentWidth, currentHeight, 80);
-                if (!jpeg_data.empty()) {
-                    std::string base64_image = ImageProcessor::EncodeToBase64(jpeg_data);
-                    nlohmann::json frame_msg = {
-                        {"type", "frame"},
-                        {"image", "data:image/jpeg;base64," + base64_image},
-                        {"width", currentWidth},
-                        {"height", currentHeight}
-                    };
-                    ws_client.send(frame_msg.dump());
-                }
+    capture.SetTarget(selected_hwnd);
+    pipeline.Start();
+
+    // Capture, encode and send run on the pipeline's threads; this one only
+    // reports how they are keeping up. Viewers get a stats message every
+    // couple of seconds; the console only hears about trouble.
+    const PipelineStats& pipeline_stats = pipeline.Stats();
+    const InputStats& input_stats = input_thread.Stats();
+    const int kStatsIntervalSec = 2;
+    const int kConsoleIntervalSec = 10;
+    MetricsReport report;
+    for (int tick = 1; ; ++tick) {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        if (tick % kStatsIntervalSec == 0) {
+            MetricsCounters counters;
+            pipeline.FillCounters(counters);
+            metrics.TakeReport(counters, report);
+            if (ws_client.isConnected()) {
+                ws_client.send(report.ToJson());
             }
-        } else {
-            std::cerr << "WebSocket disconnected. Attempting to reconnect..." << std::endl;
-            std::this_thread::sleep_for(std::chrono::seconds(2));
         }
-        std::this_thread::sleep_for(std::chrono::milliseconds(33));
+        if (tick % kConsoleIntervalSec != 0) {
+            continue;
+        }
+
+        if (!stats_file.empty()) {
+            std::ofstream out(stats_file, std::ios::app);
+            if (out) {
+                out << report.ToText() << std::endl;
+            }
+        }
+        SendStats stats = ws_client.getSendStats();
+        FrameClockStats clock = pipeline.ClockStats();
+        uint64_t deferred = pipeline_stats.capturesDeferred.load();
+        if (deferred > 0) {
+            std::cout << "Pipeline: " << pipeline_stats.framesCaptured.load() << " captured, "
+                      << pipeline_stats.framesEncoded.load() << " encoded, "
+                      << stats.framesSent << " sent, "
+                      << deferred << " captures deferred, peak "
+                      << stats.peakBufferedBytes / 1024 << " KB buffered" << std::endl;
+        }
+        if (clock.overruns > 0) {
+            std::cout << "Frame clock: " << pipeline.CaptureRate() << " fps, "
+                      << clock.overruns << " overruns, " << clock.missedTicks << " ticks skipped, jitter "
+                      << clock.jitterMeanUs << " us mean / " << clock.jitterMaxUs << " us max" << std::endl;
+        }
+        if (input_stats.movesDropped.load() > 0) {
+            std::cout << "Input: " << input_stats.eventsPosted.load() << " events in "
+                      << input_stats.batchesInjected.load() << " batches, "
+                      << input_stats.movesCoalesced.load() << " moves coalesced, "
+                      << input_stats.movesDropped.load() << " dropped" << std::endl;
+        }
     }
 
+    input_thread.Stop();
+    FinishRecording();
+    if (!g_tracePath.empty()) {
+        Trace::Dump(g_tracePath);
+    }
     ImageProcessor::ShutdownCompressor();
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,199 @@
+// Base64::Encode, every kernel this CPU has, against the encoder it replaced:
+// every length up to a few kilobytes, random buffers up to a megabyte, every
+// input alignment, and a decode back to the input.
+#include "Base64.hpp"
+#include "Check.hpp"
+#include "ReferenceBase64.hpp"
+
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char* const kKernels[] = {"scalar", "ssse3", "avx2"};
+const size_t kExhaustiveLength = 4096;
+
+bool Decode(const std::string& text, std::vector<uint8_t>& out) {
+    static const std::string alphabet =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    out.clear();
+    if (text.size() % 4 != 0) {
+        return false;
+    }
+    for (size_t i = 0; i < text.size(); i += 4) {
+        uint32_t v = 0;
+        int pad = 0;
+        for (size_t j = 0; j < 4; ++j) {
+            char c = text[i + j];
+            size_t index = 0;
+            if (c == '=' && i + 4 == text.size() && j >= 2) {
+                ++pad;
+            } else if (pad > 0 || (index = alphabet.find(c)) == std::string::npos) {
+                return false;
+            }
+            v = (v << 6) | static_cast<uint32_t>(index);
+        }
+        out.push_back(static_cast<uint8_t>(v >> 16));
+        if (pad < 2) {
+            out.push_back(static_cast<uint8_t>(v >> 8));
+        }
+        if (pad < 1) {
+            out.push_back(static_cast<uint8_t>(v));
+        }
+    }
+    return true;
+}
+
+// Input that ends right before an unreadable page where the OS allows it, so
+// a kernel that reads past the end crashes the test instead of passing.
+class GuardedInput {
+public:
+    explicit GuardedInput(size_t capacity) {
+#ifndef _WIN32
+        m_page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        m_mapped = (capacity + m_page - 1) / m_page * m_page + m_page;
+        void* base = mmap(nullptr, m_mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base != MAP_FAILED) {
+            m_base = static_cast<uint8_t*>(base);
+            mprotect(m_base + m_mapped - m_page, m_page, PROT_NONE);
+            m_end = m_base + m_mapped - m_page;
+            return;
+        }
+#endif
+        m_fallback.resize(capacity);
+        m_end = m_fallback.data() + capacity;
+    }
+
+    ~GuardedInput() {
+#ifndef _WIN32
+        if (m_base) {
+            munmap(m_base, m_mapped);
+        }
+#endif
+    }
+
+    // Copies bytes so they end at the guard page.
+    const uint8_t* Place(const std::vector<uint8_t>& bytes) {
+        uint8_t* start = m_end - bytes.size();
+        if (!bytes.empty()) {
+            std::memcpy(start, bytes.data(), bytes.size());
+        }
+        return start;
+    }
+
+private:
+    uint8_t* m_base = nullptr;
+    uint8_t* m_end = nullptr;
+    size_t m_page = 0;
+    size_t m_mapped = 0;
+    std::vector<uint8_t> m_fallback;
+};
+
+// Encodes with kernel, checking against the reference and for writes past
+// EncodedSize. Returns false once a mismatch was reported, to keep the
+// output short.
+bool CheckEncode(const char* kernel, const uint8_t* in, const std::vector<uint8_t>& bytes,
+                 const std::string& expected) {
+    const size_t kGuard = 64;
+    std::string out(Base64::EncodedSize(bytes.size()) + kGuard, '#');
+    if (!Base64::EncodeWithKernel(kernel, in, bytes.size(), &out[0])) {
+        return true;  // not on this CPU
+    }
+    bool ok = out.compare(0, expected.size(), expected) == 0 &&
+              out.find_first_not_of('#', expected.size()) == std::string::npos;
+    if (!ok) {
+        std::fprintf(stderr, "%s kernel, %zu bytes:\n", kernel, bytes.size());
+        CHECK(out.compare(0, expected.size(), expected) == 0);
+        CHECK(out.find_first_not_of('#', expected.size()) == std::string::npos);
+    }
+    return ok;
+}
+
+void TestEveryLength() {
+    std::mt19937 rng(1);
+    GuardedInput input(kExhaustiveLength);
+    std::vector<uint8_t> bytes;
+    for (size_t length = 0; length <= kExhaustiveLength; ++length) {
+        bytes.resize(length);
+        for (uint8_t& b : bytes) {
+            b = static_cast<uint8_t>(rng());
+        }
+        std::string expected = ReferenceBase64Encode(bytes);
+        CHECK_EQ(expected.size(), Base64::EncodedSize(length));
+        const uint8_t* in = input.Place(bytes);
+        for (const char* kernel : kKernels) {
+            if (!CheckEncode(kernel, in, bytes, expected)) {
+                return;
+            }
+        }
+
+        std::string encoded(Base64::EncodedSize(length), '\0');
+        Base64::Encode(in, length, &encoded[0]);
+        std::vector<uint8_t> decoded;
+        CHECK(Decode(encoded, decoded));
+        CHECK(decoded == bytes);
+    }
+}
+
+void TestEveryByteValue() {
+    // Each sextet value in each position of a group.
+    std::vector<uint8_t> bytes;
+    for (int i = 0; i < 3 * 256; ++i) {
+        bytes.push_back(static_cast<uint8_t>(i / 3 + (i % 3) * 85));
+    }
+    std::string expected = ReferenceBase64Encode(bytes);
+    for (const char* kernel : kKernels) {
+        CheckEncode(kernel, bytes.data(), bytes, expected);
+    }
+}
+
+void TestAlignments() {
+    std::mt19937 rng(2);
+    std::vector<uint8_t> storage(1024 + 64);
+    for (uint8_t& b : storage) {
+        b = static_cast<uint8_t>(rng());
+    }
+    for (size_t offset = 0; offset < 64; ++offset) {
+        std::vector<uint8_t> bytes(storage.begin() + offset, storage.begin() + offset + 1000);
+        std::string expected = ReferenceBase64Encode(bytes);
+        for (const char* kernel : kKernels) {
+            CheckEncode(kernel, storage.data() + offset, bytes, expected);
+        }
+    }
+}
+
+void TestRandomBuffers() {
+    std::mt19937 rng(3);
+    const size_t kMaxLength = 1 << 20;
+    GuardedInput input(kMaxLength);
+    for (int i = 0; i < 40; ++i) {
+        std::vector<uint8_t> bytes(rng() % kMaxLength);
+        for (uint8_t& b : bytes) {
+            b = static_cast<uint8_t>(rng());
+        }
+        std::string expected = ReferenceBase64Encode(bytes);
+        const uint8_t* in = input.Place(bytes);
+        for (const char* kernel : kKernels) {
+            if (!CheckEncode(kernel, in, bytes, expected)) {
+                return;
+            }
+        }
+    }
+}
+
+} // namespace
+
+int main() {
+    std::printf("Base64 kernel: %s\n", Base64::KernelName());
+    TestEveryLength();
+    TestEveryByteValue();
+    TestAlignments();
+    TestRandomBuffers();
+    return TestResult();
+}
@@ -0,0 +1,284 @@
+// FramePool and CaptureSession against a fake surface: buffers are reused at
+// a steady size, rebuilt on a resize, never handed out twice, and a lease
+// stays valid across a reconfigure.
+#include "CaptureSession.hpp"
+#include "Check.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// What the fake surface reports and how often it was asked to do things.
+// Owned by the test, since the session owns the surface.
+struct FakeScreen {
+    int width = 64;
+    int height = 32;
+    bool present = true;
+    bool failGrab = false;
+    uint8_t fill = 1;  // value of every byte of the next grab
+    int rebuilds = 0;
+    int grabs = 0;
+};
+
+class FakeSurface : public CaptureSurface {
+public:
+    explicit FakeSurface(FakeScreen& screen) : m_screen(screen) {}
+
+    bool QueryGeometry(int& width, int& height) override {
+        width = m_screen.width;
+        height = m_screen.height;
+        return m_screen.present;
+    }
+
+    bool Rebuild(int width, int height) override {
+        ++m_screen.rebuilds;
+        m_width = width;
+        m_height = height;
+        return true;
+    }
+
+    bool Grab(uint8_t* dst, int stride) override {
+        ++m_screen.grabs;
+        if (m_screen.failGrab) {
+            return false;
+        }
+        for (int y = 0; y < m_height; ++y) {
+            std::fill(dst + static_cast<size_t>(y) * stride, dst + static_cast<size_t>(y) * stride + m_width * 3,
+                      m_screen.fill);
+        }
+        return true;
+    }
+
+    PixelFormat Format() const override { return PixelFormat::BGR24; }
+
+private:
+    FakeScreen& m_screen;
+    int m_width = 0;
+    int m_height = 0;
+};
+
+CaptureSession MakeSession(FakeScreen& screen, size_t slots = 3) {
+    return CaptureSession(std::unique_ptr<CaptureSurface>(new FakeSurface(screen)), slots);
+}
+
+bool AllBytes(const PooledFrame& frame, uint8_t value) {
+    for (int y = 0; y < frame.Height(); ++y) {
+        const uint8_t* row = frame.Data() + static_cast<size_t>(y) * frame.Stride();
+        for (int x = 0; x < frame.Width() * 3; ++x) {
+            if (row[x] != value) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void TestSteadyGeometryReuses() {
+    FakeScreen screen;
+    CaptureSession session = MakeSession(screen);
+    for (int i = 0; i < 100; ++i) {
+        PooledFrame frame = session.Capture();
+        CHECK(frame);
+        CHECK_EQ(frame.Width(), 64);
+        CHECK_EQ(frame.Height(), 32);
+        CHECK_EQ(frame.Stride(), 192);
+        CHECK(frame.TimestampUs() != 0);
+    }
+    CHECK_EQ(session.RebuildCount(), 1u);
+    CHECK_EQ(screen.rebuilds, 1);
+    // Released leases go back to the top of the free list, so one slot
+    // serves every frame.
+    CHECK_EQ(session.Pool().AllocationCount(), 1u);
+
+    // Holding frames spreads them over every slot, once each.
+    {
+        PooledFrame a = session.Capture();
+        PooledFrame b = session.Capture();
+        PooledFrame c = session.Capture();
+        CHECK(a && b && c);
+        CHECK(a.Data() != b.Data() && b.Data() != c.Data() && a.Data() != c.Data());
+    }
+    uint64_t allocations = session.Pool().AllocationCount();
+    CHECK_EQ(allocations, 3u);
+    for (int i = 0; i < 100; ++i) {
+        PooledFrame a = session.Capture();
+        PooledFrame b = session.Capture();
+        CHECK(a && b);
+    }
+    CHECK_EQ(session.Pool().AllocationCount(), allocations);
+}
+
+void TestGeometryChangeRebuilds() {
+    FakeScreen screen;
+    CaptureSession session = MakeSession(screen);
+    CHECK(session.Capture());
+
+    screen.width = 101;  // odd width: rows are padded to 4 bytes
+    screen.height = 40;
+    PooledFrame frame = session.Capture();
+    CHECK(frame);
+    CHECK_EQ(frame.Width(), 101);
+    CHECK_EQ(frame.Height(), 40);
+    CHECK_EQ(frame.Stride(), 304);
+    CHECK_EQ(session.RebuildCount(), 2u);
+    CHECK_EQ(screen.rebuilds, 2);
+
+    // Same size again: no rebuild.
+    frame.Release();
+    CHECK(session.Capture());
+    CHECK_EQ(session.RebuildCount(), 2u);
+
+    // A failed grab drops the frame and rebuilds on the next one.
+    screen.failGrab = true;
+    CHECK(!session.Capture());
+    CHECK_EQ(session.Pool().FreeCount(), 3u);
+    screen.failGrab = false;
+    CHECK(session.Capture());
+    CHECK_EQ(session.RebuildCount(), 3u);
+
+    // A source that is gone gives nothing and grabs nothing.
+    screen.present = false;
+    int grabs = screen.grabs;
+    CHECK(!session.Capture());
+    CHECK_EQ(screen.grabs, grabs);
+}
+
+void TestExhaustedPool() {
+    FakeScreen screen;
+    CaptureSession session = MakeSession(screen, 2);
+    PooledFrame a = session.Capture();
+    PooledFrame b = session.Capture();
+    CHECK(a && b);
+    CHECK_EQ(session.Pool().FreeCount(), 0u);
+
+    int grabs = screen.grabs;
+    PooledFrame c = session.Capture();
+    CHECK(!c);
+    CHECK_EQ(screen.grabs, grabs);  // nothing to grab into
+
+    // Returning a slot, by release or by moving over the lease, frees it.
+    const uint8_t* released = a.Data();
+    a.Release();
+    CHECK(!a);
+    CHECK_EQ(session.Pool().FreeCount(), 1u);
+    c = session.Capture();
+    CHECK(c);
+    CHECK(c.Data() == released);
+    b = std::move(c);
+    CHECK(!c);
+    CHECK_EQ(session.Pool().FreeCount(), 1u);
+    b = PooledFrame();
+    CHECK_EQ(session.Pool().FreeCount(), 2u);
+}
+
+void TestLeaseOutlivesReconfigure() {
+    FakeScreen screen;
+    CaptureSession session = MakeSession(screen);
+    screen.fill = 7;
+    PooledFrame old = session.Capture();
+    CHECK(old);
+    const uint8_t* oldData = old.Data();
+
+    screen.width = 128;
+    screen.height = 64;
+    screen.fill = 9;
+    PooledFrame current = session.Capture();
+    CHECK(current);
+    CHECK_EQ(current.Width(), 128);
+
+    // The old lease keeps its geometry and pixels until it goes back.
+    CHECK_EQ(old.Width(), 64);
+    CHECK_EQ(old.Height(), 32);
+    CHECK_EQ(old.Stride(), 192);
+    CHECK(old.Data() == oldData);
+    CHECK(AllBytes(old, 7));
+    CHECK(AllBytes(current, 9));
+
+    // Switching surfaces keeps the pool, so leases survive that too.
+    session.SetSurface(std::unique_ptr<CaptureSurface>(new FakeSurface(screen)));
+    PooledFrame next = session.Capture();
+    CHECK(next);
+    CHECK(AllBytes(old, 7));
+    CHECK(AllBytes(current, 9));
+
+    // Once back, the slot is resized for the new geometry.
+    old.Release();
+    current.Release();
+    next.Release();
+    for (int i = 0; i < 3; ++i) {
+        PooledFrame frame = session.Capture();
+        CHECK(frame);
+        CHECK_EQ(frame.Width(), 128);
+        CHECK_EQ(frame.Height(), 64);
+        CHECK(AllBytes(frame, 9));
+    }
+}
+
+// Counts what the pool asks of its allocator.
+class CountingAllocator : public FrameAllocator {
+public:
+    uint8_t* Allocate(size_t bytes) override {
+        if (fail) {
+            return nullptr;
+        }
+        ++allocations;
+        live += bytes;
+        return new uint8_t[bytes];
+    }
+
+    void Free(uint8_t* data, size_t bytes) override {
+        ++frees;
+        live -= bytes;
+        delete[] data;
+    }
+
+    bool fail = false;
+    int allocations = 0;
+    int frees = 0;
+    size_t live = 0;
+};
+
+void TestAllocator() {
+    CountingAllocator allocator;
+    {
+        FramePool pool(2, &allocator);
+        pool.Configure(16, 16, 48, PixelFormat::BGR24);
+        for (int i = 0; i < 10; ++i) {
+            CHECK(pool.Acquire());
+        }
+        CHECK_EQ(allocator.allocations, 1);
+
+        // Shrinking reuses the bigger buffer; growing replaces it.
+        pool.Configure(8, 8, 24, PixelFormat::BGR24);
+        CHECK(pool.Acquire());
+        CHECK_EQ(allocator.allocations, 1);
+        pool.Configure(32, 32, 96, PixelFormat::BGR24);
+        CHECK(pool.Acquire());
+        CHECK_EQ(allocator.allocations, 2);
+        CHECK_EQ(allocator.frees, 1);
+
+        // A failed allocation gives an empty lease and keeps the slot.
+        allocator.fail = true;
+        pool.Configure(64, 64, 192, PixelFormat::BGR24);
+        CHECK(!pool.Acquire());
+        CHECK_EQ(pool.FreeCount(), 2u);
+        allocator.fail = false;
+        CHECK(pool.Acquire());
+    }
+    CHECK_EQ(allocator.allocations, allocator.frees);
+    CHECK_EQ(allocator.live, 0u);
+}
+
+} // namespace
+
+int main() {
+    TestSteadyGeometryReuses();
+    TestGeometryChangeRebuilds();
+    TestExhaustedPool();
+    TestLeaseOutlivesReconfigure();
+    TestAllocator();
+    return TestResult();
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdio>
+#include <cstdlib>
+
+// Just enough of a test framework for the core's tests: each test is its own
+// executable whose main() calls the cases and returns TestResult(). CHECK and
+// CHECK_EQ report a failure with its location and carry on, so one run shows
+// every broken case.
+namespace TestDetail {
+
+inline int& Failures() {
+    static int failures = 0;
+    return failures;
+}
+
+inline void Fail(const char* file, int line, const char* expression) {
+    std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", file, line, expression);
+    ++Failures();
+}
+
+} // namespace TestDetail
+
+#define CHECK(condition)                                                \
+    do {                                                                \
+        if (!(condition)) {                                             \
+            TestDetail::Fail(__FILE__, __LINE__, #condition);           \
+        }                                                               \
+    } while (0)
+
+#define CHECK_EQ(actual, expected) CHECK((actual) == (expected))
+
+// Exit code for main(): 0 if every CHECK held.
+inline int TestResult() {
+    if (TestDetail::Failures() != 0) {
+        std::fprintf(stderr, "%d check(s) failed\n", TestDetail::Failures());
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,142 @@
+// FrameClock: ticks land on absolute deadlines, a late tick skips the ones it
+// missed rather than firing them in a burst, and Wake() and a faster SetRate
+// end a wait early. Timing bounds are one-sided or loose so a busy machine
+// does not fail them.
+#include "Check.hpp"
+#include "FrameClock.hpp"
+
+#include <chrono>
+#include <thread>
+
+namespace {
+
+typedef FrameClock::Clock Clock;
+
+double MsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+void SleepMs(int ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+// Work between ticks does not push the next one back: tick k is never before
+// k periods from the first, and the total is periods, not periods plus work.
+void TestAbsoluteDeadlines() {
+    FrameClock clock(100.0);
+    CHECK_EQ(clock.WaitNextTick(), 0);  // the first tick is immediate
+    Clock::time_point start = Clock::now();
+    const int ticks = 20;
+    for (int k = 1; k <= ticks; ++k) {
+        SleepMs(4);
+        clock.WaitNextTick();
+        CHECK(MsSince(start) >= k * 10.0 - 1.0);
+    }
+    // Paced from the end of each piece of work this would be 280 ms.
+    CHECK(MsSince(start) < 260.0);
+    CHECK_EQ(clock.Stats().ticks, static_cast<uint64_t>(ticks + 1));
+}
+
+// A caller 75 ms late on a 20 ms clock gets one tick at once, two skipped,
+// and the next tick back on the original grid rather than straight after.
+void TestLateTickSkips() {
+    FrameClock clock(50.0);
+    clock.WaitNextTick();
+    Clock::time_point start = Clock::now();
+    SleepMs(75);
+
+    Clock::time_point late = Clock::now();
+    int skipped = clock.WaitNextTick();
+    CHECK(MsSince(late) < 10.0);
+    CHECK(skipped >= 2);
+    FrameClockStats stats = clock.Stats();
+    CHECK_EQ(stats.overruns, 1u);
+    CHECK_EQ(stats.missedTicks, static_cast<uint64_t>(skipped));
+
+    // No burst: the next tick waits for the grid point after the late one.
+    double grid = 20.0 * (skipped + 2);
+    CHECK_EQ(clock.WaitNextTick(), 0);
+    CHECK(MsSince(start) >= grid - 1.0);
+    CHECK_EQ(clock.WaitNextTick(), 0);
+    CHECK(MsSince(start) >= grid + 20.0 - 1.0);
+    CHECK_EQ(clock.Stats().overruns, 1u);
+}
+
+void TestWake() {
+    FrameClock clock(0.5);
+    clock.WaitNextTick();
+
+    // Ends a 2 s wait in progress.
+    std::thread waker([&clock]() {
+        SleepMs(50);
+        clock.Wake();
+    });
+    Clock::time_point start = Clock::now();
+    CHECK_EQ(clock.WaitNextTick(), 0);
+    double waited = MsSince(start);
+    waker.join();
+    CHECK(waited >= 40.0);
+    CHECK(waited < 1000.0);
+
+    // A wake with nobody waiting makes the next wait return at once.
+    clock.Wake();
+    start = Clock::now();
+    CHECK_EQ(clock.WaitNextTick(), 0);
+    CHECK(MsSince(start) < 500.0);
+
+    // And is used up: the wait after that is a full period again.
+    std::thread stopper([&clock]() {
+        SleepMs(200);
+        clock.Wake();
+    });
+    start = Clock::now();
+    clock.WaitNextTick();
+    CHECK(MsSince(start) >= 150.0);
+    stopper.join();
+    CHECK_EQ(clock.Stats().overruns, 0u);
+}
+
+void TestFasterRate() {
+    FrameClock clock(0.5);
+    clock.WaitNextTick();
+
+    // A faster rate ends a 2 s wait at the new period, and the time already
+    // waited is not counted as an overrun.
+    std::thread changer([&clock]() {
+        SleepMs(50);
+        clock.SetRate(100.0);
+    });
+    Clock::time_point start = Clock::now();
+    CHECK_EQ(clock.WaitNextTick(), 0);
+    double waited = MsSince(start);
+    changer.join();
+    CHECK(waited >= 40.0);
+    CHECK(waited < 1000.0);
+    CHECK(clock.Rate() > 99.0 && clock.Rate() < 101.0);
+    CHECK_EQ(clock.Stats().overruns, 0u);
+
+    // Ticks then come at the new rate.
+    start = Clock::now();
+    for (int i = 0; i < 5; ++i) {
+        clock.WaitNextTick();
+    }
+    CHECK(MsSince(start) >= 40.0);
+    CHECK(MsSince(start) < 1000.0);
+
+    // A slower rate does not end a wait early: it applies from the current
+    // deadline on.
+    clock.SetRate(5.0);
+    start = Clock::now();
+    clock.WaitNextTick();
+    CHECK(MsSince(start) >= 150.0);
+}
+
+} // namespace
+
+int main() {
+    TestAbsoluteDeadlines();
+    TestLateTickSkips();
+    TestWake();
+    TestFasterRate();
+    return TestResult();
+}
@@ -0,0 +1,131 @@
+// FrameDiffer: which tiles come back dirty and how they are merged into
+// rectangles.
+#include "Check.hpp"
+#include "FrameDiffer.hpp"
+
+#include <vector>
+
+namespace {
+
+const int kTile = 16;
+
+struct TestFrame {
+    TestFrame(int w, int h) : width(w), height(h), stride(((w * 3 + 3) / 4) * 4), pixels(stride * h, 0) {}
+
+    FrameView View() const {
+        FrameView view;
+        view.data = pixels.data();
+        view.width = width;
+        view.height = height;
+        view.stride = stride;
+        view.format = PixelFormat::BGR24;
+        return view;
+    }
+
+    void Touch(int x, int y) { pixels[static_cast<size_t>(y) * stride + static_cast<size_t>(x) * 3] ^= 0xFF; }
+    void TouchTile(int tx, int ty) { Touch(tx * kTile + kTile / 2, ty * kTile + kTile / 2); }
+
+    int width;
+    int height;
+    int stride;
+    std::vector<uint8_t> pixels;
+};
+
+bool Has(const std::vector<FrameRect>& rects, int x, int y, int w, int h) {
+    for (const FrameRect& rect : rects) {
+        if (rect.x == x && rect.y == y && rect.width == w && rect.height == h) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void TestFirstFrameAndStatic() {
+    TestFrame frame(100, 50);  // 7x4 tiles, the last column and row partial
+    FrameDiffer differ(kTile);
+    std::vector<FrameRect> rects;
+    CHECK_EQ(differ.Diff(frame.View(), rects), 28u);
+    CHECK_EQ(rects.size(), 1u);
+    CHECK(Has(rects, 0, 0, 100, 50));
+
+    CHECK_EQ(differ.Diff(frame.View(), rects), 0u);
+    CHECK(rects.empty());
+
+    differ.Reset();
+    CHECK_EQ(differ.Diff(frame.View(), rects), 28u);
+}
+
+void TestMerging() {
+    TestFrame frame(128, 128);  // 8x8 tiles
+    FrameDiffer differ(kTile);
+    std::vector<FrameRect> rects;
+    differ.Diff(frame.View(), rects);
+
+    // A 2x3 block, a single tile, and a run that widens below itself.
+    for (int ty = 1; ty <= 3; ++ty) {
+        frame.TouchTile(1, ty);
+        frame.TouchTile(2, ty);
+    }
+    frame.TouchTile(6, 0);
+    frame.TouchTile(5, 5);
+    frame.TouchTile(5, 6);
+    frame.TouchTile(6, 6);
+    CHECK_EQ(differ.Diff(frame.View(), rects), 10u);
+    CHECK_EQ(rects.size(), 4u);
+    CHECK(Has(rects, 16, 16, 32, 48));
+    CHECK(Has(rects, 96, 0, 16, 16));
+    CHECK(Has(rects, 80, 80, 16, 16));
+    CHECK(Has(rects, 80, 96, 32, 16));
+    CHECK(differ.IsTileDirty(6, 0));
+    CHECK(!differ.IsTileDirty(0, 0));
+
+    // Only the changed tiles went into the reference.
+    CHECK_EQ(differ.Diff(frame.View(), rects), 0u);
+}
+
+void TestCheckerboard() {
+    // Nothing merges: every dirty tile is its own rect, in band order.
+    TestFrame frame(128, 64);
+    FrameDiffer differ(kTile);
+    std::vector<FrameRect> rects;
+    differ.Diff(frame.View(), rects);
+    for (int ty = 0; ty < 4; ++ty) {
+        for (int tx = ty & 1; tx < 8; tx += 2) {
+            frame.TouchTile(tx, ty);
+        }
+    }
+    CHECK_EQ(differ.Diff(frame.View(), rects), 16u);
+    CHECK_EQ(rects.size(), 16u);
+    for (size_t i = 1; i < rects.size(); ++i) {
+        CHECK(rects[i - 1].y < rects[i].y || (rects[i - 1].y == rects[i].y && rects[i - 1].x < rects[i].x));
+    }
+}
+
+void TestColumns() {
+    // Full-height columns merge down through every band.
+    TestFrame frame(128, 128);
+    FrameDiffer differ(kTile);
+    std::vector<FrameRect> rects;
+    differ.Diff(frame.View(), rects);
+    for (int ty = 0; ty < 8; ++ty) {
+        frame.TouchTile(0, ty);
+        frame.TouchTile(3, ty);
+        frame.TouchTile(4, ty);
+        frame.TouchTile(7, ty);
+    }
+    CHECK_EQ(differ.Diff(frame.View(), rects), 32u);
+    CHECK_EQ(rects.size(), 3u);
+    CHECK(Has(rects, 0, 0, 16, 128));
+    CHECK(Has(rects, 48, 0, 32, 128));
+    CHECK(Has(rects, 112, 0, 16, 128));
+}
+
+} // namespace
+
+int main() {
+    TestFirstFrameAndStatic();
+    TestMerging();
+    TestCheckerboard();
+    TestColumns();
+    return TestResult();
+}
@@ -0,0 +1,149 @@
+// FrameProtocol: the header writers put every field at the offset and in the
+// byte order the viewer reads it from (handleBinaryFrame and handleFrameChunk
+// in Web/script.js), and write nothing past the header.
+#include "Check.hpp"
+#include "FrameProtocol.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+using namespace FrameProtocol;
+
+const uint8_t kCanary = 0xCD;
+
+// Little-endian reads, as DataView.getUintN(offset, true) does them.
+uint32_t GetU8(const std::vector<uint8_t>& bytes, size_t offset) {
+    return bytes[offset];
+}
+
+uint32_t GetU16(const std::vector<uint8_t>& bytes, size_t offset) {
+    return static_cast<uint32_t>(bytes[offset]) | static_cast<uint32_t>(bytes[offset + 1]) << 8;
+}
+
+uint32_t GetU32(const std::vector<uint8_t>& bytes, size_t offset) {
+    return GetU16(bytes, offset) | GetU16(bytes, offset + 2) << 16;
+}
+
+uint64_t GetU64(const std::vector<uint8_t>& bytes, size_t offset) {
+    return static_cast<uint64_t>(GetU32(bytes, offset)) | static_cast<uint64_t>(GetU32(bytes, offset + 4)) << 32;
+}
+
+// A header's worth of canary bytes and then some, so an overrun shows.
+std::vector<uint8_t> Buffer(size_t headerSize) {
+    return std::vector<uint8_t>(headerSize + 8, kCanary);
+}
+
+void CheckUntouchedAfter(const std::vector<uint8_t>& bytes, size_t headerSize) {
+    for (size_t i = headerSize; i < bytes.size(); ++i) {
+        CHECK_EQ(bytes[i], kCanary);
+    }
+}
+
+// The numbers the viewer has hard-coded.
+void TestConstants() {
+    CHECK_EQ(kVersion, 1);
+    CHECK_EQ(kFrameHeaderSize, 24u);
+    CHECK_EQ(kRectHeaderSize, 12u);
+    CHECK_EQ(kChunkHeaderSize, 16u);
+    CHECK_EQ(static_cast<int>(MessageType::Keyframe), 1);
+    CHECK_EQ(static_cast<int>(MessageType::DeltaFrame), 2);
+    CHECK_EQ(static_cast<int>(MessageType::FrameChunk), 3);
+    CHECK_EQ(static_cast<int>(MessageType::Input), 4);
+    CHECK_EQ(static_cast<int>(Codec::Jpeg), 1);
+}
+
+void TestFrameHeader() {
+    // Every byte of every multi-byte field differs, so a swapped or shifted
+    // byte cannot go unnoticed.
+    FrameHeader header;
+    header.type = MessageType::DeltaFrame;
+    header.codec = Codec::Jpeg;
+    header.seq = 0x04030201u;
+    header.timestampUs = 0x1817161514131211ull;
+    header.frameWidth = 0x2221;
+    header.frameHeight = 0x2423;
+    header.rectCount = 0x2625;
+    std::vector<uint8_t> bytes = Buffer(kFrameHeaderSize);
+    WriteFrameHeader(header, bytes.data());
+
+    CHECK_EQ(GetU8(bytes, 0), kVersion);
+    CHECK_EQ(GetU8(bytes, 1), 2u);
+    CHECK_EQ(GetU8(bytes, 2), 1u);
+    CHECK_EQ(GetU8(bytes, 3), 0u);
+    CHECK_EQ(GetU32(bytes, 4), 0x04030201u);
+    CHECK_EQ(GetU64(bytes, 8), 0x1817161514131211ull);
+    CHECK_EQ(GetU16(bytes, 16), 0x2221u);
+    CHECK_EQ(GetU16(bytes, 18), 0x2423u);
+    CHECK_EQ(GetU16(bytes, 20), 0x2625u);
+    CHECK_EQ(GetU16(bytes, 22), 0u);
+    CHECK_EQ(bytes[4], 0x01);
+    CHECK_EQ(bytes[7], 0x04);
+    CheckUntouchedAfter(bytes, kFrameHeaderSize);
+
+    header.type = MessageType::Keyframe;
+    WriteFrameHeader(header, bytes.data());
+    CHECK_EQ(GetU8(bytes, 1), 1u);
+}
+
+void TestRectHeader() {
+    RectHeader header;
+    header.x = 0x0201;
+    header.y = 0x0403;
+    header.width = 0x0605;
+    header.height = 0x0807;
+    header.payloadSize = 0x0C0B0A09u;
+    std::vector<uint8_t> bytes = Buffer(kRectHeaderSize);
+    WriteRectHeader(header, bytes.data());
+
+    CHECK_EQ(GetU16(bytes, 0), 0x0201u);
+    CHECK_EQ(GetU16(bytes, 2), 0x0403u);
+    CHECK_EQ(GetU16(bytes, 4), 0x0605u);
+    CHECK_EQ(GetU16(bytes, 6), 0x0807u);
+    CHECK_EQ(GetU32(bytes, 8), 0x0C0B0A09u);
+    // Byte by byte, the whole header is its fields in order.
+    for (size_t i = 0; i < kRectHeaderSize; ++i) {
+        CHECK_EQ(bytes[i], static_cast<uint8_t>(i + 1));
+    }
+    CheckUntouchedAfter(bytes, kRectHeaderSize);
+}
+
+void TestChunkHeader() {
+    ChunkHeader header;
+    header.streamId = 0x08070605u;
+    header.offset = 0x0C0B0A09u;
+    header.totalSize = 0x100F0E0Du;
+    std::vector<uint8_t> bytes = Buffer(kChunkHeaderSize);
+    WriteChunkHeader(header, bytes.data());
+
+    // The viewer tells a chunk from a frame by bytes 0 and 1 alone.
+    CHECK_EQ(GetU8(bytes, 0), kVersion);
+    CHECK_EQ(GetU8(bytes, 1), 3u);
+    CHECK_EQ(GetU16(bytes, 2), 0u);
+    CHECK_EQ(GetU32(bytes, 4), 0x08070605u);
+    CHECK_EQ(GetU32(bytes, 8), 0x0C0B0A09u);
+    CHECK_EQ(GetU32(bytes, 12), 0x100F0E0Du);
+    for (size_t i = 4; i < kChunkHeaderSize; ++i) {
+        CHECK_EQ(bytes[i], static_cast<uint8_t>(i + 1));
+    }
+    CheckUntouchedAfter(bytes, kChunkHeaderSize);
+
+    header.streamId = 0xFFFFFFFFu;
+    header.offset = 0;
+    header.totalSize = 0x80000000u;
+    WriteChunkHeader(header, bytes.data());
+    CHECK_EQ(GetU32(bytes, 4), 0xFFFFFFFFu);
+    CHECK_EQ(GetU32(bytes, 8), 0u);
+    CHECK_EQ(GetU32(bytes, 12), 0x80000000u);
+}
+
+} // namespace
+
+int main() {
+    TestConstants();
+    TestFrameHeader();
+    TestRectHeader();
+    TestChunkHeader();
+    return TestResult();
+}
@@ -0,0 +1,152 @@
+// FrameRecorder and RecordingReader: frames round-trip, and a recording cut
+// short anywhere in its last frame replays the frames before it.
+#include "Check.hpp"
+#include "FrameRecording.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace {
+
+const char kPath[] = "FrameRecordingTest.rsrc";
+const char kCutPath[] = "FrameRecordingTest.cut.rsrc";
+const int kWidth = 32;
+const int kHeight = 16;
+const int kStride = kWidth * 3;
+const int kFrames = 4;
+
+// Frame i: frame i-1 with an 8x4 box at (4i, 2i) filled with i.
+std::vector<uint8_t> Screen(int frames) {
+    std::vector<uint8_t> pixels(static_cast<size_t>(kStride) * kHeight, 0);
+    for (int i = 1; i <= frames; ++i) {
+        for (int y = 2 * i; y < 2 * i + 4; ++y) {
+            for (int x = 4 * i * 3; x < (4 * i + 8) * 3; ++x) {
+                pixels[static_cast<size_t>(y) * kStride + x] = static_cast<uint8_t>(i);
+            }
+        }
+    }
+    return pixels;
+}
+
+std::vector<uint8_t> ReadFile(const char* path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+void WriteFile(const char* path, const std::vector<uint8_t>& bytes, size_t size) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(size));
+}
+
+// Writes kFrames frames and returns the file size after each one.
+std::vector<size_t> Record() {
+    FrameRecorder recorder;
+    CHECK(recorder.Open(kPath, false));
+    std::vector<size_t> ends;
+    for (int i = 0; i < kFrames; ++i) {
+        std::vector<uint8_t> pixels = Screen(i);
+        FrameRect dirty;
+        dirty.x = 4 * i;
+        dirty.y = 2 * i;
+        dirty.width = 8;
+        dirty.height = 4;
+        FrameView view;
+        view.data = pixels.data();
+        view.width = kWidth;
+        view.height = kHeight;
+        view.stride = kStride;
+        view.timestampUs = 1000 + 100 * static_cast<uint64_t>(i);
+        view.dirtyRects = &dirty;
+        view.dirtyCount = 1;
+        CHECK(recorder.Write(view, false));
+        ends.push_back(static_cast<size_t>(recorder.StoredBytes()));
+    }
+    CHECK_EQ(recorder.FramesWritten(), static_cast<uint64_t>(kFrames));
+    recorder.Close();
+    return ends;
+}
+
+// Replays path and checks it holds the first frames frames.
+void CheckReplay(const char* path, size_t frames) {
+    RecordingReader reader;
+    CHECK(reader.Open(path));
+    CHECK_EQ(reader.FrameCount(), frames);
+    std::vector<uint8_t> pixels(static_cast<size_t>(kStride) * kHeight, 0xAA);
+    for (size_t i = 0; i < reader.FrameCount(); ++i) {
+        const FrameRecording::FrameHeader& header = reader.Header(i);
+        CHECK_EQ(header.width, kWidth);
+        CHECK_EQ(header.height, kHeight);
+        CHECK_EQ(header.rectCount, 1);
+        CHECK_EQ(header.timestampUs, 100 * i);
+        CHECK(reader.Apply(i, pixels.data(), kStride));
+        CHECK(pixels == Screen(static_cast<int>(i)));
+    }
+}
+
+void TestRoundTrip() {
+    std::vector<size_t> ends = Record();
+    CHECK_EQ(ReadFile(kPath).size(), ends.back());
+    CheckReplay(kPath, kFrames);
+}
+
+void TestCutShort() {
+    std::vector<size_t> ends = Record();
+    std::vector<uint8_t> bytes = ReadFile(kPath);
+    const size_t last = ends[kFrames - 2];
+    const size_t cuts[] = {
+        last + 1,                                              // inside the frame header
+        last + FrameRecording::kFrameHeaderSize - 1,
+        last + FrameRecording::kFrameHeaderSize,               // header, no rects
+        last + FrameRecording::kFrameHeaderSize + 3,           // inside the rect
+        last + FrameRecording::kFrameHeaderSize + FrameRecording::kRectSize + 5,  // inside the payload
+        ends.back() - 1,
+    };
+    for (size_t cut : cuts) {
+        WriteFile(kCutPath, bytes, cut);
+        CheckReplay(kCutPath, kFrames - 1);
+    }
+
+    // Cut inside the first frame leaves nothing to replay.
+    RecordingReader reader;
+    WriteFile(kCutPath, bytes, FrameRecording::kFileHeaderSize + 4);
+    CHECK(!reader.Open(kCutPath));
+    WriteFile(kCutPath, bytes, FrameRecording::kFileHeaderSize);
+    CHECK(!reader.Open(kCutPath));
+}
+
+void TestDamaged() {
+    std::vector<size_t> ends = Record();
+    std::vector<uint8_t> bytes = ReadFile(kPath);
+    RecordingReader reader;
+
+    // A whole frame header that is wrong is damage, not truncation.
+    std::vector<uint8_t> damaged = bytes;
+    damaged[ends[1]] ^= 0xFF;
+    WriteFile(kCutPath, damaged, damaged.size());
+    CHECK(!reader.Open(kCutPath));
+
+    // So is a rect outside the frame.
+    damaged = bytes;
+    damaged[ends[1] + FrameRecording::kFrameHeaderSize] = kWidth;
+    WriteFile(kCutPath, damaged, damaged.size());
+    CHECK(!reader.Open(kCutPath));
+
+    damaged = bytes;
+    damaged[0] ^= 0xFF;
+    WriteFile(kCutPath, damaged, damaged.size());
+    CHECK(!reader.Open(kCutPath));
+}
+
+} // namespace
+
+int main() {
+    TestRoundTrip();
+    TestCutShort();
+    TestDamaged();
+    std::remove(kPath);
+    std::remove(kCutPath);
+    return TestResult();
+}
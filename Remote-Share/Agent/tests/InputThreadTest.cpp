@@ -0,0 +1,155 @@
+// InputThread: events reach the sink in the order they were posted, and when
+// the queue is full it is the newest mouse move that survives.
+#include "Check.hpp"
+#include "InputThread.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const int kQueueSize = 256;
+
+// Records every injected event. While closed, Inject blocks, so a test can
+// fill the queue behind a batch that is being injected.
+class RecordingSink : public InputSink {
+public:
+    void Inject(const std::vector<InputEvent>& events) override {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait(lock, [this]() { return m_open; });
+        m_events.insert(m_events.end(), events.begin(), events.end());
+        m_cv.notify_all();
+    }
+
+    void SetOpen(bool open) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_open = open;
+        m_cv.notify_all();
+    }
+
+    // Waits until the last event injected so far is one done accepts.
+    template <typename Predicate>
+    bool WaitFor(Predicate done) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        return m_cv.wait_for(lock, std::chrono::seconds(10),
+                             [&]() { return !m_events.empty() && done(m_events.back()); });
+    }
+
+    std::vector<InputEvent> Events() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_events;
+    }
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_open = true;
+    std::vector<InputEvent> m_events;
+};
+
+InputEvent Move(int x) {
+    InputEvent event;
+    event.type = InputEvent::Type::MouseMove;
+    event.x = x;
+    event.y = 2 * x;
+    return event;
+}
+
+InputEvent Button(InputEvent::Type type) {
+    InputEvent event;
+    event.type = type;
+    event.button = 0;
+    return event;
+}
+
+bool IsMove(const InputEvent& event, int x) {
+    return event.type == InputEvent::Type::MouseMove && event.x == x;
+}
+
+// More moves than the queue holds, posted before the thread runs: the queue
+// keeps the oldest, and the newest waits behind them instead of being lost.
+void TestFullQueueKeepsNewestMove() {
+    RecordingSink sink;
+    InputThread thread(sink);
+    const int moves = kQueueSize + 44;
+    for (int x = 0; x < moves; ++x) {
+        const InputEvent event = Move(x);
+        thread.Post(event);
+    }
+    CHECK_EQ(thread.Stats().eventsPosted.load(), static_cast<uint64_t>(moves));
+    CHECK_EQ(thread.Stats().movesDropped.load(), static_cast<uint64_t>(moves - kQueueSize - 1));
+
+    thread.Start();
+    CHECK(sink.WaitFor([&](const InputEvent& event) { return IsMove(event, moves - 1); }));
+    std::vector<InputEvent> events = sink.Events();
+    CHECK(!events.empty());
+    CHECK(IsMove(events.back(), moves - 1));
+    CHECK_EQ(events.back().y, 2 * (moves - 1));
+
+    // Nothing is left behind for a later drain.
+    const InputEvent next = Move(1000);
+    thread.Post(next);
+    CHECK(sink.WaitFor([](const InputEvent& event) { return IsMove(event, 1000); }));
+    thread.Stop();
+}
+
+// Fills the queue while the input thread is stuck in the sink, then posts a
+// button press: it has to land after the newest move before it, and a move
+// posted after it has to land after it.
+void TestHeldMoveKeepsOrder() {
+    RecordingSink sink;
+    InputThread thread(sink);
+    thread.Start();
+
+    sink.SetOpen(false);
+    thread.Post(Move(-1));
+    // The input thread has taken the first move and is blocked injecting it.
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    const int moves = kQueueSize + 10;
+    for (int x = 0; x < moves; ++x) {
+        thread.Post(Move(x));
+    }
+    CHECK(thread.Stats().movesDropped.load() > 0);
+
+    // Button events wait for room; let the input thread make it.
+    std::thread opener([&sink]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        sink.SetOpen(true);
+    });
+    thread.Post(Button(InputEvent::Type::MouseDown));
+    thread.Post(Move(5000));
+    thread.Post(Button(InputEvent::Type::MouseUp));
+    opener.join();
+    CHECK(sink.WaitFor([](const InputEvent& event) { return event.type == InputEvent::Type::MouseUp; }));
+    thread.Stop();
+
+    std::vector<InputEvent> events = sink.Events();
+    CHECK(events.size() >= 5);
+    if (events.size() < 5) {
+        return;
+    }
+    size_t n = events.size();
+    CHECK(IsMove(events[0], -1));
+    CHECK(IsMove(events[n - 4], moves - 1));
+    CHECK(events[n - 3].type == InputEvent::Type::MouseDown);
+    CHECK(IsMove(events[n - 2], 5000));
+    CHECK(events[n - 1].type == InputEvent::Type::MouseUp);
+    int last = -2;
+    for (size_t i = 0; i + 3 < n; ++i) {
+        CHECK(events[i].type == InputEvent::Type::MouseMove);
+        CHECK(events[i].x > last);
+        last = events[i].x;
+    }
+}
+
+} // namespace
+
+int main() {
+    TestFullQueueKeepsNewestMove();
+    TestHeldMoveKeepsOrder();
+    return TestResult();
+}
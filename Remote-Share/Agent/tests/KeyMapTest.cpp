@@ -0,0 +1,133 @@
+// KeyMap: every table name finds its own entry, and nothing else finds
+// anything, however close it is to a real name.
+#include "Check.hpp"
+#include "KeyMap.hpp"
+
+#include <cctype>
+#include <string>
+
+namespace {
+
+typedef bool (*LookupFn)(std::string_view, KeyMap::KeyInfo&);
+
+bool SameInfo(const KeyMap::KeyInfo& a, const KeyMap::KeyInfo& b) {
+    return a.vk == b.vk && a.scanCode == b.scanCode && a.extended == b.extended && a.keysym == b.keysym;
+}
+
+bool InTable(const KeyMap::Entry* entries, size_t count, std::string_view name) {
+    for (size_t i = 0; i < count; ++i) {
+        if (entries[i].name == name) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// A name only ever matches exactly: looking it up from a copy in a longer
+// buffer, with a neighbouring byte changed, finds the same entry.
+void CheckHit(LookupFn lookup, const KeyMap::Entry& entry) {
+    std::string buffer = "#" + std::string(entry.name) + "#######";
+    std::string_view name(buffer.data() + 1, entry.name.size());
+    KeyMap::KeyInfo info;
+    CHECK(lookup(name, info));
+    CHECK(SameInfo(info, entry.info));
+    buffer[0] = '!';
+    buffer[entry.name.size() + 1] = '!';
+    info = KeyMap::KeyInfo();
+    CHECK(lookup(name, info));
+    CHECK(SameInfo(info, entry.info));
+}
+
+// Anything that is not a table name (or, for keys, a letter or digit) misses
+// and leaves info alone.
+void CheckMiss(LookupFn lookup, const KeyMap::Entry* entries, size_t count, const std::string& name) {
+    if (InTable(entries, count, name)) {
+        return;
+    }
+    if (lookup == KeyMap::LookupKey && name.size() == 1 && std::isalnum(static_cast<unsigned char>(name[0]))) {
+        return;
+    }
+    KeyMap::KeyInfo info;
+    info.vk = 0x42;
+    if (lookup(name, info)) {
+        std::fprintf(stderr, "unexpected hit: \"%s\"\n", name.c_str());
+        CHECK(false);
+    }
+    CHECK_EQ(info.vk, 0x42);
+}
+
+void CheckTable(LookupFn lookup, const KeyMap::Entry* entries, size_t count) {
+    CHECK(count > 0);
+    for (size_t i = 0; i < count; ++i) {
+        const KeyMap::Entry& entry = entries[i];
+        CHECK(entry.name.size() <= 16);
+        CheckHit(lookup, entry);
+
+        // Near misses: every byte changed, one byte short or long, and
+        // padded past the 16 bytes any name can have.
+        std::string name(entry.name);
+        for (size_t j = 0; j < name.size(); ++j) {
+            for (char flip : {'\x01', '\x20', '\x80'}) {
+                std::string changed = name;
+                changed[j] = static_cast<char>(changed[j] ^ flip);
+                CheckMiss(lookup, entries, count, changed);
+            }
+        }
+        if (name.size() > 1) {
+            CheckMiss(lookup, entries, count, name.substr(0, name.size() - 1));
+            CheckMiss(lookup, entries, count, name.substr(1));
+        }
+        CheckMiss(lookup, entries, count, name + "x");
+        CheckMiss(lookup, entries, count, name + '\0');
+        CheckMiss(lookup, entries, count, name + std::string(17 - name.size(), ' '));
+        CheckMiss(lookup, entries, count, name + std::string(40, '_'));
+    }
+}
+
+void TestCodes() {
+    size_t count = 0;
+    const KeyMap::Entry* entries = KeyMap::CodeEntries(count);
+    CheckTable(KeyMap::LookupCode, entries, count);
+
+    KeyMap::KeyInfo info;
+    CHECK(KeyMap::LookupCode("KeyA", info));
+    CHECK_EQ(info.scanCode, 0x1E);
+    CHECK(KeyMap::LookupCode("ArrowUp", info));
+    CHECK(info.extended);
+    for (const char* unknown : {"", "a", "Key", "keya", "KeyÄ", "F25", "Numpad", "Unidentified",
+                                "NumpadMultiplyXYZ", "ABCDEFGHIJKLMNOPQRSTUVWXYZ"}) {
+        CheckMiss(KeyMap::LookupCode, entries, count, unknown);
+    }
+}
+
+void TestKeys() {
+    size_t count = 0;
+    const KeyMap::Entry* entries = KeyMap::KeyEntries(count);
+    CheckTable(KeyMap::LookupKey, entries, count);
+
+    // Letters and digits are computed rather than looked up.
+    KeyMap::KeyInfo info;
+    for (char c = 'a'; c <= 'z'; ++c) {
+        CHECK(KeyMap::LookupKey(std::string(1, c), info));
+        CHECK_EQ(info.vk, c - 'a' + 'A');
+        CHECK_EQ(info.keysym, static_cast<uint32_t>(c));
+    }
+    for (char c = '0'; c <= '9'; ++c) {
+        CHECK(KeyMap::LookupKey(std::string(1, c), info));
+        CHECK_EQ(info.vk, c);
+    }
+    CHECK(KeyMap::LookupKey(" ", info));
+    CHECK_EQ(info.vk, 0x20);
+    for (const char* unknown : {"", "!", "~", "ab", "Dead", "Unidentified", "F0", "ShiftLeft",
+                                "ArrowLeftArrowLeft", "0123456789abcdefg"}) {
+        CheckMiss(KeyMap::LookupKey, entries, count, unknown);
+    }
+}
+
+} // namespace
+
+int main() {
+    TestCodes();
+    TestKeys();
+    return TestResult();
+}
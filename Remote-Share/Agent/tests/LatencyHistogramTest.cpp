@@ -0,0 +1,178 @@
+// LatencyHistogram: bucket edges and bounds, the cap on large values, and the
+// percentiles and interval deltas the stats report is built from.
+#include "Check.hpp"
+#include "LatencyHistogram.hpp"
+
+#include <cstdint>
+
+namespace {
+
+typedef LatencyHistogram H;
+
+const uint64_t kMaxValue = (uint64_t(1) << H::kMaxValueBits) - 1;
+
+// The bucket's upper bound is never below the value, and at most 1/32 of it
+// above.
+void CheckBound(uint64_t us) {
+    uint64_t bound = H::BucketUpperBound(H::BucketOf(us));
+    CHECK(bound >= us);
+    if (bound < us || (bound - us) * H::kSubBuckets > us) {
+        std::fprintf(stderr, "value %llu, bound %llu\n", static_cast<unsigned long long>(us),
+                     static_cast<unsigned long long>(bound));
+        CHECK(false);
+    }
+}
+
+void TestExact() {
+    for (uint64_t us = 0; us < 64; ++us) {
+        CHECK_EQ(H::BucketOf(us), static_cast<size_t>(us));
+        CHECK_EQ(H::BucketUpperBound(H::BucketOf(us)), us);
+    }
+    CHECK_EQ(H::kExactLimit, 64u);
+}
+
+void TestEdges() {
+    // 64 and 65 share the first bucket past the exact ones, 127 ends that
+    // power of two and 128 starts the next.
+    CHECK_EQ(H::BucketOf(64), 64u);
+    CHECK_EQ(H::BucketOf(65), 64u);
+    CHECK_EQ(H::BucketUpperBound(64), 65u);
+    CHECK_EQ(H::BucketOf(66), 65u);
+    CHECK_EQ(H::BucketOf(127), 95u);
+    CHECK_EQ(H::BucketUpperBound(95), 127u);
+    CHECK_EQ(H::BucketOf(128), 96u);
+    CHECK_EQ(H::BucketOf(131), 96u);
+    CHECK_EQ(H::BucketUpperBound(96), 131u);
+    CHECK_EQ(H::BucketOf(132), 97u);
+
+    // Buckets tile the range: each starts one past the previous bound.
+    for (size_t bucket = 0; bucket + 1 < H::kBucketCount; ++bucket) {
+        CHECK_EQ(H::BucketOf(H::BucketUpperBound(bucket)), bucket);
+        CHECK_EQ(H::BucketOf(H::BucketUpperBound(bucket) + 1), bucket + 1);
+    }
+}
+
+void TestCap() {
+    CHECK_EQ(H::BucketOf(kMaxValue), H::kBucketCount - 1);
+    CHECK_EQ(H::BucketUpperBound(H::kBucketCount - 1), kMaxValue);
+    CHECK_EQ(H::BucketOf(kMaxValue + 1), H::kBucketCount - 1);
+    CHECK_EQ(H::BucketOf(UINT64_MAX), H::kBucketCount - 1);
+    CHECK(H::BucketOf(uint64_t(1) << (H::kMaxValueBits - 1)) < H::kBucketCount - 1);
+}
+
+void TestBounds() {
+    for (uint64_t us = 0; us < 100000; ++us) {
+        CheckBound(us);
+    }
+    for (unsigned bit = 6; bit < H::kMaxValueBits; ++bit) {
+        uint64_t power = uint64_t(1) << bit;
+        CheckBound(power - 1);
+        CheckBound(power);
+        CheckBound(power + 1);
+        CheckBound(power + power / 3);
+    }
+    // A spread of values across the whole range.
+    uint64_t us = 1;
+    while (us <= kMaxValue) {
+        CheckBound(us);
+        us = us * 7 / 5 + 3;
+    }
+    CheckBound(kMaxValue);
+}
+
+void TestPercentiles() {
+    // 1..100 once each: the nearest ranks are the values themselves, and
+    // 95 and 99 are upper bounds of their buckets.
+    LatencyHistogram histogram;
+    for (uint64_t us = 1; us <= 100; ++us) {
+        histogram.Record(us);
+    }
+    H::Snapshot snapshot;
+    histogram.TakeSnapshot(snapshot);
+    LatencySummary summary = snapshot.Summarize();
+    CHECK_EQ(summary.count, 100u);
+    CHECK_EQ(summary.p50, 50u);
+    CHECK_EQ(summary.p95, 95u);
+    CHECK_EQ(summary.p99, 99u);
+    CHECK_EQ(summary.max, 100u);
+    CHECK(summary.mean == 50.5);
+
+    // A slow tail: 1000 us most of the time, 20 ms one time in fifty.
+    LatencyHistogram tail;
+    for (int i = 0; i < 980; ++i) {
+        tail.Record(1000);
+    }
+    for (int i = 0; i < 20; ++i) {
+        tail.Record(20000);
+    }
+    tail.TakeSnapshot(snapshot);
+    summary = snapshot.Summarize();
+    CHECK_EQ(summary.count, 1000u);
+    CHECK_EQ(summary.p50, H::BucketUpperBound(H::BucketOf(1000)));
+    CHECK_EQ(summary.p95, H::BucketUpperBound(H::BucketOf(1000)));
+    CHECK_EQ(summary.p99, 20000u);  // bucket bound, capped at max
+    CHECK_EQ(summary.max, 20000u);
+
+    // One value: every percentile is that value, not its bucket's bound.
+    LatencyHistogram single;
+    single.Record(1000);
+    single.TakeSnapshot(snapshot);
+    summary = snapshot.Summarize();
+    CHECK_EQ(summary.p50, 1000u);
+    CHECK_EQ(summary.p99, 1000u);
+
+    LatencyHistogram empty;
+    empty.TakeSnapshot(snapshot);
+    summary = snapshot.Summarize();
+    CHECK_EQ(summary.count, 0u);
+    CHECK_EQ(summary.p99, 0u);
+}
+
+void TestSince() {
+    LatencyHistogram histogram;
+    histogram.Record(5000);
+    histogram.Record(10);
+    H::Snapshot first;
+    histogram.TakeSnapshot(first);
+
+    for (int i = 0; i < 9; ++i) {
+        histogram.Record(100);
+    }
+    histogram.Record(200);
+    H::Snapshot second;
+    histogram.TakeSnapshot(second);
+
+    H::Snapshot delta = second.Since(first);
+    CHECK_EQ(delta.count, 10u);
+    CHECK_EQ(delta.sum, 1100u);
+    CHECK_EQ(delta.counts[H::BucketOf(10)], 0u);
+    CHECK_EQ(delta.counts[H::BucketOf(5000)], 0u);
+    CHECK_EQ(delta.counts[H::BucketOf(100)], 9u);
+    // The 5000 before the interval does not count towards its max.
+    CHECK_EQ(delta.max, H::BucketUpperBound(H::BucketOf(200)));
+    CHECK(delta.max >= 200 && delta.max < 5000);
+
+    LatencySummary summary = delta.Summarize();
+    CHECK_EQ(summary.count, 10u);
+    CHECK_EQ(summary.p50, H::BucketUpperBound(H::BucketOf(100)));
+    CHECK_EQ(summary.p99, delta.max);
+    CHECK(summary.mean == 110.0);
+
+    // Nothing in between.
+    H::Snapshot none = second.Since(second);
+    CHECK_EQ(none.count, 0u);
+    CHECK_EQ(none.max, 0u);
+    CHECK_EQ(none.Summarize().count, 0u);
+}
+
+} // namespace
+
+int main() {
+    TestExact();
+    TestEdges();
+    TestCap();
+    TestBounds();
+    TestPercentiles();
+    TestSince();
+    return TestResult();
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <websocketpp/frame.hpp>
+
+// websocketpp's word_mask_exact as vendored before the SIMD kernels: a word
+// loop plus a byte tail. Kept as the baseline the kernels are benchmarked
+// against.
+inline void ReferenceWordMask(uint8_t const* input, uint8_t* output, size_t length,
+                              websocketpp::frame::masking_key_type const& key) {
+    size_t prepared_key = websocketpp::frame::prepare_masking_key(key);
+    size_t n = length / sizeof(size_t);
+    size_t const* input_word = reinterpret_cast<size_t const*>(input);
+    size_t* output_word = reinterpret_cast<size_t*>(output);
+
+    for (size_t i = 0; i < n; i++) {
+        output_word[i] = input_word[i] ^ prepared_key;
+    }
+
+    for (size_t i = n * sizeof(size_t); i < length; i++) {
+        output[i] = input[i] ^ key.c[i % 4];
+    }
+}
+
+// The definition of masking, one byte at a time, for checking the others.
+inline void ScalarMask(uint8_t const* input, uint8_t* output, size_t length,
+                       websocketpp::frame::masking_key_type const& key, size_t offset = 0) {
+    for (size_t i = 0; i < length; ++i) {
+        output[i] = input[i] ^ key.c[(i + offset) % 4];
+    }
+}
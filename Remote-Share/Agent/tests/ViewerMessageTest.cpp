@@ -0,0 +1,72 @@
+// Viewer messages as the relay delivers them, JSON and binary.
+#include "Check.hpp"
+#include "FrameProtocol.hpp"
+#include "InputProtocol.hpp"
+#include "ViewerMessage.hpp"
+
+#include <string>
+
+namespace {
+
+void TestJsonInput() {
+    InputEvent event;
+    CHECK(ParseViewerMessage(R"({"type":"input","inputType":"mousedown","x":120,"y":45,"button":2})", event) ==
+          ViewerCommand::Input);
+    CHECK(event.type == InputEvent::Type::MouseDown);
+    CHECK_EQ(event.x, 120);
+    CHECK_EQ(event.y, 45);
+    CHECK_EQ(event.button, 2);
+
+    CHECK(ParseViewerMessage(R"({"type":"input","inputType":"keydown","key":"a","code":"KeyA","shiftKey":true})",
+                             event) == ViewerCommand::Input);
+    CHECK(event.type == InputEvent::Type::KeyDown);
+    CHECK(event.Key() == "a");
+    CHECK(event.Code() == "KeyA");
+    CHECK(event.shiftKey);
+    CHECK(!event.ctrlKey);
+}
+
+void TestCommands() {
+    InputEvent event;
+    CHECK(ParseViewerMessage(R"({"type":"keyframe_request"})", event) == ViewerCommand::Keyframe);
+    CHECK(ParseViewerMessage(R"({"type":"viewer_ready"})", event) == ViewerCommand::Keyframe);
+    CHECK(ParseViewerMessage(R"({"type":"close_connection"})", event) == ViewerCommand::Close);
+    CHECK(ParseViewerMessage(R"({"type":"toggle_fullscreen"})", event) == ViewerCommand::ToggleFullscreen);
+}
+
+void TestIgnored() {
+    InputEvent event;
+    CHECK(ParseViewerMessage(R"({"type":"chat"})", event) == ViewerCommand::None);
+    CHECK(ParseViewerMessage(R"({"type":"input","inputType":"touchstart"})", event) == ViewerCommand::None);
+    CHECK(ParseViewerMessage("not json", event) == ViewerCommand::None);
+    CHECK(ParseViewerMessage("", event) == ViewerCommand::None);
+}
+
+void TestBinaryInput() {
+    std::string record(InputProtocol::kRecordSize, '\0');
+    record[0] = static_cast<char>(FrameProtocol::kVersion);
+    record[1] = static_cast<char>(FrameProtocol::MessageType::Input);
+    record[2] = static_cast<char>(InputProtocol::Kind::MouseMove);
+    record[4] = 0x34;  // x = 0x1234
+    record[5] = 0x12;
+    record[6] = 0x10;  // y = 16
+    InputEvent event;
+    CHECK(ParseViewerMessage(record, event) == ViewerCommand::Input);
+    CHECK(event.type == InputEvent::Type::MouseMove);
+    CHECK_EQ(event.x, 0x1234);
+    CHECK_EQ(event.y, 16);
+
+    // One byte short is not a record, and not JSON either.
+    record.pop_back();
+    CHECK(ParseViewerMessage(record, event) == ViewerCommand::None);
+}
+
+} // namespace
+
+int main() {
+    TestJsonInput();
+    TestCommands();
+    TestIgnored();
+    TestBinaryInput();
+    return TestResult();
+}
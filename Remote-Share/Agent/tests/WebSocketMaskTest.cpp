@@ -0,0 +1,163 @@
+// The vendored websocketpp's payload masking (frame.hpp): the SSE2 and AVX2
+// kernels, and the word and circular functions that run them, must produce
+// exactly the bytes of a plain byte-at-a-time mask, for every length around
+// the vector widths, every alignment of input and output, in place, and when
+// a payload is masked in pieces.
+#include "Check.hpp"
+#include "CpuFeatures.hpp"
+#include "ReferenceMask.hpp"
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+
+using websocketpp::frame::masking_key_type;
+namespace frame = websocketpp::frame;
+
+const size_t kMaxLength = 600;
+const size_t kMaxOffset = 32;
+const size_t kGuard = 64;
+
+masking_key_type Key(uint32_t value) {
+    masking_key_type key;
+    key.i = value;
+    return key;
+}
+
+typedef void (*MaskFn)(uint8_t const* input, uint8_t* output, size_t length, masking_key_type const& key);
+
+#ifdef _WEBSOCKETPP_SIMD_MASK_
+// A kernel masks a prefix; the rest is finished byte by byte here so the
+// whole buffer can be compared.
+template <frame::simd::mask_kernel Kernel>
+void KernelThenBytes(uint8_t const* input, uint8_t* output, size_t length, masking_key_type const& key) {
+    size_t done = Kernel(input, output, length, key.i);
+    CHECK(done <= length);
+    CHECK_EQ(done % 4, 0u);
+    ScalarMask(input + done, output + done, length - done, key);
+}
+#endif
+
+void WordMaskExact(uint8_t const* input, uint8_t* output, size_t length, masking_key_type const& key) {
+    frame::word_mask_exact(input, output, length, key);
+}
+
+struct Variant {
+    const char* name;
+    MaskFn mask;
+    bool available;
+};
+
+std::vector<Variant> Variants() {
+    std::vector<Variant> variants;
+    variants.push_back({"word_mask_exact", WordMaskExact, true});
+    variants.push_back({"reference word loop", ReferenceWordMask, true});
+#ifdef _WEBSOCKETPP_SIMD_MASK_
+    variants.push_back({"sse2", KernelThenBytes<frame::simd::mask_sse2>, GetCpuFeatures().sse2});
+    variants.push_back({"avx2", KernelThenBytes<frame::simd::mask_avx2>, GetCpuFeatures().avx2});
+#endif
+    return variants;
+}
+
+// Masks input (at inOffset) into output (at outOffset) and compares with the
+// byte loop, including that nothing around the output was touched.
+bool CheckOne(const Variant& variant, const std::vector<uint8_t>& source, size_t length, size_t inOffset,
+              size_t outOffset, masking_key_type key) {
+    std::vector<uint8_t> input(kMaxOffset + kMaxLength);
+    std::memcpy(input.data() + inOffset, source.data(), length);
+    std::vector<uint8_t> output(kMaxOffset + kMaxLength + kGuard, 0xA5);
+    std::vector<uint8_t> expected(output);
+    ScalarMask(source.data(), expected.data() + outOffset, length, key);
+
+    variant.mask(input.data() + inOffset, output.data() + outOffset, length, key);
+    if (output != expected) {
+        std::fprintf(stderr, "%s: length %zu, input offset %zu, output offset %zu\n", variant.name, length,
+                     inOffset, outOffset);
+        CHECK(output == expected);
+        return false;
+    }
+    return true;
+}
+
+void TestEveryLengthAndAlignment() {
+    std::mt19937 rng(1);
+    std::vector<uint8_t> source(kMaxLength);
+    for (uint8_t& b : source) {
+        b = static_cast<uint8_t>(rng());
+    }
+    masking_key_type key = Key(0x9A3B5CD7);
+    for (const Variant& variant : Variants()) {
+        if (!variant.available) {
+            continue;
+        }
+        for (size_t length = 0; length <= kMaxLength; ++length) {
+            for (size_t inOffset = 0; inOffset < kMaxOffset; inOffset += 3) {
+                // Same alignment, and input and output misaligned differently.
+                if (!CheckOne(variant, source, length, inOffset, inOffset, key) ||
+                    !CheckOne(variant, source, length, inOffset, (inOffset * 7 + 5) % kMaxOffset, key)) {
+                    return;
+                }
+            }
+        }
+    }
+}
+
+void TestInPlace() {
+    std::mt19937 rng(2);
+    for (size_t length : {0u, 1u, 15u, 16u, 31u, 32u, 127u, 128u, 129u, 4099u}) {
+        for (size_t offset = 0; offset < 8; ++offset) {
+            std::vector<uint8_t> data(length + offset);
+            for (uint8_t& b : data) {
+                b = static_cast<uint8_t>(rng());
+            }
+            std::vector<uint8_t> expected(data);
+            masking_key_type key = Key(static_cast<uint32_t>(rng()));
+            ScalarMask(data.data() + offset, expected.data() + offset, length, key);
+            frame::word_mask_exact(data.data() + offset, length, key);
+            CHECK(data == expected);
+        }
+    }
+}
+
+void TestCircular() {
+    // A payload masked in pieces of arbitrary size, carrying the key phase
+    // from one piece to the next, as websocketpp does for fragmented reads.
+    std::mt19937 rng(3);
+    std::vector<uint8_t> source(5000);
+    for (uint8_t& b : source) {
+        b = static_cast<uint8_t>(rng());
+    }
+    masking_key_type key = Key(0x01234567);
+    std::vector<uint8_t> expected(source.size());
+    ScalarMask(source.data(), expected.data(), source.size(), key);
+
+    for (int round = 0; round < 200; ++round) {
+        std::vector<uint8_t> words(source);
+        std::vector<uint8_t> bytes(source);
+        size_t wordKey = frame::prepare_masking_key(key);
+        size_t byteKey = frame::prepare_masking_key(key);
+        size_t position = 0;
+        while (position < source.size()) {
+            size_t piece = std::min<size_t>(source.size() - position, rng() % 300);
+            wordKey = frame::word_mask_circ(words.data() + position, piece, wordKey);
+            byteKey = frame::byte_mask_circ(bytes.data() + position, piece, byteKey);
+            position += piece;
+        }
+        CHECK(words == expected);
+        CHECK(bytes == expected);
+        if (words != expected || bytes != expected) {
+            return;
+        }
+    }
+}
+
+} // namespace
+
+int main() {
+    TestEveryLengthAndAlignment();
+    TestInPlace();
+    TestCircular();
+    return TestResult();
+}
@@ -0,0 +1,255 @@
+// X11FrameSource against a live X server (Xvfb in CI, see x11_capture.sh):
+// root and window capture read what was drawn, and with damage on, drawing
+// wakes the source, the dirty rects cover what was drawn and little else, and
+// an idle window wakes nobody. Skipped (exit 77) without a display.
+#include "Check.hpp"
+#include "X11FrameSource.hpp"
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+// After the agent's headers: Xlib's macros collide with names in them.
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+
+namespace {
+
+const int kSkipped = 77;
+const size_t kSlots = 4;
+
+// A window this test draws into, on its own connection, as any other client
+// would. No window manager runs under Xvfb, so it lands where it is put.
+struct TestWindow {
+    Display* display = nullptr;
+    Window window = 0;
+    GC gc = nullptr;
+    int x = 40;
+    int y = 30;
+    int width = 320;
+    int height = 240;
+
+    bool Open() {
+        display = XOpenDisplay(nullptr);
+        if (!display) {
+            return false;
+        }
+        int screen = DefaultScreen(display);
+        window = XCreateSimpleWindow(display, RootWindow(display, screen), x, y, width, height, 0,
+                                     BlackPixel(display, screen), BlackPixel(display, screen));
+        XSetWindowAttributes attributes;
+        attributes.override_redirect = True;
+        XChangeWindowAttributes(display, window, CWOverrideRedirect, &attributes);
+        XSelectInput(display, window, StructureNotifyMask);
+        XMapRaised(display, window);
+        XEvent event;
+        do {
+            XNextEvent(display, &event);
+        } while (event.type != MapNotify);
+        gc = XCreateGC(display, window, 0, nullptr);
+        XSync(display, False);
+        return true;
+    }
+
+    ~TestWindow() {
+        if (display) {
+            if (gc) {
+                XFreeGC(display, gc);
+            }
+            XDestroyWindow(display, window);
+            XCloseDisplay(display);
+        }
+    }
+
+    // rgb as 0xRRGGBB, which is the pixel value on a depth 24 TrueColor
+    // visual.
+    void Fill(int left, int top, int w, int h, unsigned long rgb) {
+        XSetForeground(display, gc, rgb);
+        XFillRectangle(display, window, gc, left, top, static_cast<unsigned>(w), static_cast<unsigned>(h));
+        XSync(display, False);
+    }
+};
+
+unsigned long PixelAt(const PooledFrame& frame, int x, int y) {
+    const uint8_t* p = frame.Data() + static_cast<size_t>(y) * frame.Stride() + static_cast<size_t>(x) * 4;
+    return static_cast<unsigned long>(p[2]) << 16 | static_cast<unsigned long>(p[1]) << 8 | p[0];
+}
+
+bool Covers(const std::vector<FrameRect>& rects, int x, int y) {
+    for (const FrameRect& rect : rects) {
+        if (x >= rect.x && x < rect.x + rect.width && y >= rect.y && y < rect.y + rect.height) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool CoversRect(const std::vector<FrameRect>& rects, int left, int top, int w, int h) {
+    for (int y = top; y < top + h; ++y) {
+        for (int x = left; x < left + w; ++x) {
+            if (!Covers(rects, x, y)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+uint64_t Area(const std::vector<FrameRect>& rects) {
+    uint64_t area = 0;
+    for (const FrameRect& rect : rects) {
+        area += static_cast<uint64_t>(rect.width) * static_cast<uint64_t>(rect.height);
+    }
+    return area;
+}
+
+void TestParseWindow() {
+    unsigned long window = 0;
+    CHECK(ParseX11Window("0x1c00007", window));
+    CHECK_EQ(window, 0x1c00007ul);
+    CHECK(ParseX11Window("29360135", window));
+    CHECK_EQ(window, 29360135ul);
+    CHECK(!ParseX11Window("", window));
+    CHECK(!ParseX11Window("0", window));
+    CHECK(!ParseX11Window("0x1c0000z", window));
+}
+
+void TestRootCapture(TestWindow& test) {
+    X11FrameSource source(nullptr, kSlots);
+    CHECK(source.IsOpen());
+    int width = 0, height = 0;
+    CHECK(source.QuerySize(width, height));
+    CHECK_EQ(width, DisplayWidth(test.display, DefaultScreen(test.display)));
+    CHECK_EQ(height, DisplayHeight(test.display, DefaultScreen(test.display)));
+
+    test.Fill(0, 0, test.width, test.height, 0x2040c0);
+    PooledFrame frame = source.Capture();
+    CHECK(frame);
+    if (!frame) {
+        return;
+    }
+    CHECK(frame.Format() == PixelFormat::BGRX32);
+    CHECK_EQ(frame.Width(), width);
+    CHECK_EQ(frame.Stride(), width * 4);
+    CHECK_EQ(PixelAt(frame, test.x + 5, test.y + 5), 0x2040c0ul);
+    CHECK_EQ(PixelAt(frame, test.x + test.width - 1, test.y + test.height - 1), 0x2040c0ul);
+}
+
+void TestWindowCapture(TestWindow& test) {
+    X11FrameSource source(nullptr, kSlots);
+    source.SetTarget(test.window);
+    int width = 0, height = 0;
+    CHECK(source.QuerySize(width, height));
+    CHECK_EQ(width, test.width);
+    CHECK_EQ(height, test.height);
+
+    test.Fill(0, 0, test.width, test.height, 0x000000);
+    test.Fill(10, 20, 50, 30, 0xff0000);
+    PooledFrame frame = source.Capture();
+    CHECK(frame);
+    if (!frame) {
+        return;
+    }
+    CHECK_EQ(frame.Width(), test.width);
+    CHECK_EQ(frame.Height(), test.height);
+    CHECK_EQ(PixelAt(frame, 10, 20), 0xff0000ul);
+    CHECK_EQ(PixelAt(frame, 59, 49), 0xff0000ul);
+    CHECK_EQ(PixelAt(frame, 60, 49), 0x000000ul);
+    CHECK_EQ(PixelAt(frame, 9, 20), 0x000000ul);
+
+    // Back to back, each lease returned before the next capture.
+    frame.Release();
+    for (int i = 0; i < 20; ++i) {
+        CHECK(source.Capture());
+    }
+}
+
+// How often an idle source claims damage over period, capturing each time
+// like the pipeline does.
+int IdleWakeups(X11FrameSource& source, std::chrono::milliseconds period) {
+    int wakeups = 0;
+    auto end = std::chrono::steady_clock::now() + period;
+    while (std::chrono::steady_clock::now() < end) {
+        if (source.WaitForDamage(std::chrono::milliseconds(100))) {
+            ++wakeups;
+            source.Capture();
+        }
+    }
+    return wakeups;
+}
+
+void TestDamage(TestWindow& test) {
+    X11FrameSource source(nullptr, kSlots, true);
+    if (!source.ReportsDamage()) {
+        std::fprintf(stderr, "X11CaptureTest: no XDamage in this build or server; damage checks skipped\n");
+        return;
+    }
+    source.SetTarget(test.window);
+    test.Fill(0, 0, test.width, test.height, 0x000000);
+
+    // The first frame of a target has no history, so it is read whole.
+    PooledFrame frame = source.Capture();
+    CHECK(frame);
+    CHECK_EQ(frame.DirtyRects().size(), 1u);
+    CHECK(CoversRect(frame.DirtyRects(), 0, 0, test.width, test.height));
+    frame.Release();
+
+    // Nothing drawn, nothing to capture.
+    CHECK_EQ(IdleWakeups(source, std::chrono::milliseconds(1000)), 0);
+
+    // Two small draws: both are reported, and not much besides.
+    test.Fill(100, 50, 40, 20, 0x00ff00);
+    test.Fill(200, 150, 16, 16, 0x0000ff);
+    CHECK(source.WaitForDamage(std::chrono::milliseconds(2000)));
+    frame = source.Capture();
+    CHECK(frame);
+    if (frame) {
+        const std::vector<FrameRect>& dirty = frame.DirtyRects();
+        CHECK(!dirty.empty());
+        CHECK(CoversRect(dirty, 100, 50, 40, 20));
+        CHECK(CoversRect(dirty, 200, 150, 16, 16));
+        CHECK(!Covers(dirty, 10, 10));
+        CHECK(Area(dirty) <= 4 * (40 * 20 + 16 * 16));
+        for (const FrameRect& rect : dirty) {
+            CHECK(rect.x >= 0 && rect.y >= 0);
+            CHECK(rect.x + rect.width <= test.width && rect.y + rect.height <= test.height);
+        }
+        CHECK_EQ(PixelAt(frame, 100, 50), 0x00ff00ul);
+        CHECK_EQ(PixelAt(frame, 215, 165), 0x0000fful);
+    }
+    frame.Release();
+    CHECK_EQ(IdleWakeups(source, std::chrono::milliseconds(500)), 0);
+
+    // A keyframe request wakes the source and reads everything.
+    source.DamageAll();
+    CHECK(source.WaitForDamage(std::chrono::milliseconds(0)));
+    frame = source.Capture();
+    CHECK(frame && CoversRect(frame.DirtyRects(), 0, 0, test.width, test.height));
+    frame.Release();
+
+    // Wake ends a wait early without inventing damage.
+    std::thread waker([&source]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        source.Wake();
+    });
+    auto start = std::chrono::steady_clock::now();
+    CHECK(!source.WaitForDamage(std::chrono::milliseconds(5000)));
+    CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds(2));
+    waker.join();
+}
+
+} // namespace
+
+int main() {
+    TestParseWindow();
+    TestWindow test;
+    if (!test.Open()) {
+        std::fprintf(stderr, "X11CaptureTest: no X display; skipped\n");
+        int result = TestResult();
+        return result == 0 ? kSkipped : result;
+    }
+    TestRootCapture(test);
+    TestWindowCapture(test);
+    TestDamage(test);
+    return TestResult();
+}
@@ -0,0 +1,121 @@
+#!/usr/bin/env bash
+# X11 capture against a real X server, for CI and before merging changes to
+# X11FrameSource. Starts Xvfb (through xvfb-run) unless $DISPLAY is already
+# set, then:
+#   - runs X11CaptureTest, which draws into a window of its own and checks
+#     what root, window and damage-driven capture read back;
+#   - puts an xterm on the screen and times --bench-capture on the root
+#     window and on the xterm;
+#   - streams the xterm through the relay (../Server) with --damage, once
+#     idle, where next to nothing may be captured, and once while xdotool
+#     types into it, where every burst of typing has to be.
+#
+#   tests/x11_capture.sh [BUILD_DIR] [RESULTS_FILE]
+#
+# BUILD_DIR is a build of this directory with REMOTE_SHARE_X11 and
+# REMOTE_SHARE_XDAMAGE on (default _build). Results are appended to
+# RESULTS_FILE (default BUILD_DIR/x11_capture.txt) so CI can keep them.
+# Needs xvfb-run, xterm, xdotool and node. Exits non-zero if anything fails.
+set -euo pipefail
+
+AGENT_DIR=$(cd "$(dirname "$0")/.." && pwd)
+BUILD_DIR=$(cd "${1:-$AGENT_DIR/_build}" && pwd)
+RESULTS=${2:-$BUILD_DIR/x11_capture.txt}
+SCREEN=${X11_CAPTURE_SCREEN:-1920x1080x24}
+FRAMES=${X11_CAPTURE_FRAMES:-300}
+PORT=${X11_CAPTURE_PORT:-8093}
+DURATION=10
+# The first frame is a keyframe; anything much past it means polling.
+MAX_IDLE_CAPTURES=3
+MIN_TYPING_CAPTURES=20
+
+if [ -z "${DISPLAY:-}" ]; then
+    exec xvfb-run -a -s "-screen 0 $SCREEN -nolisten tcp" "$0" "$BUILD_DIR" "$RESULTS"
+fi
+
+HEADLESS=$BUILD_DIR/RemoteShareAgentHeadless
+CAPTURE_TEST=$BUILD_DIR/tests/X11CaptureTest
+RELAY_DIR=$AGENT_DIR/../Server
+for tool in "$HEADLESS" "$CAPTURE_TEST" xterm xdotool node; do
+    if ! command -v "$tool" >/dev/null; then
+        echo "x11_capture: $tool not found" >&2
+        exit 1
+    fi
+done
+if ! grep -q '^REMOTE_SHARE_XDAMAGE:BOOL=ON' "$BUILD_DIR/CMakeCache.txt"; then
+    echo "x11_capture: $BUILD_DIR is built without XDamage (install libXdamage and libXfixes)" >&2
+    exit 1
+fi
+
+PIDS=()
+cleanup() {
+    for pid in "${PIDS[@]}"; do
+        kill "$pid" 2>/dev/null || true
+    done
+}
+trap cleanup EXIT
+
+"$CAPTURE_TEST"
+
+xterm -geometry 120x40+100+100 -e sh -c 'while :; do sleep 60; done' &
+XTERM_PID=$!
+PIDS+=("$XTERM_PID")
+WINDOW=$(xdotool search --sync --pid "$XTERM_PID" | head -n 1)
+echo "x11_capture: display $DISPLAY, xterm window $WINDOW"
+
+if [ ! -d "$RELAY_DIR/node_modules" ]; then
+    npm ci --omit=dev --prefix "$RELAY_DIR"
+fi
+PORT=$PORT node "$RELAY_DIR/index.js" >"$BUILD_DIR/x11_capture_relay.log" 2>&1 &
+PIDS+=("$!")
+for _ in $(seq 100); do
+    if (exec 3<>"/dev/tcp/127.0.0.1/$PORT") 2>/dev/null; then
+        break
+    fi
+    sleep 0.1
+done
+
+# Captures over a whole headless run, changed or not: the count of the
+# capture stage in its final report.
+captured() {
+    awk '$1 == "capture" && $2 ~ /^[0-9]+$/ { count = $2 } END { print count }'
+}
+
+stream() {
+    "$HEADLESS" 127.0.0.1 --port "$PORT" --source "x11:$WINDOW" --damage --duration "$DURATION"
+}
+
+{
+    echo "== $(date -u '+%Y-%m-%d %H:%M:%S') $(git -C "$AGENT_DIR" rev-parse --short HEAD 2>/dev/null || true)"
+    echo "-- root window ($SCREEN)"
+    "$HEADLESS" --source x11 --bench-capture "$FRAMES"
+    echo "-- xterm window $WINDOW"
+    "$HEADLESS" --source "x11:$WINDOW" --bench-capture "$FRAMES"
+} | tee -a "$RESULTS"
+
+echo "-- damage-driven, idle xterm" | tee -a "$RESULTS"
+IDLE=$(stream | tee -a "$RESULTS" | captured)
+
+echo "-- damage-driven, typing into the xterm" | tee -a "$RESULTS"
+xdotool windowfocus --sync "$WINDOW"
+(
+    sleep 1
+    for _ in $(seq 6); do
+        xdotool type --delay 80 "the quick brown fox jumps over the lazy dog "
+    done
+) &
+TYPIST=$!
+PIDS+=("$TYPIST")
+TYPING=$(stream | tee -a "$RESULTS" | captured)
+wait "$TYPIST" || true
+
+echo "x11_capture: $IDLE captures idle, $TYPING while typing" | tee -a "$RESULTS"
+if [ -z "$IDLE" ] || [ "$IDLE" -gt "$MAX_IDLE_CAPTURES" ]; then
+    echo "x11_capture: FAILED, an idle window was captured ${IDLE:-?} times (at most $MAX_IDLE_CAPTURES)" >&2
+    exit 1
+fi
+if [ -z "$TYPING" ] || [ "$TYPING" -lt "$MIN_TYPING_CAPTURES" ]; then
+    echo "x11_capture: FAILED, typing was captured ${TYPING:-?} times (at least $MIN_TYPING_CAPTURES)" >&2
+    exit 1
+fi
+echo "x11_capture: passed; results in $RESULTS"
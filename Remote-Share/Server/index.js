@@ -41,6 +41,19 @@ function logConnectionStats() {
 // Log connection stats every 30 seconds
 setInterval(logConnectionStats, 30000);
 
+// Latest per-stage latency report from each session's agent
+app.get('/stats', (req, res) => {
+    const result = {};
+    sessions.forEach((session, sessionId) => {
+        result[sessionId] = {
+            agentConnected: !!session.agent,
+            viewers: session.viewers.size,
+            stats: session.agentStats
+        };
+    });
+    res.json(result);
+});
+
 // Function to calculate optimal scale
 function calculateOptimalScale(agentScreen, clientScreen) {
     // Get the available width and height from client
@@ -97,6 +110,7 @@ wss.on('connection', (ws, req) => {
             viewers: new Map(), 
             agentScreen: null,
             clientScreens: new Map(),
+            agentStats: null,
             createdAt: new Date().toISOString(),
             lastActivity: new Date().toISOString()
         });
@@ -153,8 +167,18 @@ function handleAgentConnection(ws, req, sessionId, session) {
     });
 
     // Handle incoming messages from agent
-    ws.on('message', message => {
+    ws.on('message', (message, isBinary) => {
         session.lastActivity = new Date().toISOString();
+
+        // Binary frames are passed through to viewers untouched
+        if (isBinary) {
+            session.viewers.forEach(({ ws: viewerWs }) => {
+                if (viewerWs.readyState === WebSocket.OPEN) {
+                    viewerWs.send(message, { binary: true });
+                }
+            });
+            return;
+        }
         
         try {
             const msg = JSON.parse(message.toString());
@@ -181,6 +205,11 @@ function handleAgentConnection(ws, req, sessionId, session) {
                     }
                 });
             }
+
+            // Keep the agent's latest latency report for GET /stats
+            if (msg.type === 'stats') {
+                session.agentStats = { ...msg, receivedAt: new Date().toISOString() };
+            }
             
             // Forward other messages to viewers
             session.viewers.forEach(({ ws: viewerWs }) => {
@@ -201,6 +230,7 @@ function handleAgentConnection(ws, req, sessionId, session) {
     ws.on('close', () => {
         console.log(`Agent disconnected from session: ${sessionId}`);
         session.agent = null;
+        session.agentStats = null;
         connectionState.agentConnections--;
         connectionState.activeConnections--;
         
@@ -244,8 +274,15 @@ function handleViewerConnection(ws, req, sessionId, session) {
     console.log(`Total viewer connections: ${connectionState.viewerConnections}`);
 
     // Handle client info message
-    ws.on('message', message => {
+    ws.on('message', (message, isBinary) => {
         session.lastActivity = new Date().toISOString();
+
+        if (isBinary) {
+            if (session.agent && session.agent.readyState === WebSocket.OPEN) {
+                session.agent.send(message, { binary: true });
+            }
+            return;
+        }
         
         try {
             const msg = JSON.parse(message.toString());
@@ -271,7 +308,7 @@ function handleViewerConnection(ws, req, sessionId, session) {
             
             // Forward input events to agent
             if (session.agent && session.agent.readyState === WebSocket.OPEN) {
-                session.agent.send(message);
+                session.agent.send(message, { binary: false });
             } else {
                 console.warn(`Received input for session ${sessionId}, but no agent is connected.`);
             }
@@ -6,11 +6,24 @@ let loadingOverlay;
 let controlButtons;
 let fullScreenButton;
 let disconnectButton;
+let statsButton;
+let statsOverlay;
+let showStats = false;
 let ctx;
 let isFullScreen = false;
 let ws = null;
 let originalWidth = 0; // Stores the original width of the remote screen frame
 let originalHeight = 0; // Stores the original height of the remote screen frame
+let lastFrameSeq = -1; // Sequence number of the last frame accepted for drawing
+let haveKeyframe = false; // Delta frames can only be drawn on top of a keyframe
+let drawQueue = Promise.resolve(); // Keeps frames drawn in arrival order while images decode
+// Deltas are queued behind the keyframe they build on before it has decoded,
+// so each queued frame remembers which keyframe that was. If that keyframe, or
+// a delta after it, fails to decode, the rest of its frames are skipped.
+let keyframeGeneration = 0;
+let failedGeneration = -1;
+let lastKeyframeRequest = 0;
+let chunkStream = null; // Frame message being reassembled from FrameChunk messages
 let ipDialog;
 let ipInputInDialog;
 let ipDialogConnectButton;
@@ -124,6 +137,7 @@ function connectWebSocket(serverIp = 'localhost') {
     const wsUrl = `${protocol}//${serverIp}:8080/viewer?sessionId=${sessionId}`; // Ensure port 8080 or your server's port
 
     ws = new WebSocket(wsUrl);
+    ws.binaryType = 'arraybuffer'; // Frames arrive as binary messages (see FrameProtocol.hpp in the agent)
 
     ws.onopen = () => {
         updateStatus('Connected!', 'success');
@@ -139,33 +153,18 @@ function connectWebSocket(serverIp = 'localhost') {
 
     ws.onmessage = (event) => {
         try {
+            if (event.data instanceof ArrayBuffer) {
+                handleBinaryFrame(event.data);
+                return;
+            }
             const message = JSON.parse(event.data);
             if (message.type === 'frame' && message.image) {
-                const img = new Image();
-                img.src = message.image;
-                img.onload = () => {
-                    if (!ctx || !remoteScreenCanvas) {
-                        console.error('Canvas context or element not available for drawing.');
-                        return;
-                    }
-
-                    // Store original dimensions for input scaling
-                    originalWidth = message.width;
-                    originalHeight = message.height;
-
-                    // Set the canvas's internal drawing buffer resolution to match the image
-                    // This ensures high-quality drawing and correct aspect ratio for CSS scaling
-                    remoteScreenCanvas.width = img.width;
-                    remoteScreenCanvas.height = img.height;
-
-                    // Clear the canvas before drawing the new frame
-                    ctx.clearRect(0, 0, remoteScreenCanvas.width, remoteScreenCanvas.height);
-                    
-                    // Draw the image directly onto the canvas.
-                    // The CSS (width: 100%; height: auto;) will handle the display scaling
-                    // of this high-resolution drawing buffer to fit the parent container.
-                    ctx.drawImage(img, 0, 0, img.width, img.height);
-                };
+                const whole = { x: 0, y: 0, w: message.width, h: message.height, image: message.image };
+                handleKeyframe(message, [whole], (rect) => loadImage(rect.image));
+            } else if (message.type === 'delta_frame') {
+                handleDeltaFrame(message, (rect) => loadImage(rect.image));
+            } else if (message.type === 'stats') {
+                handleAgentStats(message);
             } else if (message.type === 'agent_status') {
                 if (message.connected) {
                     updateStatus('Agent Connected', 'success');
@@ -198,6 +197,225 @@ function connectWebSocket(serverIp = 'localhost') {
     };
 }
 
+// Decodes a data URI into an Image
+function loadImage(src) {
+    return new Promise((resolve, reject) => {
+        const img = new Image();
+        img.onload = () => resolve(img);
+        img.onerror = reject;
+        img.src = src;
+    });
+}
+
+// Decodes a JPEG held in a binary frame without going through a data URI
+function decodeJpeg(bytes) {
+    return createImageBitmap(new Blob([bytes], { type: 'image/jpeg' }));
+}
+
+// ImageBitmaps hold decoded pixels until closed; plain Images do not need it
+function releaseImage(img) {
+    if (img && typeof img.close === 'function') {
+        img.close();
+    }
+}
+
+const FRAME_PROTOCOL_VERSION = 1;
+const FRAME_HEADER_SIZE = 24;
+const RECT_HEADER_SIZE = 12;
+const FRAME_TYPE_KEYFRAME = 1;
+const FRAME_TYPE_DELTA = 2;
+const FRAME_TYPE_CHUNK = 3;
+const FRAME_CODEC_JPEG = 1;
+const CHUNK_HEADER_SIZE = 16;
+
+// Collects a frame message the agent split into chunks so its control
+// messages could go out in between. Chunks of one stream arrive in order; a
+// chunk that does not continue the current stream drops it.
+function handleFrameChunk(buffer) {
+    const view = new DataView(buffer);
+    if (buffer.byteLength < CHUNK_HEADER_SIZE) {
+        throw new Error('Truncated chunk message');
+    }
+    const streamId = view.getUint32(4, true);
+    const offset = view.getUint32(8, true);
+    const totalSize = view.getUint32(12, true);
+    const bytes = new Uint8Array(buffer, CHUNK_HEADER_SIZE);
+
+    if (offset === 0) {
+        if (chunkStream) {
+            // The previous frame never completed, so deltas after it are unusable
+            haveKeyframe = false;
+        }
+        chunkStream = { id: streamId, data: new Uint8Array(totalSize), received: 0 };
+    }
+    if (!chunkStream || chunkStream.id !== streamId || chunkStream.received !== offset ||
+        offset + bytes.length > chunkStream.data.length) {
+        chunkStream = null;
+        haveKeyframe = false;
+        requestKeyframe();
+        return;
+    }
+
+    chunkStream.data.set(bytes, offset);
+    chunkStream.received += bytes.length;
+    if (chunkStream.received === chunkStream.data.length) {
+        const whole = chunkStream.data.buffer;
+        chunkStream = null;
+        handleBinaryFrame(whole);
+    }
+}
+
+// Parses a binary frame message (little-endian, layout in FrameProtocol.hpp)
+function handleBinaryFrame(buffer) {
+    const view = new DataView(buffer);
+    // Chunks can be shorter than a frame header
+    if (buffer.byteLength >= 2 && view.getUint8(0) === FRAME_PROTOCOL_VERSION &&
+        view.getUint8(1) === FRAME_TYPE_CHUNK) {
+        handleFrameChunk(buffer);
+        return;
+    }
+    if (buffer.byteLength < FRAME_HEADER_SIZE || view.getUint8(0) !== FRAME_PROTOCOL_VERSION) {
+        console.warn('Ignoring binary message with unknown frame format.');
+        return;
+    }
+    const type = view.getUint8(1);
+    const codec = view.getUint8(2);
+    if (codec !== FRAME_CODEC_JPEG) {
+        console.warn('Ignoring frame with unsupported codec:', codec);
+        return;
+    }
+
+    const frame = {
+        seq: view.getUint32(4, true),
+        width: view.getUint16(16, true),
+        height: view.getUint16(18, true),
+        rects: []
+    };
+    const rectCount = view.getUint16(20, true);
+    let offset = FRAME_HEADER_SIZE;
+    for (let i = 0; i < rectCount; i++) {
+        if (offset + RECT_HEADER_SIZE > buffer.byteLength) {
+            throw new Error('Truncated frame message');
+        }
+        const size = view.getUint32(offset + 8, true);
+        const start = offset + RECT_HEADER_SIZE;
+        if (start + size > buffer.byteLength) {
+            throw new Error('Truncated frame message');
+        }
+        frame.rects.push({
+            x: view.getUint16(offset, true),
+            y: view.getUint16(offset + 2, true),
+            w: view.getUint16(offset + 4, true),
+            h: view.getUint16(offset + 6, true),
+            payload: new Uint8Array(buffer, start, size)
+        });
+        offset = start + size;
+    }
+
+    if (type === FRAME_TYPE_KEYFRAME) {
+        handleKeyframe(frame, frame.rects, (rect) => decodeJpeg(rect.payload));
+    } else if (type === FRAME_TYPE_DELTA) {
+        handleDeltaFrame(frame, (rect) => decodeJpeg(rect.payload));
+    } else {
+        console.warn('Ignoring binary frame of unknown type:', type);
+    }
+}
+
+// Asks the agent for a full frame, at most twice a second
+function requestKeyframe() {
+    const now = Date.now();
+    if (ws && ws.readyState === WebSocket.OPEN && now - lastKeyframeRequest > 500) {
+        lastKeyframeRequest = now;
+        ws.send(JSON.stringify({ type: 'keyframe_request' }));
+    }
+}
+
+// Draws a full frame, replacing whatever is on the canvas. The rects cover the
+// whole frame (a single one, or bands the agent encoded in parallel);
+// decodeRect(rect) returns a promise for that rectangle's image.
+function handleKeyframe(message, rects, decodeRect) {
+    // Store original dimensions for input scaling
+    originalWidth = message.width;
+    originalHeight = message.height;
+    if (message.seq !== undefined) {
+        lastFrameSeq = message.seq;
+    }
+    haveKeyframe = true;
+    const generation = ++keyframeGeneration;
+
+    const decoded = Promise.all(rects.map(decodeRect));
+    drawQueue = drawQueue.then(() => decoded).then((images) => {
+        if (!ctx || !remoteScreenCanvas) {
+            console.error('Canvas context or element not available for drawing.');
+            images.forEach(releaseImage);
+            return;
+        }
+
+        // Set the canvas's internal drawing buffer resolution to match the frame
+        // This ensures high-quality drawing and correct aspect ratio for CSS scaling
+        remoteScreenCanvas.width = message.width || images[0].width;
+        remoteScreenCanvas.height = message.height || images[0].height;
+
+        // Clear the canvas before drawing the new frame
+        ctx.clearRect(0, 0, remoteScreenCanvas.width, remoteScreenCanvas.height);
+
+        // Draw the images directly onto the canvas.
+        // The CSS (width: 100%; height: auto;) will handle the display scaling
+        // of this high-resolution drawing buffer to fit the parent container.
+        images.forEach((img, i) => {
+            ctx.drawImage(img, rects[i].x, rects[i].y, rects[i].w || img.width, rects[i].h || img.height);
+            releaseImage(img);
+        });
+    }).catch((e) => {
+        console.error('Error decoding keyframe:', e);
+        failKeyframeGeneration(generation);
+    });
+}
+
+// Draws the changed rectangles of a frame on top of the current canvas.
+// decodeRect(rect) returns a promise for that rectangle's image.
+function handleDeltaFrame(message, decodeRect) {
+    // A delta only makes sense on top of the frame right before it
+    if (!haveKeyframe || message.seq !== lastFrameSeq + 1 ||
+        message.width !== originalWidth || message.height !== originalHeight) {
+        haveKeyframe = false;
+        requestKeyframe();
+        return;
+    }
+    lastFrameSeq = message.seq;
+    const generation = keyframeGeneration;
+
+    const rects = message.rects || [];
+    const decoded = Promise.all(rects.map(decodeRect));
+    drawQueue = drawQueue.then(() => decoded).then((images) => {
+        if (generation === failedGeneration) {
+            // Its keyframe never made it onto the canvas
+            images.forEach(releaseImage);
+            return;
+        }
+        images.forEach((img, i) => {
+            if (ctx && remoteScreenCanvas) {
+                ctx.drawImage(img, rects[i].x, rects[i].y, rects[i].w, rects[i].h);
+            }
+            releaseImage(img);
+        });
+    }).catch((e) => {
+        console.error('Error decoding delta frame:', e);
+        failKeyframeGeneration(generation);
+    });
+}
+
+// A frame of this keyframe generation could not be drawn, so nothing after it
+// in the generation can be either. Only the current generation asks for a new
+// keyframe; an older one failing late must not undo a newer keyframe.
+function failKeyframeGeneration(generation) {
+    failedGeneration = generation;
+    if (generation === keyframeGeneration) {
+        haveKeyframe = false;
+        requestKeyframe();
+    }
+}
+
 // Function to send input events (mouse, keyboard) to the agent
 function sendInput(inputType, data) {
     if (ws && ws.readyState === WebSocket.OPEN && originalWidth > 0 && originalHeight > 0 && remoteScreenCanvas) {
@@ -244,6 +462,10 @@ function sendInput(inputType, data) {
                 scaledData.y = Math.max(0, Math.min(scaledData.y, originalHeight - 1));
             }
         }
+        if (USE_BINARY_INPUT) {
+            ws.send(encodeInputRecord(inputType, scaledData));
+            return;
+        }
         const message = {
             type: 'input',
             inputType: inputType,
@@ -253,6 +475,60 @@ function sendInput(inputType, data) {
     }
 }
 
+// Input events go to the agent as fixed 56-byte binary records (see
+// Agent/src/InputProtocol.hpp). The agent still accepts the JSON form.
+const USE_BINARY_INPUT = true;
+const FRAME_TYPE_INPUT = 4;
+const INPUT_RECORD_SIZE = 56;
+const INPUT_KEY_FIELD_SIZE = 16;
+const INPUT_KINDS = {
+    mousemove: 1, mousedown: 2, mouseup: 3, click: 4,
+    contextmenu: 5, wheel: 6, keydown: 7, keyup: 8
+};
+const inputRecord = new ArrayBuffer(INPUT_RECORD_SIZE);
+const inputRecordView = new DataView(inputRecord);
+const inputRecordBytes = new Uint8Array(inputRecord);
+const inputTextEncoder = new TextEncoder();
+
+// Writes str as UTF-8 into the 16-byte field at offset and returns the byte
+// length, or 0 if it does not fit (such keys have no mapping on the agent).
+function writeInputKeyField(str, offset) {
+    const field = inputRecordBytes.subarray(offset, offset + INPUT_KEY_FIELD_SIZE);
+    field.fill(0);
+    if (!str) {
+        return 0;
+    }
+    const result = inputTextEncoder.encodeInto(str, field);
+    if (result.read !== str.length) {
+        field.fill(0);
+        return 0;
+    }
+    return result.written;
+}
+
+function encodeInputRecord(inputType, data) {
+    const view = inputRecordView;
+    const modifiers = (data.ctrlKey ? 1 : 0) | (data.shiftKey ? 2 : 0) |
+                      (data.altKey ? 4 : 0) | (data.metaKey ? 8 : 0);
+    const deltaY = Math.max(-32768, Math.min(32767, Math.round(data.deltaY || 0)));
+    view.setUint8(0, FRAME_PROTOCOL_VERSION);
+    view.setUint8(1, FRAME_TYPE_INPUT);
+    view.setUint8(2, INPUT_KINDS[inputType] || 0);
+    view.setUint8(3, modifiers);
+    view.setUint16(4, data.x || 0, true);
+    view.setUint16(6, data.y || 0, true);
+    view.setInt8(8, data.button !== undefined ? data.button : -1);
+    view.setUint8(9, 0);
+    view.setInt16(10, deltaY, true);
+    view.setUint8(13, writeInputKeyField(data.code, 24));
+    view.setUint8(12, writeInputKeyField(data.key, 40));
+    view.setUint16(14, 0, true);
+    const timestampUs = Math.round((performance.timeOrigin + performance.now()) * 1000);
+    view.setBigUint64(16, BigInt(timestampUs), true);
+    // The scratch record is reused; hand the socket its own copy.
+    return inputRecord.slice(0);
+}
+
 // Function to toggle full screen mode
 function toggleFullScreen() {
     try {
@@ -282,6 +558,39 @@ function toggleFullScreen() {
     }
 }
 
+// Agent latency report (Metrics.cpp in the agent), sent every couple of seconds.
+// Times are in microseconds and stop when the agent's socket has the frame, so
+// network time to this viewer is not included.
+function handleAgentStats(message) {
+    if (!statsOverlay || !showStats) {
+        return;
+    }
+    const stage = (name) => message.stages && message.stages[name];
+    const ms = (us) => (us / 1000).toFixed(1);
+    const line = (label, name) => {
+        const s = stage(name);
+        return s && s.count > 0 ? `${label.padEnd(9)} ${ms(s.p50).padStart(6)} ${ms(s.p99).padStart(6)} ms` : null;
+    };
+    const lines = [
+        `${message.fps.toFixed(1)} fps, ${message.sendMbps.toFixed(2)} Mbit/s`,
+        '          p50    p99',
+        line('capture', 'capture'),
+        line('encode', 'encode'),
+        line('queue', 'queueWait'),
+        line('send', 'send'),
+        line('total', 'endToEnd')
+    ];
+    statsOverlay.textContent = lines.filter((l) => l !== null).join('\n');
+}
+
+function toggleStats() {
+    showStats = !showStats;
+    if (statsOverlay) {
+        statsOverlay.textContent = showStats ? 'Waiting for agent stats...' : '';
+        statsOverlay.classList.toggle('d-none', !showStats);
+    }
+}
+
 // Function to close WebSocket connection
 function closeConnection() {
     if (ws && ws.readyState === WebSocket.OPEN) {
@@ -290,10 +599,16 @@ function closeConnection() {
     if (controlButtons) {
         controlButtons.classList.add('d-none'); // Hide with Bootstrap class
     }
+    if (showStats) {
+        toggleStats();
+    }
     if (loadingOverlay) {
         loadingOverlay.classList.add('d-none'); // Hide with Bootstrap class
     }
     updateStatus('Disconnected', 'info');
+    haveKeyframe = false;
+    lastFrameSeq = -1;
+    chunkStream = null;
 
     // Clear canvas and draw 'Disconnected' message
     if (ctx && remoteScreenCanvas) {
@@ -322,6 +637,8 @@ document.addEventListener('DOMContentLoaded', () => {
     controlButtons = document.getElementById('controlButtons');
     fullScreenButton = document.getElementById('fullScreenButton');
     disconnectButton = document.getElementById('disconnectButton');
+    statsButton = document.getElementById('statsButton');
+    statsOverlay = document.getElementById('statsOverlay');
 
     // Initialize canvas
     if (remoteScreenCanvas) {
@@ -344,6 +661,9 @@ document.addEventListener('DOMContentLoaded', () => {
     if (disconnectButton) {
         disconnectButton.addEventListener('click', closeConnection);
     }
+    if (statsButton) {
+        statsButton.addEventListener('click', toggleStats);
+    }
 
     // Keyboard events for input and fullscreen
     document.addEventListener('keydown', (e) => {